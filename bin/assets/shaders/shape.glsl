@@ -0,0 +1,150 @@
+#VERTEX
+#version 330 core
+
+// one instance per shape, see ggf_shape_instance_t
+layout (location = 0) in vec4 in_points; // a, b
+layout (location = 1) in vec4 in_params; // radius, thickness, rotation, depth
+layout (location = 2) in vec4 in_color;
+layout (location = 3) in float in_texture_index;
+layout (location = 4) in uint in_type;
+
+out vec4 pass_color;
+out vec3 pass_uv;
+out vec2 pass_local; // position around the shape center, unrotated
+flat out vec2 pass_half_size;
+flat out vec2 pass_radius_thickness;
+flat out uint pass_type;
+
+layout (std140) uniform camera
+{
+    mat4 view_projection_matrix;
+    vec2 viewport_size; // in pixels
+};
+
+#define SHAPE_CIRCLE 0u
+#define SHAPE_ROUNDED_RECT 1u
+#define SHAPE_CAPSULE 2u
+
+// unit quad drawn as a triangle strip
+const vec2 corners[4] = vec2[4](vec2(0.0, 0.0), vec2(1.0, 0.0),
+                                vec2(0.0, 1.0), vec2(1.0, 1.0));
+
+void main()
+{
+    vec2 a = in_points.xy;
+    vec2 b = in_points.zw;
+    float radius = in_params.x;
+
+    vec2 center = a;
+    vec2 half_size = vec2(radius);
+    vec2 axis = vec2(1.0, 0.0);
+    if (in_type == SHAPE_ROUNDED_RECT) {
+        half_size = b;
+        axis = vec2(cos(in_params.z), sin(in_params.z));
+    } else if (in_type == SHAPE_CAPSULE) {
+        vec2 segment = b - a;
+        float segment_length = length(segment);
+        center = (a + b) * 0.5;
+        half_size = vec2(segment_length * 0.5 + radius, radius);
+        if (segment_length > 0.0)
+            axis = segment / segment_length;
+    }
+    half_size = max(half_size, vec2(0.0001));
+
+    // the quad reaches a pixel past the shape to cover its anti-aliased edge,
+    // in world units along each of its axes
+    vec2 side = vec2(-axis.y, axis.x);
+    vec2 pixels = vec2(
+        length((view_projection_matrix * vec4(axis, 0.0, 0.0)).xy *
+               viewport_size),
+        length((view_projection_matrix * vec4(side, 0.0, 0.0)).xy *
+               viewport_size)) * 0.5;
+    vec2 edge_margin = 1.0 / max(pixels, vec2(0.0001));
+
+    vec2 local = (corners[gl_VertexID] * 2.0 - 1.0) * (half_size + edge_margin);
+    vec2 position = center + axis * local.x + side * local.y;
+
+    pass_color = in_color;
+    pass_uv = vec3(0.5 + local.x / (2.0 * half_size.x),
+                   0.5 - local.y / (2.0 * half_size.y), in_texture_index);
+    pass_local = local;
+    pass_half_size = half_size;
+    pass_radius_thickness = in_params.xy;
+    pass_type = in_type;
+    gl_Position = view_projection_matrix * vec4(position, in_params.w, 1.0);
+}
+
+#FRAGMENT
+#version 330 core
+
+in vec4 pass_color;
+in vec3 pass_uv;
+in vec2 pass_local;
+flat in vec2 pass_half_size;
+flat in vec2 pass_radius_thickness;
+flat in uint pass_type;
+
+layout (location = 0) out vec4 color;
+
+uniform sampler2D textures[16];
+
+#define SHAPE_CIRCLE 0u
+#define SHAPE_ROUNDED_RECT 1u
+#define SHAPE_CAPSULE 2u
+
+void main()
+{
+    // sampled before anything is discarded, with the derivatives taken while
+    // every fragment of the quad still runs
+    vec2 uv = pass_uv.xy;
+    vec2 dx = dFdx(uv);
+    vec2 dy = dFdy(uv);
+    vec4 sampled_color;
+    switch (int(pass_uv.z)) {
+         case 0: sampled_color = textureGrad(textures[0], uv, dx, dy); break;
+         case 1: sampled_color = textureGrad(textures[1], uv, dx, dy); break;
+         case 2: sampled_color = textureGrad(textures[2], uv, dx, dy); break;
+         case 3: sampled_color = textureGrad(textures[3], uv, dx, dy); break;
+         case 4: sampled_color = textureGrad(textures[4], uv, dx, dy); break;
+         case 5: sampled_color = textureGrad(textures[5], uv, dx, dy); break;
+         case 6: sampled_color = textureGrad(textures[6], uv, dx, dy); break;
+         case 7: sampled_color = textureGrad(textures[7], uv, dx, dy); break;
+         case 8: sampled_color = textureGrad(textures[8], uv, dx, dy); break;
+         case 9: sampled_color = textureGrad(textures[9], uv, dx, dy); break;
+         case 10: sampled_color = textureGrad(textures[10], uv, dx, dy); break;
+         case 11: sampled_color = textureGrad(textures[11], uv, dx, dy); break;
+         case 12: sampled_color = textureGrad(textures[12], uv, dx, dy); break;
+         case 13: sampled_color = textureGrad(textures[13], uv, dx, dy); break;
+         case 14: sampled_color = textureGrad(textures[14], uv, dx, dy); break;
+         case 15: sampled_color = textureGrad(textures[15], uv, dx, dy); break;
+    }
+
+    vec2 p = pass_local;
+    float radius = pass_radius_thickness.x;
+    float thickness = pass_radius_thickness.y;
+
+    // signed distance to the edge, negative inside
+    float distance;
+    if (pass_type == SHAPE_ROUNDED_RECT) {
+        radius = min(radius, min(pass_half_size.x, pass_half_size.y));
+        vec2 q = abs(p) - pass_half_size + radius;
+        distance = length(max(q, 0.0)) + min(max(q.x, q.y), 0.0) - radius;
+    } else if (pass_type == SHAPE_CAPSULE) {
+        float half_length = pass_half_size.x - radius;
+        p.x -= clamp(p.x, -half_length, half_length);
+        distance = length(p) - radius;
+    } else {
+        distance = length(p) - radius;
+    }
+    if (thickness > 0.0)
+        distance = abs(distance + thickness * 0.5) - thickness * 0.5;
+
+    // one pixel wide edge
+    float coverage = clamp(0.5 - distance / max(fwidth(distance), 0.0001),
+                           0.0, 1.0);
+    if (coverage <= 0.0)
+        discard;
+
+    color = pass_color * sampled_color;
+    color.a *= coverage;
+}
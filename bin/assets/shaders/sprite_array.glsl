@@ -0,0 +1,56 @@
+#VERTEX
+#version 330 core
+
+// one instance per sprite
+layout (location = 0) in vec4 in_rect; // top left, size
+layout (location = 1) in vec2 in_rotation_depth;
+layout (location = 2) in vec4 in_color;
+layout (location = 3) in vec4 in_uv_rect; // min uv, max uv
+layout (location = 4) in float in_texture_index; // array layer
+
+out vec4 pass_color;
+out vec3 pass_uv;
+
+layout (std140) uniform camera
+{
+    mat4 view_projection_matrix;
+};
+
+// unit quad drawn as a triangle strip
+const vec2 corners[4] = vec2[4](vec2(0.0, 0.0), vec2(1.0, 0.0),
+                                vec2(0.0, 1.0), vec2(1.0, 1.0));
+
+void main()
+{
+    vec2 corner = corners[gl_VertexID];
+    vec2 local = corner * in_rect.zw;
+
+    // rotate around the center. added as a correction so that unrotated
+    // sprites land exactly on in_rect.
+    vec2 from_center = local - in_rect.zw * 0.5;
+    float s = sin(in_rotation_depth.x);
+    float c = cos(in_rotation_depth.x);
+    vec2 rotated = vec2(from_center.x * c - from_center.y * s,
+                        from_center.x * s + from_center.y * c);
+    vec2 position = in_rect.xy + local + (rotated - from_center);
+
+    pass_color = in_color;
+    pass_uv = vec3(mix(in_uv_rect.x, in_uv_rect.z, corner.x),
+                   mix(in_uv_rect.w, in_uv_rect.y, corner.y), in_texture_index);
+    gl_Position = view_projection_matrix * vec4(position, in_rotation_depth.y, 1.0);
+}
+
+#FRAGMENT
+#version 330 core
+
+in vec4 pass_color;
+in vec3 pass_uv;
+
+layout (location = 0) out vec4 color;
+
+uniform sampler2DArray texture_array;
+
+void main()
+{
+    color = pass_color * texture(texture_array, pass_uv);
+}
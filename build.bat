@@ -4,7 +4,8 @@ mkdir bin
 
 set flags=-std=c99 -g -O0 -Werror -D_DEBUG -DGGF_ENABLE_ASSERTIONS -DGGF_WINDOWS
 set inc=-I./deps/glad/ -I./deps/stb/ -I./deps/cglm/include -I./deps/glfw/include
-set lib=-L./deps/glfw/lib-mingw-w64 -lopengl32 -lglfw3 -luser32 -lwinmm -lgdi32
+set lib=-L./deps/glfw/lib-mingw-w64 -lopengl32 -lglfw3 -luser32 -lwinmm -lgdi32 -lsynchronization
 set src=./src/blackjack.c
 
 gcc %src% %flags% %inc% %lib% -o bin/ggf
+gcc ./src/benchmark.c %flags% -O2 %inc% %lib% -o bin/benchmark
@@ -32,4 +32,7 @@ fworks=(
 # Build
 gcc ${flags[*]} ${fworks[*]} ${inc[*]} ${lib[*]}  ${src[*]} -o ./bin/ggf.out
 
+# Benchmarks
+gcc ${flags[*]} -O2 ${fworks[*]} ${inc[*]} ${lib[*]} ./src/benchmark.c -o ./bin/benchmark.out
+
 cd ..
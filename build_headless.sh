@@ -0,0 +1,38 @@
+#!/bin/bash
+
+# Linux build whose windows can run offscreen, pass --headless to run it
+# without a display or GPU (EGL pbuffers, Mesa's surfaceless platform)
+
+mkdir -p bin
+
+flags=(
+  -std=gnu99 -g -O0 -Werror -D_DEBUG -DGGF_ENABLE_ASSERTIONS
+  -DGGF_OSX -DGGF_EGL
+)
+
+# Include directories
+inc=(
+  -I./deps/glad/
+  -I./deps/stb/
+  -I./deps/cglm/include/
+  -I./deps/glfw/include/
+)
+
+# Libraries
+lib=(
+  -lglfw
+  -lEGL
+  -lm
+  -lpthread
+)
+
+# Source files
+src=(
+  ./src/blackjack.c
+)
+
+# Build
+gcc ${flags[*]} ${inc[*]} ${src[*]} ${lib[*]} -o ./bin/ggf_headless.out
+
+# Benchmarks
+gcc ${flags[*]} -O2 ${inc[*]} ./src/benchmark.c ${lib[*]} -o ./bin/benchmark_headless.out
@@ -0,0 +1,473 @@
+#include "ggf.c"
+
+/*
+    times ggf_radix_sort_u32/u64 against qsort for 10^3 to 10^6 elements.
+   both sides sort keys together with a u32 payload index so the work is the
+   same, and every result is checked against the qsort order.
+
+    then times recording 10^3 to 10^5 quads with a ggf_draw_quad_extent call
+   each against a single ggf_gfx_draw_quads call, in quads per millisecond.
+   both must record the same commands. the quads are never drawn.
+
+    then times recording the same quads split over BENCHMARK_RECORDERS worker
+   threads, each into its own recorder and layer, against recording them on
+   the main thread. the workers finish in any order, the merged commands must
+   still equal the main thread's. a submission bigger than max_commands must
+   never leave more than max_commands unflushed.
+
+    last it measures fill rate, in megapixels per second: every frame
+   draws BENCHMARK_FILL_SPRITES sprites covering the window, spread over
+   BENCHMARK_FILL_TEXTURES textures, once as separate textures through the
+   sprite pipeline's texture unit switch and once as the layers of a texture
+   array through the sprite array pipeline.
+*/
+
+#define BENCHMARK_RUNS 5
+#define BENCHMARK_MAX_COUNT 1000000
+#define BENCHMARK_MAX_QUADS 100000
+#define BENCHMARK_RECORDERS 4
+#define BENCHMARK_FILL_SPRITES 64
+#define BENCHMARK_FILL_TEXTURES 16
+#define BENCHMARK_FILL_TEXTURE_SIZE 64
+#define BENCHMARK_WIDTH 1280
+#define BENCHMARK_HEIGHT 720
+
+typedef struct {
+  u32 key;
+  u32 index;
+} pair_u32_t;
+
+typedef struct {
+  u64 key;
+  u32 index;
+} pair_u64_t;
+
+internal_func int compare_pair_u32(const void *a, const void *b) {
+  const pair_u32_t *pa = a, *pb = b;
+  if (pa->key != pb->key)
+    return pa->key < pb->key ? -1 : 1;
+  return pa->index < pb->index ? -1 : pa->index > pb->index;
+}
+
+internal_func int compare_pair_u64(const void *a, const void *b) {
+  const pair_u64_t *pa = a, *pb = b;
+  if (pa->key != pb->key)
+    return pa->key < pb->key ? -1 : 1;
+  return pa->index < pb->index ? -1 : pa->index > pb->index;
+}
+
+typedef struct {
+  u32 *source_u32;
+  u64 *source_u64;
+  u32 *keys_u32;
+  u64 *keys_u64;
+  u32 *indices;
+  pair_u32_t *pairs_u32;
+  pair_u64_t *pairs_u64;
+} benchmark_data_t;
+
+internal_func f64 benchmark_qsort_u32(benchmark_data_t *data, u32 count) {
+  f64 start = ggf_platform_get_time();
+  for (u32 i = 0; i < count; i++) {
+    data->pairs_u32[i].key = data->source_u32[i];
+    data->pairs_u32[i].index = i;
+  }
+  qsort(data->pairs_u32, count, sizeof(pair_u32_t), compare_pair_u32);
+  return ggf_platform_get_time() - start;
+}
+
+internal_func f64 benchmark_radix_u32(benchmark_data_t *data, u32 count) {
+  f64 start = ggf_platform_get_time();
+  ggf_memory_copy(data->keys_u32, data->source_u32, sizeof(u32) * count);
+  for (u32 i = 0; i < count; i++) {
+    data->indices[i] = i;
+  }
+  ggf_radix_sort_u32(count, data->keys_u32, data->indices, NULL);
+  return ggf_platform_get_time() - start;
+}
+
+internal_func f64 benchmark_qsort_u64(benchmark_data_t *data, u32 count) {
+  f64 start = ggf_platform_get_time();
+  for (u32 i = 0; i < count; i++) {
+    data->pairs_u64[i].key = data->source_u64[i];
+    data->pairs_u64[i].index = i;
+  }
+  qsort(data->pairs_u64, count, sizeof(pair_u64_t), compare_pair_u64);
+  return ggf_platform_get_time() - start;
+}
+
+internal_func f64 benchmark_radix_u64(benchmark_data_t *data, u32 count) {
+  f64 start = ggf_platform_get_time();
+  ggf_memory_copy(data->keys_u64, data->source_u64, sizeof(u64) * count);
+  for (u32 i = 0; i < count; i++) {
+    data->indices[i] = i;
+  }
+  ggf_radix_sort_u64(count, data->keys_u64, data->indices, NULL);
+  return ggf_platform_get_time() - start;
+}
+
+typedef struct {
+  vec2 *positions;
+  vec2 *sizes;
+  f32 *depths;
+  vec4 *colors;
+} benchmark_quads_t;
+
+internal_func f64 benchmark_quads_single(benchmark_quads_t *quads, u32 count) {
+  f64 start = ggf_platform_get_time();
+  for (u32 i = 0; i < count; i++) {
+    ggf_draw_quad_extent(quads->positions[i], quads->sizes[i],
+                         quads->depths[i], quads->colors[i], NULL);
+  }
+  return ggf_platform_get_time() - start;
+}
+
+internal_func f64 benchmark_quads_bulk(benchmark_quads_t *quads, u32 count) {
+  f64 start = ggf_platform_get_time();
+  ggf_gfx_draw_quads(count, quads->positions, quads->sizes, quads->depths,
+                     quads->colors, NULL);
+  return ggf_platform_get_time() - start;
+}
+
+// field by field, the bytes between fields are not part of an instance
+internal_func b32 benchmark_instances_equal(ggf_sprite_instance_t *a,
+                                           ggf_sprite_instance_t *b) {
+  return a->position[0] == b->position[0] &&
+         a->position[1] == b->position[1] && a->size[0] == b->size[0] &&
+         a->size[1] == b->size[1] && a->rotation == b->rotation &&
+         a->depth == b->depth && a->color == b->color &&
+         a->uv_rect[0] == b->uv_rect[0] && a->uv_rect[1] == b->uv_rect[1] &&
+         a->uv_rect[2] == b->uv_rect[2] && a->uv_rect[3] == b->uv_rect[3] &&
+         a->texture_index == b->texture_index;
+}
+
+// the first count commands were recorded call by call, the next count in bulk
+internal_func b32 benchmark_quads_match(u32 count) {
+  ggf_gfx_recorder_t *recorder = &((ggf_gfx_t *)ggf_data->gfx)->recorder;
+  if (ggf_darray_get_length(recorder->commands) != 2 * count)
+    return FALSE;
+  for (u32 i = 0; i < count; i++) {
+    ggf_gfx_command_t *a = &recorder->commands[i];
+    ggf_gfx_command_t *b = &recorder->commands[count + i];
+    if (recorder->command_keys[i] != recorder->command_keys[count + i] ||
+        a->texture != b->texture ||
+        !benchmark_instances_equal(
+            &recorder->sprite_instances[a->primitive],
+            &recorder->sprite_instances[b->primitive]))
+      return FALSE;
+  }
+  return TRUE;
+}
+
+typedef struct {
+  pthread_t thread;
+  ggf_gfx_recorder_t *recorder;
+  benchmark_quads_t *quads;
+  u32 first, count;
+  u8 layer;
+} benchmark_recording_t;
+
+internal_func void benchmark_record_quads(benchmark_quads_t *quads, u32 first,
+                                          u32 count) {
+  for (u32 i = first; i < first + count; i++) {
+    ggf_draw_quad_extent(quads->positions[i], quads->sizes[i],
+                         quads->depths[i], quads->colors[i], NULL);
+  }
+}
+
+internal_func void *benchmark_recording_thread(void *usr) {
+  benchmark_recording_t *recording = usr;
+  ggf_gfx_recorder_begin(recording->recorder);
+  ggf_gfx_set_layer(recording->layer);
+  benchmark_record_quads(recording->quads, recording->first,
+                         recording->count);
+  ggf_gfx_recorder_end();
+  return NULL;
+}
+
+// the same count quads as recordings, serially on the main thread
+internal_func f64
+benchmark_recorders_serial(benchmark_recording_t *recordings) {
+  f64 start = ggf_platform_get_time();
+  for (u32 i = 0; i < BENCHMARK_RECORDERS; i++) {
+    ggf_gfx_set_layer(recordings[i].layer);
+    benchmark_record_quads(recordings[i].quads, recordings[i].first,
+                           recordings[i].count);
+  }
+  ggf_gfx_set_layer(0);
+  return ggf_platform_get_time() - start;
+}
+
+// started last to first so that they tend to finish out of order, submitted
+// first to last
+internal_func f64 benchmark_recorders_threaded(
+    benchmark_recording_t *recordings) {
+  f64 start = ggf_platform_get_time();
+  for (i32 i = BENCHMARK_RECORDERS - 1; i >= 0; i--) {
+    pthread_create(&recordings[i].thread, NULL, benchmark_recording_thread,
+                   &recordings[i]);
+  }
+  for (i32 i = BENCHMARK_RECORDERS - 1; i >= 0; i--) {
+    pthread_join(recordings[i].thread, NULL);
+  }
+  for (u32 i = 0; i < BENCHMARK_RECORDERS; i++) {
+    ggf_gfx_submit_recorder(recordings[i].recorder);
+  }
+  return ggf_platform_get_time() - start;
+}
+
+// draws the sprites of a frame, from the textures or else the array's layers,
+// and waits for the GPU
+internal_func f64 benchmark_fill_frame(ggf_texture_t *textures,
+                                       ggf_texture_array_t *array) {
+  f64 start = ggf_platform_get_time();
+  vec2 size = {BENCHMARK_WIDTH, BENCHMARK_HEIGHT};
+  vec4 color = {1.0f, 1.0f, 1.0f, 1.0f};
+  vec4 uv_rect = {0.0f, 0.0f, 1.0f, 1.0f};
+  for (u32 i = 0; i < BENCHMARK_FILL_SPRITES; i++) {
+    u32 texture = i % BENCHMARK_FILL_TEXTURES;
+    if (textures)
+      ggf_gfx_draw_sprite((vec2){0.0f, 0.0f}, size, 0.0f, 0.0f, color, uv_rect,
+                          &textures[texture]);
+    else
+      ggf_gfx_draw_sprite_layer((vec2){0.0f, 0.0f}, size, 0.0f, 0.0f, color,
+                                uv_rect, array, texture);
+  }
+  ggf_gfx_flush();
+  glFinish();
+  return ggf_platform_get_time() - start;
+}
+
+i32 main(i32 argc, char **argv) {
+  ggf_init(argc, argv);
+
+  benchmark_data_t data;
+  u32 max_count = BENCHMARK_MAX_COUNT;
+  data.source_u32 =
+      ggf_memory_alloc(sizeof(u32) * max_count, GGF_MEMORY_TAG_GAME);
+  data.source_u64 =
+      ggf_memory_alloc(sizeof(u64) * max_count, GGF_MEMORY_TAG_GAME);
+  data.keys_u32 =
+      ggf_memory_alloc(sizeof(u32) * max_count, GGF_MEMORY_TAG_GAME);
+  data.keys_u64 =
+      ggf_memory_alloc(sizeof(u64) * max_count, GGF_MEMORY_TAG_GAME);
+  data.indices =
+      ggf_memory_alloc(sizeof(u32) * max_count, GGF_MEMORY_TAG_GAME);
+  data.pairs_u32 =
+      ggf_memory_alloc(sizeof(pair_u32_t) * max_count, GGF_MEMORY_TAG_GAME);
+  data.pairs_u64 =
+      ggf_memory_alloc(sizeof(pair_u64_t) * max_count, GGF_MEMORY_TAG_GAME);
+
+  // ggf_randi gives 31 bits, so combine a few for full width keys
+  for (u32 i = 0; i < max_count; i++) {
+    u32 seed = i * 4;
+    data.source_u32[i] = ggf_randi(seed) ^ (ggf_randi(seed + 1) << 16);
+    data.source_u64[i] =
+        ((u64)ggf_randi(seed + 2) << 33) ^ ((u64)ggf_randi(seed + 3) << 2);
+  }
+
+  for (u32 count = 1000; count <= max_count; count *= 10) {
+    f64 qsort_u32 = 0.0, radix_u32 = 0.0, qsort_u64 = 0.0, radix_u64 = 0.0;
+    for (u32 run = 0; run < BENCHMARK_RUNS; run++) {
+      // the radix sorts take their scratch memory from the frame allocator
+      ggf_linear_allocator_reset(ggf_get_frame_allocator());
+
+      qsort_u32 += benchmark_qsort_u32(&data, count);
+      radix_u32 += benchmark_radix_u32(&data, count);
+      qsort_u64 += benchmark_qsort_u64(&data, count);
+      radix_u64 += benchmark_radix_u64(&data, count);
+    }
+
+    // radix sort is stable and qsort breaks ties by index, so the orders
+    // must match. indices holds the payload of the last (u64) sort.
+    for (u32 i = 0; i < count; i++) {
+      if (data.keys_u32[i] != data.pairs_u32[i].key ||
+          data.keys_u64[i] != data.pairs_u64[i].key ||
+          data.indices[i] != data.pairs_u64[i].index) {
+        GGF_ERROR("ERROR - benchmark: radix sort result differs from qsort "
+                  "at %u",
+                  i);
+        return 1;
+      }
+    }
+
+    f64 to_ms = 1000.0 / BENCHMARK_RUNS;
+    GGF_INFO("%7u elements | u32: qsort %8.3f ms, radix %7.3f ms (%5.1fx) | "
+             "u64: qsort %8.3f ms, radix %7.3f ms (%5.1fx)",
+             count, qsort_u32 * to_ms, radix_u32 * to_ms,
+             qsort_u32 / radix_u32, qsort_u64 * to_ms, radix_u64 * to_ms,
+             qsort_u64 / radix_u64);
+  }
+
+  ggf_memory_free(data.source_u32);
+  ggf_memory_free(data.source_u64);
+  ggf_memory_free(data.keys_u32);
+  ggf_memory_free(data.keys_u64);
+  ggf_memory_free(data.indices);
+  ggf_memory_free(data.pairs_u32);
+  ggf_memory_free(data.pairs_u64);
+
+  // recording needs the renderer, so a window for its context
+  ggf_window_t *window =
+      ggf_window_create("benchmark", BENCHMARK_WIDTH, BENCHMARK_HEIGHT);
+  ggf_gfx_init(BENCHMARK_WIDTH, BENCHMARK_HEIGHT);
+  // both runs of the largest count stay recorded, nothing is flushed
+  ggf_gfx_set_max_commands(2 * BENCHMARK_MAX_QUADS);
+
+  benchmark_quads_t quads;
+  u32 max_quads = BENCHMARK_MAX_QUADS;
+  quads.positions =
+      ggf_memory_alloc(sizeof(vec2) * max_quads, GGF_MEMORY_TAG_GAME);
+  quads.sizes = ggf_memory_alloc(sizeof(vec2) * max_quads, GGF_MEMORY_TAG_GAME);
+  quads.depths = ggf_memory_alloc(sizeof(f32) * max_quads, GGF_MEMORY_TAG_GAME);
+  quads.colors =
+      ggf_memory_alloc(sizeof(vec4) * max_quads, GGF_MEMORY_TAG_GAME);
+  for (u32 i = 0; i < max_quads; i++) {
+    u32 seed = i * 4;
+    quads.positions[i][0] = ggf_randf(seed) * BENCHMARK_WIDTH;
+    quads.positions[i][1] = ggf_randf(seed + 1) * BENCHMARK_HEIGHT;
+    quads.sizes[i][0] = quads.sizes[i][1] = 4.0f + ggf_randf(seed + 2) * 12.0f;
+    quads.depths[i] = ggf_randf(seed + 3) * 198.0f - 99.0f;
+    glm_vec4_copy((vec4){ggf_randf(seed), ggf_randf(seed + 1), 1.0f, 1.0f},
+                  quads.colors[i]);
+  }
+
+  ggf_gfx_recorder_t *recorder = &((ggf_gfx_t *)ggf_data->gfx)->recorder;
+  for (u32 count = 1000; count <= max_quads; count *= 10) {
+    f64 single = 0.0, bulk = 0.0;
+    for (u32 run = 0; run < BENCHMARK_RUNS; run++) {
+      ggf_internal_gfx_recorder_clear(recorder);
+      single += benchmark_quads_single(&quads, count);
+      bulk += benchmark_quads_bulk(&quads, count);
+    }
+
+    if (!benchmark_quads_match(count)) {
+      GGF_ERROR("ERROR - benchmark: ggf_gfx_draw_quads recorded different "
+                "commands than ggf_draw_quad_extent");
+      return 1;
+    }
+    ggf_internal_gfx_recorder_clear(recorder);
+
+    f64 to_ms = 1000.0 / BENCHMARK_RUNS;
+    GGF_INFO("%7u quads | per call %7.3f ms (%7.0f quads/ms) | bulk %7.3f ms "
+             "(%7.0f quads/ms) (%5.1fx)",
+             count, single * to_ms, count / (single * to_ms), bulk * to_ms,
+             count / (bulk * to_ms), single / bulk);
+  }
+
+  benchmark_recording_t recordings[BENCHMARK_RECORDERS];
+  for (u32 i = 0; i < BENCHMARK_RECORDERS; i++) {
+    recordings[i].recorder = ggf_gfx_recorder_create();
+    recordings[i].quads = &quads;
+    recordings[i].layer = (u8)(BENCHMARK_RECORDERS - i);
+  }
+  for (u32 count = 1000; count <= max_quads; count *= 10) {
+    for (u32 i = 0; i < BENCHMARK_RECORDERS; i++) {
+      recordings[i].first = count * i / BENCHMARK_RECORDERS;
+      recordings[i].count =
+          count * (i + 1) / BENCHMARK_RECORDERS - recordings[i].first;
+    }
+
+    f64 serial = 0.0, threaded = 0.0;
+    for (u32 run = 0; run < BENCHMARK_RUNS; run++) {
+      ggf_internal_gfx_recorder_clear(recorder);
+      serial += benchmark_recorders_serial(recordings);
+      threaded += benchmark_recorders_threaded(recordings);
+    }
+
+    if (!benchmark_quads_match(count)) {
+      GGF_ERROR("ERROR - benchmark: recorders submitted different commands "
+                "than the main thread recorded");
+      return 1;
+    }
+    ggf_internal_gfx_recorder_clear(recorder);
+
+    f64 to_ms = 1000.0 / BENCHMARK_RUNS;
+    GGF_INFO("%7u quads | main thread %7.3f ms (%7.0f quads/ms) | %u "
+             "recorders %7.3f ms (%7.0f quads/ms) (%5.1fx)",
+             count, serial * to_ms, count / (serial * to_ms),
+             BENCHMARK_RECORDERS, threaded * to_ms, count / (threaded * to_ms),
+             serial / threaded);
+  }
+
+  // every recorder alone holds more than max_commands, so submitting them
+  // takes flushes of max_commands each
+  ggf_gfx_t *gfx = ggf_data->gfx;
+  u32 max_commands = recordings[0].count / 3;
+  ggf_gfx_set_max_commands(max_commands);
+  u32 flushes =
+      gfx->stats.flush_reasons[GGF_GFX_FLUSH_REASON_COMMAND_CAPACITY];
+  benchmark_recorders_threaded(recordings);
+  flushes =
+      gfx->stats.flush_reasons[GGF_GFX_FLUSH_REASON_COMMAND_CAPACITY] - flushes;
+  u32 unflushed = ggf_internal_gfx_unflushed_commands(gfx);
+  if (unflushed > max_commands ||
+      (u64)flushes * max_commands < max_quads - unflushed) {
+    GGF_ERROR("ERROR - benchmark: ggf_gfx_submit_recorder flushed %u "
+              "commands in %u flushes, max_commands is %u",
+              max_quads - unflushed, flushes, max_commands);
+    return 1;
+  }
+  ggf_internal_gfx_recorder_clear(recorder);
+  for (u32 i = 0; i < BENCHMARK_RECORDERS; i++) {
+    ggf_gfx_recorder_destroy(recordings[i].recorder);
+  }
+
+  // the same pixels as separate textures and as the layers of an array
+  u32 texture_pixels =
+      BENCHMARK_FILL_TEXTURE_SIZE * BENCHMARK_FILL_TEXTURE_SIZE;
+  u32 *pixels = ggf_memory_alloc(
+      sizeof(u32) * texture_pixels * BENCHMARK_FILL_TEXTURES,
+      GGF_MEMORY_TAG_GAME);
+  for (u32 i = 0; i < texture_pixels * BENCHMARK_FILL_TEXTURES; i++) {
+    pixels[i] = ggf_randi(i) | 0xFF000000;
+  }
+  ggf_texture_t textures[BENCHMARK_FILL_TEXTURES];
+  for (u32 i = 0; i < BENCHMARK_FILL_TEXTURES; i++) {
+    ggf_texture_create(pixels + texture_pixels * i, GGF_TEXTURE_FORMAT_RGBA8,
+                       BENCHMARK_FILL_TEXTURE_SIZE,
+                       BENCHMARK_FILL_TEXTURE_SIZE, GGF_TEXTURE_FILTER_LINEAR,
+                       GGF_TEXTURE_WRAP_REPEAT, &textures[i]);
+  }
+  ggf_texture_array_t array;
+  ggf_texture_array_create(pixels, GGF_TEXTURE_FORMAT_RGBA8,
+                           BENCHMARK_FILL_TEXTURE_SIZE,
+                           BENCHMARK_FILL_TEXTURE_SIZE, BENCHMARK_FILL_TEXTURES,
+                           GGF_TEXTURE_FILTER_LINEAR, GGF_TEXTURE_WRAP_REPEAT,
+                           &array);
+  ggf_memory_free(pixels);
+
+  ggf_camera_t camera = {0};
+  glm_ortho(0.0f, BENCHMARK_WIDTH, BENCHMARK_HEIGHT, 0.0f, -100.0f, 100.0f,
+            camera.view_projection);
+  ggf_gfx_set_camera(&camera);
+  // the first frame of each compiles and uploads, so it is not timed
+  benchmark_fill_frame(textures, NULL);
+  benchmark_fill_frame(NULL, &array);
+  f64 units = 0.0, layers = 0.0;
+  for (u32 run = 0; run < BENCHMARK_RUNS; run++) {
+    units += benchmark_fill_frame(textures, NULL);
+    layers += benchmark_fill_frame(NULL, &array);
+  }
+  f64 megapixels = (f64)BENCHMARK_WIDTH * BENCHMARK_HEIGHT *
+                   BENCHMARK_FILL_SPRITES * BENCHMARK_RUNS / 1000000.0;
+  GGF_INFO("fill %ux%u, %u sprites over %u textures | texture units %7.1f "
+           "Mpix/s | texture array %7.1f Mpix/s (%5.2fx)",
+           BENCHMARK_WIDTH, BENCHMARK_HEIGHT, BENCHMARK_FILL_SPRITES,
+           BENCHMARK_FILL_TEXTURES, megapixels / units, megapixels / layers,
+           units / layers);
+
+  for (u32 i = 0; i < BENCHMARK_FILL_TEXTURES; i++) {
+    ggf_texture_destroy(&textures[i]);
+  }
+  ggf_texture_array_destroy(&array);
+  ggf_memory_free(quads.positions);
+  ggf_memory_free(quads.sizes);
+  ggf_memory_free(quads.depths);
+  ggf_memory_free(quads.colors);
+  ggf_gfx_shutdown();
+  ggf_window_destroy(window);
+
+  ggf_shutdown();
+  return 0;
+}
@@ -90,8 +90,6 @@ i32 find_empty_card_index(i32 *deck) {
 
 // tar in en array och kastar runt innehållet.
 void shuffle(int *array, size_t n) {
-  time_t seed = time(NULL);
-
   if (n > 1) {
     for (i32 i = n - 1; i > 0; --i) {
       u32 j = get_rand(i);
@@ -293,7 +291,10 @@ i32 main(i32 argc, char **argv) {
 
   f32 dt = 1.0f / 60.0f; // antalet sekunder per frame.
   while (ggf_window_is_open(window)) {
+    GGF_PROFILE_SCOPE("frame");
     ggf_poll_events();
+    if (ggf_input_key_pressed(GGF_KEY_F9))
+      ggf_profile_dump("trace.json"); // spara en profil
 
     ggf_gfx_set_clear_color((vec3){0.1f, 0.3f, 0.1f}); // bakgrunsfärg
 
@@ -3,16 +3,32 @@
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
 
+#ifdef GGF_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
 #define GLAD_IMPL
 #include <glad_impl.h>
 
 #include <pthread.h>
 #include <stdarg.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 #ifdef GGF_OSX
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
 #elif GGF_WINDOWS
 #include <Windows.h>
 #endif
@@ -39,6 +55,15 @@ typedef struct {
   char **argv;
   GLFWwindow
       *first_window; // first window created. used for context object sharing.
+  b32 headless;     // --headless, windows are offscreen EGL surfaces
+  u32 frame_limit;  // --frames, 0 for none
+  u32 swapped_frames;
+  b32 gl_buffer_storage; // glBufferStorage, GL 4.4 or GL_ARB_buffer_storage
+#ifdef GGF_EGL
+  EGLDisplay egl_display;
+  EGLConfig egl_config;
+  EGLContext egl_first_context; // headless counterpart of first_window
+#endif
 
   // Memory
   struct {
@@ -57,6 +82,10 @@ typedef struct {
 
   u64 string_hash_pows[GGF_STRING_HASH_MAX_LEN];
 
+  ggf_linear_allocator_t frame_allocator;
+
+  void *strings;
+
   void *input;
 
   void *assets;
@@ -73,10 +102,21 @@ ggf_input_system_set_mouse_button_state(ggf_mouse_button_t button, b8 is_down);
 internal_func void ggf_input_system_set_mouse_position(i32 x, i32 y);
 internal_func void ggf_input_system_set_mouse_wheel(i32 x, i32 y);
 
+internal_func b32 ggf_internal_string_table_init();
+internal_func void ggf_internal_string_table_shutdown();
+
 internal_func b32 ggf_asset_system_init();
 internal_func void ggf_asset_system_shutdown();
 
 internal_func void ggf_gfx_resize(u32 width, u32 height);
+internal_func b32 ggf_internal_gfx_submit_frame(ggf_window_t *window);
+
+internal_func b32 ggf_internal_headless_init();
+internal_func void ggf_internal_headless_shutdown();
+
+#ifdef GGF_ENABLE_PROFILER
+internal_func void ggf_internal_profiler_shutdown();
+#endif
 
 global_variable ggf_t *ggf_data = NULL;
 
@@ -90,6 +130,7 @@ internal_func u64 ggf_internal_memory_intptr_hash(void *val) {
 
 b32 ggf_init(i32 argc, char **argv) {
   GGF_DEBUG("GGF INIT");
+  GGF_PROFILE_THREAD_NAME("main");
 
   u32 config_total_alloc_size = GGF_GIGABYTES(1);
   u32 ggf_data_size = sizeof(ggf_t);
@@ -134,12 +175,29 @@ b32 ggf_init(i32 argc, char **argv) {
 
   ggf_data->argc = argc;
   ggf_data->argv = argv;
+  for (i32 i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--headless") == 0) {
+      ggf_data->headless = TRUE;
+    } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      ggf_data->frame_limit = (u32)strtoul(argv[++i], NULL, 10);
+    }
+  }
 
-  if (glfwInit() != GLFW_TRUE) {
+  if (ggf_data->headless) {
+    if (!ggf_internal_headless_init()) {
+      GGF_FATAL("Failed to init headless mode!");
+      return FALSE;
+    }
+  } else if (glfwInit() != GLFW_TRUE) {
     GGF_FATAL("Failed to init GLFW!");
     return FALSE;
   }
 
+  ggf_linear_allocator_create(GGF_FRAME_ALLOCATOR_SIZE, NULL,
+                              &ggf_data->frame_allocator);
+
+  ggf_internal_string_table_init();
+
   if (!ggf_asset_system_init()) {
     GGF_FATAL("Failed to init assets system!");
     return FALSE;
@@ -165,8 +223,15 @@ void ggf_shutdown() {
 
   ggf_asset_system_shutdown();
 
+  ggf_internal_string_table_shutdown();
+
+  ggf_linear_allocator_destroy(&ggf_data->frame_allocator);
+
   // window
-  glfwTerminate();
+  if (ggf_data->headless)
+    ggf_internal_headless_shutdown();
+  else
+    glfwTerminate();
 
   // memory
 
@@ -182,6 +247,10 @@ void ggf_shutdown() {
 
   ggf_dynamic_allocator_destroy(&ggf_data->memory.allocator);
   ggf_platform_mem_free(ggf_data);
+
+#ifdef GGF_ENABLE_PROFILER
+  ggf_internal_profiler_shutdown();
+#endif
 }
 
 // snap
@@ -237,7 +306,6 @@ u32 ggf_randi(u32 seed) {
 
 // hash
 u64 ggf_hash_string(const char *str) {
-  const u32 p = 31;
   const u32 m = 1e9 + 9;
   u64 hash_value = 0;
   u64 pow_i = 0;
@@ -247,6 +315,188 @@ u64 ggf_hash_string(const char *str) {
   return hash_value;
 }
 
+// string interning
+
+#define GGF_STRING_CHUNK_SIZE (64 * 1024)
+#define GGF_STRING_INITIAL_SLOT_COUNT 1024
+
+typedef struct {
+  u32 hash;
+  u32 length;
+  const char *str;
+} ggf_internal_string_entry_t;
+
+typedef struct {
+  pthread_rwlock_t lock;
+  ggf_internal_string_entry_t *entries; // darray, indexed by id
+  ggf_linear_allocator_t *chunks;       // darray, string storage
+  u32 *slots; // open addressing table of ids, GGF_INVALID_ID when empty
+  u32 slot_count;
+} ggf_internal_string_table_t;
+
+internal_func u32 ggf_internal_string_hash(const char *str, u32 *out_length) {
+  // FNV-1a
+  u32 hash = 2166136261u;
+  const char *c = str;
+  for (; *c; c++) {
+    hash = (hash ^ (u8)*c) * 16777619u;
+  }
+  *out_length = c - str;
+  return hash;
+}
+
+b32 ggf_internal_string_table_init() {
+  ggf_data->strings = ggf_memory_alloc(sizeof(ggf_internal_string_table_t),
+                                       GGF_MEMORY_TAG_STRING);
+  ggf_internal_string_table_t *table =
+      (ggf_internal_string_table_t *)ggf_data->strings;
+
+  pthread_rwlock_init(&table->lock, NULL);
+  table->entries = ggf_darray_create(GGF_STRING_INITIAL_SLOT_COUNT / 2,
+                                     sizeof(ggf_internal_string_entry_t));
+  table->chunks = ggf_darray_create(4, sizeof(ggf_linear_allocator_t));
+  table->slot_count = GGF_STRING_INITIAL_SLOT_COUNT;
+  table->slots = ggf_memory_alloc(sizeof(u32) * table->slot_count,
+                                  GGF_MEMORY_TAG_STRING);
+  ggf_memory_set(table->slots, 0xFF, sizeof(u32) * table->slot_count);
+  return TRUE;
+}
+
+void ggf_internal_string_table_shutdown() {
+  ggf_internal_string_table_t *table =
+      (ggf_internal_string_table_t *)ggf_data->strings;
+
+  for (u64 i = 0; i < ggf_darray_get_length(table->chunks); i++) {
+    ggf_linear_allocator_destroy(&table->chunks[i]);
+  }
+  ggf_darray_destroy(table->chunks);
+  ggf_darray_destroy(table->entries);
+  ggf_memory_free(table->slots);
+  pthread_rwlock_destroy(&table->lock);
+  ggf_memory_free(ggf_data->strings);
+}
+
+// returns the slot holding str, or the empty slot where it would go
+internal_func u32 *
+ggf_internal_string_table_probe(ggf_internal_string_table_t *table,
+                                const char *str, u32 hash, u32 length) {
+  u32 mask = table->slot_count - 1;
+  for (u32 idx = hash & mask;; idx = (idx + 1) & mask) {
+    u32 id = table->slots[idx];
+    if (id == GGF_INVALID_ID)
+      return &table->slots[idx];
+    ggf_internal_string_entry_t *entry = &table->entries[id];
+    if (entry->hash == hash && entry->length == length &&
+        memcmp(entry->str, str, length) == 0)
+      return &table->slots[idx];
+  }
+}
+
+internal_func void
+ggf_internal_string_table_grow(ggf_internal_string_table_t *table) {
+  ggf_memory_free(table->slots);
+  table->slot_count *= 2;
+  table->slots = ggf_memory_alloc(sizeof(u32) * table->slot_count,
+                                  GGF_MEMORY_TAG_STRING);
+  ggf_memory_set(table->slots, 0xFF, sizeof(u32) * table->slot_count);
+
+  u32 mask = table->slot_count - 1;
+  for (u32 id = 0; id < ggf_darray_get_length(table->entries); id++) {
+    u32 idx = table->entries[id].hash & mask;
+    while (table->slots[idx] != GGF_INVALID_ID)
+      idx = (idx + 1) & mask;
+    table->slots[idx] = id;
+  }
+}
+
+internal_func char *
+ggf_internal_string_table_store(ggf_internal_string_table_t *table,
+                                const char *str, u32 length) {
+  u64 chunk_count = ggf_darray_get_length(table->chunks);
+  ggf_linear_allocator_t *chunk =
+      chunk_count ? &table->chunks[chunk_count - 1] : NULL;
+  if (!chunk || chunk->marker + length + 1 > chunk->size) {
+    ggf_linear_allocator_t new_chunk;
+    ggf_linear_allocator_create(GGF_MAX(GGF_STRING_CHUNK_SIZE, length + 1),
+                                NULL, &new_chunk);
+    table->chunks = ggf_darray_push(table->chunks, &new_chunk);
+    chunk = &table->chunks[chunk_count];
+  }
+
+  char *stored = ggf_linear_allocator_alloc(chunk, length + 1);
+  ggf_memory_copy(stored, (void *)str, length + 1);
+  return stored;
+}
+
+ggf_string_id_t ggf_string_intern(const char *str) {
+  ggf_internal_string_table_t *table =
+      (ggf_internal_string_table_t *)ggf_data->strings;
+  u32 length;
+  u32 hash = ggf_internal_string_hash(str, &length);
+
+  pthread_rwlock_rdlock(&table->lock);
+  ggf_string_id_t id =
+      *ggf_internal_string_table_probe(table, str, hash, length);
+  pthread_rwlock_unlock(&table->lock);
+  if (id != GGF_INVALID_ID)
+    return id;
+
+  pthread_rwlock_wrlock(&table->lock);
+  // another thread may have added it between the locks
+  u32 *slot = ggf_internal_string_table_probe(table, str, hash, length);
+  id = *slot;
+  if (id == GGF_INVALID_ID) {
+    ggf_internal_string_entry_t entry;
+    entry.hash = hash;
+    entry.length = length;
+    entry.str = ggf_internal_string_table_store(table, str, length);
+    id = *slot = ggf_darray_get_length(table->entries);
+    table->entries = ggf_darray_push(table->entries, &entry);
+
+    // keep the load factor under one half
+    if (ggf_darray_get_length(table->entries) * 2 > table->slot_count)
+      ggf_internal_string_table_grow(table);
+  }
+  pthread_rwlock_unlock(&table->lock);
+
+  return id;
+}
+
+ggf_string_id_t ggf_string_find(const char *str) {
+  ggf_internal_string_table_t *table =
+      (ggf_internal_string_table_t *)ggf_data->strings;
+  u32 length;
+  u32 hash = ggf_internal_string_hash(str, &length);
+
+  pthread_rwlock_rdlock(&table->lock);
+  ggf_string_id_t id =
+      *ggf_internal_string_table_probe(table, str, hash, length);
+  pthread_rwlock_unlock(&table->lock);
+  return id;
+}
+
+const char *ggf_string_get(ggf_string_id_t id) {
+  ggf_internal_string_table_t *table =
+      (ggf_internal_string_table_t *)ggf_data->strings;
+
+  pthread_rwlock_rdlock(&table->lock);
+  GGF_ASSERT(id < ggf_darray_get_length(table->entries));
+  const char *str = table->entries[id].str;
+  pthread_rwlock_unlock(&table->lock);
+  return str;
+}
+
+u32 ggf_string_get_length(ggf_string_id_t id) {
+  ggf_internal_string_table_t *table =
+      (ggf_internal_string_table_t *)ggf_data->strings;
+
+  pthread_rwlock_rdlock(&table->lock);
+  GGF_ASSERT(id < ggf_darray_get_length(table->entries));
+  u32 length = table->entries[id].length;
+  pthread_rwlock_unlock(&table->lock);
+  return length;
+}
+
 // platform layer
 
 void *ggf_platform_mem_alloc(u64 size) { return malloc(size); }
@@ -280,6 +530,69 @@ void ggf_platform_mem_set(void *memory, i32 value, u64 size) {
   memset(memory, value, size);
 }
 
+void ggf_platform_futex_wait(u32 *address, u32 expected) {
+#ifdef __linux__
+  syscall(SYS_futex, address, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+#elif GGF_WINDOWS
+  WaitOnAddress(address, &expected, sizeof(u32), INFINITE);
+#else
+  // no futex available - back off briefly and let the caller re-check
+  if (__atomic_load_n(address, __ATOMIC_ACQUIRE) == expected)
+    usleep(100);
+#endif
+}
+
+void ggf_platform_futex_wake(u32 *address, b32 wake_all) {
+#ifdef __linux__
+  syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, wake_all ? INT32_MAX : 1,
+          NULL, NULL, 0);
+#elif GGF_WINDOWS
+  if (wake_all)
+    WakeByAddressAll(address);
+  else
+    WakeByAddressSingle(address);
+#endif
+}
+
+f64 ggf_platform_get_time() {
+#ifdef GGF_OSX
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+#elif GGF_WINDOWS
+  local_persist f64 seconds_per_tick = 0.0;
+  if (seconds_per_tick == 0.0) {
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    seconds_per_tick = 1.0 / frequency.QuadPart;
+  }
+  LARGE_INTEGER now;
+  QueryPerformanceCounter(&now);
+  return now.QuadPart * seconds_per_tick;
+#endif
+}
+
+u64 ggf_platform_get_time_ns() {
+#ifdef GGF_OSX
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+  return (u64)now.tv_sec * 1000000000ull + now.tv_nsec;
+#elif GGF_WINDOWS
+  local_persist u64 frequency = 0;
+  if (frequency == 0) {
+    LARGE_INTEGER value;
+    QueryPerformanceFrequency(&value);
+    frequency = value.QuadPart;
+  }
+  LARGE_INTEGER now;
+  QueryPerformanceCounter(&now);
+  // split so that the multiplication can't overflow
+  u64 seconds = now.QuadPart / frequency;
+  u64 remainder = now.QuadPart % frequency;
+  return seconds * 1000000000ull + remainder * 1000000000ull / frequency;
+#endif
+}
+
 void ggf_platform_console_write(ggf_platform_console_color_t fg_color,
                                 const char *message, ...) {
   va_list args;
@@ -301,10 +614,209 @@ void ggf_platform_console_write_error(ggf_platform_console_color_t fg_color,
 }
 
 void ggf_poll_events() {
+  GGF_PROFILE_SCOPE("ggf_poll_events");
+  ggf_linear_allocator_reset(&ggf_data->frame_allocator);
   ggf_input_system_update();
 
-  glfwPollEvents();
+  if (!ggf_data->headless)
+    glfwPollEvents();
+}
+
+// profiler
+
+/*
+    each thread that closes a zone gets a ring of finished zones, pushed onto
+   a global list the first time. only the owning thread writes its ring, it
+   publishes zones by bumping `count`. a dump copies a ring and then drops the
+   zones that may have been overwritten while it was copying. rings live
+   outside the tracked memory, so that profiling ggf_memory_alloc can't
+   recurse into it.
+*/
+
+#ifdef GGF_ENABLE_PROFILER
+typedef struct {
+  const char *name;
+  u64 start, end; // ns
+} ggf_internal_profile_record_t;
+
+typedef struct ggf_internal_profile_thread_t {
+  struct ggf_internal_profile_thread_t *next;
+  const char *name;
+  u32 id;
+  u64 count; // zones ever recorded
+  ggf_internal_profile_record_t records[GGF_PROFILER_ZONES_PER_THREAD];
+} ggf_internal_profile_thread_t;
+
+global_variable ggf_internal_profile_thread_t *ggf_profile_threads = NULL;
+global_variable u32 ggf_profile_thread_count = 0;
+global_variable __thread ggf_internal_profile_thread_t *ggf_profile_thread =
+    NULL;
+
+internal_func ggf_internal_profile_thread_t *ggf_internal_profile_get_thread() {
+  if (!ggf_profile_thread) {
+    ggf_internal_profile_thread_t *thread =
+        ggf_platform_mem_alloc(sizeof(ggf_internal_profile_thread_t));
+    thread->name = NULL;
+    thread->count = 0;
+    thread->id =
+        __atomic_fetch_add(&ggf_profile_thread_count, 1, __ATOMIC_RELAXED);
+    thread->next = __atomic_load_n(&ggf_profile_threads, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&ggf_profile_threads, &thread->next,
+                                        thread, TRUE, __ATOMIC_RELEASE,
+                                        __ATOMIC_RELAXED))
+      ;
+    ggf_profile_thread = thread;
+  }
+  return ggf_profile_thread;
+}
+
+ggf_profile_zone_t ggf_profile_zone_begin(const char *name) {
+  return (ggf_profile_zone_t){name, ggf_platform_get_time_ns()};
+}
+
+void ggf_profile_zone_end(ggf_profile_zone_t *zone) {
+  u64 end = ggf_platform_get_time_ns();
+  ggf_internal_profile_thread_t *thread = ggf_internal_profile_get_thread();
+
+  u64 count = thread->count;
+  ggf_internal_profile_record_t *record =
+      &thread->records[count % GGF_PROFILER_ZONES_PER_THREAD];
+  record->name = zone->name;
+  record->start = zone->start;
+  record->end = end;
+  __atomic_store_n(&thread->count, count + 1, __ATOMIC_RELEASE);
+}
+
+void ggf_profile_set_thread_name(const char *name) {
+  ggf_internal_profile_get_thread()->name = name;
+}
+
+typedef struct {
+  ggf_file_handle_t file;
+  char buffer[16384];
+  u64 length;
+  b32 ok;
+} ggf_internal_profile_writer_t;
+
+// appends to the writer's buffer, writing it out when it gets full
+internal_func void
+ggf_internal_profile_write(ggf_internal_profile_writer_t *writer,
+                           const char *format, ...) {
+  if (writer->length > sizeof(writer->buffer) - 512) {
+    u64 written = 0;
+    writer->ok = writer->ok && ggf_file_write(writer->file, writer->length,
+                                              writer->buffer, &written);
+    writer->length = 0;
+  }
+  va_list args;
+  va_start(args, format);
+  writer->length += vsnprintf(writer->buffer + writer->length,
+                              sizeof(writer->buffer) - writer->length, format,
+                              args);
+  va_end(args);
+}
+
+// index of the oldest zone still in a ring holding count zones
+internal_func u64 ggf_internal_profile_first_record(u64 count) {
+  return count > GGF_PROFILER_ZONES_PER_THREAD
+             ? count - GGF_PROFILER_ZONES_PER_THREAD
+             : 0;
+}
+
+b32 ggf_profile_dump(const char *filename) {
+  ggf_internal_profile_writer_t *writer =
+      ggf_platform_mem_alloc(sizeof(ggf_internal_profile_writer_t));
+  writer->file = ggf_file_open(filename, GGF_FILE_MODE_WRITE);
+  if (!writer->file) {
+    ggf_platform_mem_free(writer);
+    return FALSE;
+  }
+  writer->length = 0;
+  writer->ok = TRUE;
+  ggf_internal_profile_record_t *records = ggf_platform_mem_alloc(
+      sizeof(ggf_internal_profile_record_t) * GGF_PROFILER_ZONES_PER_THREAD);
+
+  // timestamps are written relative to the oldest zone
+  u64 base = GGF_INVALID_ID64;
+  for (ggf_internal_profile_thread_t *thread =
+           __atomic_load_n(&ggf_profile_threads, __ATOMIC_ACQUIRE);
+       thread; thread = thread->next) {
+    u64 count = __atomic_load_n(&thread->count, __ATOMIC_ACQUIRE);
+    u64 first = ggf_internal_profile_first_record(count);
+    if (first < count)
+      base = GGF_MIN(
+          base, thread->records[first % GGF_PROFILER_ZONES_PER_THREAD].start);
+  }
+
+  ggf_internal_profile_write(writer, "{\"traceEvents\":[");
+  const char *separator = "";
+  for (ggf_internal_profile_thread_t *thread =
+           __atomic_load_n(&ggf_profile_threads, __ATOMIC_ACQUIRE);
+       thread; thread = thread->next) {
+    if (thread->name) {
+      ggf_internal_profile_write(
+          writer,
+          "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,"
+          "\"args\":{\"name\":\"%s\"}}",
+          separator, thread->id, thread->name);
+      separator = ",";
+    }
+
+    u64 count = __atomic_load_n(&thread->count, __ATOMIC_ACQUIRE);
+    u64 first = ggf_internal_profile_first_record(count);
+    for (u64 i = first; i < count; i++) {
+      records[i - first] = thread->records[i % GGF_PROFILER_ZONES_PER_THREAD];
+    }
+    // the owner kept recording while we copied, skip what it overwrote
+    u64 valid = ggf_internal_profile_first_record(
+        __atomic_load_n(&thread->count, __ATOMIC_ACQUIRE));
+
+    for (u64 i = GGF_MAX(first, valid); i < count; i++) {
+      ggf_internal_profile_record_t *record = &records[i - first];
+      // zones are in end order, so a zone can start before the base
+      u64 start = GGF_MAX(record->start, base);
+      ggf_internal_profile_write(
+          writer,
+          "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,"
+          "\"ts\":%.3f,\"dur\":%.3f}",
+          separator, record->name, thread->id, (start - base) / 1000.0,
+          (record->end - start) / 1000.0);
+      separator = ",";
+    }
+  }
+  ggf_internal_profile_write(writer, "\n]}\n");
+
+  u64 written = 0;
+  b32 ok = writer->ok && ggf_file_write(writer->file, writer->length,
+                                        writer->buffer, &written);
+  ggf_file_close(writer->file);
+  ggf_platform_mem_free(records);
+  ggf_platform_mem_free(writer);
+
+  if (!ok)
+    GGF_ERROR("ERROR - ggf_profile_dump: failed to write '%s'", filename);
+  return ok;
+}
+
+// frees every thread's ring. threads other than the caller must be done.
+internal_func void ggf_internal_profiler_shutdown() {
+  ggf_internal_profile_thread_t *thread = ggf_profile_threads;
+  while (thread) {
+    ggf_internal_profile_thread_t *next = thread->next;
+    ggf_platform_mem_free(thread);
+    thread = next;
+  }
+  ggf_profile_threads = NULL;
+  ggf_profile_thread_count = 0;
+  ggf_profile_thread = NULL;
+}
+#else
+b32 ggf_profile_dump(const char *filename) {
+  GGF_WARN("WARNING - ggf_profile_dump: build with GGF_ENABLE_PROFILER to "
+           "record zones");
+  return FALSE;
 }
+#endif
 
 // window
 
@@ -341,7 +853,163 @@ internal_func void ggf_window_resize_callback(GLFWwindow *handle, i32 width,
   ggf_gfx_resize(width, height);
 }
 
+// the glad loader only knows core versions, so GL_ARB_buffer_storage (same
+// entry point as 4.4) is looked up here
+internal_func void ggf_internal_load_gl(GLADloadproc load) {
+  gladLoadGLLoader(load);
+  ggf_data->gl_buffer_storage = GLAD_GL_VERSION_4_4;
+  if (ggf_data->gl_buffer_storage)
+    return;
+
+  i32 extension_count = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &extension_count);
+  for (i32 i = 0; i < extension_count; i++) {
+    const char *extension = (const char *)glGetStringi(GL_EXTENSIONS, i);
+    if (extension && strcmp(extension, "GL_ARB_buffer_storage") == 0) {
+      glad_glBufferStorage = (PFNGLBUFFERSTORAGEPROC)load("glBufferStorage");
+      ggf_data->gl_buffer_storage = glad_glBufferStorage != NULL;
+      return;
+    }
+  }
+}
+
+/*
+    headless windows have no surface on screen: each one is an EGL pbuffer,
+   which gives its context an offscreen default framebuffer, so that gfx code
+   runs unchanged. the display is surfaceless (Mesa) when available and needs
+   neither an X server nor a GPU. only built with GGF_EGL (link with -lEGL).
+*/
+#ifdef GGF_EGL
+typedef struct {
+  EGLSurface surface;
+  EGLContext context;
+  b32 should_close;
+} ggf_internal_headless_window_t;
+
+internal_func b32 ggf_internal_headless_init() {
+  EGLDisplay display = EGL_NO_DISPLAY;
+  PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+      (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress(
+          "eglGetPlatformDisplayEXT");
+  if (get_platform_display)
+    display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA,
+                                   EGL_DEFAULT_DISPLAY, NULL);
+  if (display == EGL_NO_DISPLAY)
+    display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL)) {
+    GGF_ERROR("ERROR - ggf_internal_headless_init: no EGL display: %x",
+              eglGetError());
+    return FALSE;
+  }
+
+  EGLint config_attributes[] = {EGL_SURFACE_TYPE,
+                                EGL_PBUFFER_BIT,
+                                EGL_RENDERABLE_TYPE,
+                                EGL_OPENGL_BIT,
+                                EGL_RED_SIZE,
+                                8,
+                                EGL_GREEN_SIZE,
+                                8,
+                                EGL_BLUE_SIZE,
+                                8,
+                                EGL_ALPHA_SIZE,
+                                8,
+                                EGL_DEPTH_SIZE,
+                                24,
+                                EGL_NONE};
+  EGLint config_count = 0;
+  if (!eglBindAPI(EGL_OPENGL_API) ||
+      !eglChooseConfig(display, config_attributes, &ggf_data->egl_config, 1,
+                       &config_count) ||
+      config_count == 0) {
+    GGF_ERROR("ERROR - ggf_internal_headless_init: no OpenGL pbuffer config");
+    eglTerminate(display);
+    return FALSE;
+  }
+
+  ggf_data->egl_display = display;
+  return TRUE;
+}
+
+internal_func void ggf_internal_headless_shutdown() {
+  eglMakeCurrent(ggf_data->egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                 EGL_NO_CONTEXT);
+  eglTerminate(ggf_data->egl_display);
+}
+
+internal_func ggf_internal_headless_window_t *
+ggf_internal_headless_window_create(u32 width, u32 height) {
+  EGLint surface_attributes[] = {EGL_WIDTH, width, EGL_HEIGHT, height,
+                                 EGL_NONE};
+  EGLint context_attributes[] = {EGL_CONTEXT_MAJOR_VERSION,
+                                 3,
+                                 EGL_CONTEXT_MINOR_VERSION,
+                                 3,
+                                 EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                                 EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                 EGL_NONE};
+
+  EGLSurface surface = eglCreatePbufferSurface(
+      ggf_data->egl_display, ggf_data->egl_config, surface_attributes);
+  if (surface == EGL_NO_SURFACE)
+    return NULL;
+  EGLContext context = eglCreateContext(
+      ggf_data->egl_display, ggf_data->egl_config,
+      ggf_data->egl_first_context ? ggf_data->egl_first_context
+                                  : EGL_NO_CONTEXT,
+      context_attributes);
+  if (context == EGL_NO_CONTEXT) {
+    eglDestroySurface(ggf_data->egl_display, surface);
+    return NULL;
+  }
+  if (!ggf_data->egl_first_context)
+    ggf_data->egl_first_context = context;
+
+  ggf_internal_headless_window_t *headless_window = ggf_memory_alloc(
+      sizeof(ggf_internal_headless_window_t), GGF_MEMORY_TAG_WINDOW);
+  headless_window->surface = surface;
+  headless_window->context = context;
+  eglMakeCurrent(ggf_data->egl_display, surface, surface, context);
+  ggf_internal_load_gl((GLADloadproc)eglGetProcAddress);
+  return headless_window;
+}
+
+internal_func void ggf_internal_headless_window_destroy(
+    ggf_internal_headless_window_t *headless_window) {
+  eglMakeCurrent(ggf_data->egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                 EGL_NO_CONTEXT);
+  eglDestroySurface(ggf_data->egl_display, headless_window->surface);
+  eglDestroyContext(ggf_data->egl_display, headless_window->context);
+  if (ggf_data->egl_first_context == headless_window->context)
+    ggf_data->egl_first_context = EGL_NO_CONTEXT;
+  ggf_memory_free(headless_window);
+}
+#else
+internal_func b32 ggf_internal_headless_init() {
+  GGF_ERROR("ERROR - ggf_internal_headless_init: headless mode needs a build "
+            "with GGF_EGL");
+  return FALSE;
+}
+
+internal_func void ggf_internal_headless_shutdown() {}
+#endif
+
 ggf_window_t *ggf_window_create(const char *title, u32 width, u32 height) {
+#ifdef GGF_EGL
+  if (ggf_data->headless) {
+    ggf_internal_headless_window_t *headless_window =
+        ggf_internal_headless_window_create(width, height);
+    if (!headless_window)
+      return NULL;
+    ggf_window_t *window = (ggf_window_t *)ggf_memory_alloc(
+        sizeof(ggf_window_t), GGF_MEMORY_TAG_WINDOW);
+    window->width = width;
+    window->height = height;
+    window->internal_handle = (void *)headless_window;
+    return window;
+  }
+#endif
+
 #ifdef __APPLE__
   /* We need to explicitly ask for a 3.2 context on OS X */
   glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -364,7 +1032,7 @@ ggf_window_t *ggf_window_create(const char *title, u32 width, u32 height) {
   }
 
   glfwMakeContextCurrent(glfw_handle);
-  gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+  ggf_internal_load_gl((GLADloadproc)glfwGetProcAddress);
 
   glfwSwapInterval(1);
 
@@ -389,45 +1057,117 @@ ggf_window_t *ggf_window_create(const char *title, u32 width, u32 height) {
 }
 
 void ggf_window_destroy(ggf_window_t *window) {
-  glfwDestroyWindow((GLFWwindow *)window->internal_handle);
+#ifdef GGF_EGL
+  if (ggf_data->headless)
+    ggf_internal_headless_window_destroy(window->internal_handle);
+  else
+#endif
+    glfwDestroyWindow((GLFWwindow *)window->internal_handle);
   ggf_memory_free(window);
 }
 
 void ggf_window_switch_context(ggf_window_t *window) {
+#ifdef GGF_EGL
+  if (ggf_data->headless) {
+    ggf_internal_headless_window_t *headless_window = window->internal_handle;
+    eglMakeCurrent(ggf_data->egl_display, headless_window->surface,
+                   headless_window->surface, headless_window->context);
+    return;
+  }
+#endif
   glfwMakeContextCurrent((GLFWwindow *)window->internal_handle);
 }
 
 b32 ggf_window_is_open(ggf_window_t *window) {
+#ifdef GGF_EGL
+  if (ggf_data->headless)
+    return !((ggf_internal_headless_window_t *)window->internal_handle)
+                ->should_close;
+#endif
   return !glfwWindowShouldClose((GLFWwindow *)window->internal_handle);
 }
 
+void ggf_window_close(ggf_window_t *window) {
+#ifdef GGF_EGL
+  if (ggf_data->headless) {
+    ((ggf_internal_headless_window_t *)window->internal_handle)->should_close =
+        TRUE;
+    return;
+  }
+#endif
+  glfwSetWindowShouldClose((GLFWwindow *)window->internal_handle, GLFW_TRUE);
+}
+
+// presents the window's back buffer, on the thread whose context is current
+internal_func void ggf_internal_window_present(ggf_window_t *window) {
+#ifdef GGF_EGL
+  if (ggf_data->headless)
+    eglSwapBuffers(ggf_data->egl_display,
+                   ((ggf_internal_headless_window_t *)window->internal_handle)
+                       ->surface);
+  else
+#endif
+    glfwSwapBuffers((GLFWwindow *)window->internal_handle);
+}
+
+// leaves the calling thread without a current context, so that another
+// thread can take it
+internal_func void ggf_internal_window_release_context() {
+#ifdef GGF_EGL
+  if (ggf_data->headless) {
+    eglMakeCurrent(ggf_data->egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                   EGL_NO_CONTEXT);
+    return;
+  }
+#endif
+  glfwMakeContextCurrent(NULL);
+}
+
 void ggf_window_swap_buffers(ggf_window_t *window) {
-  glfwSwapBuffers((GLFWwindow *)window->internal_handle);
+  // with a render thread the frame is presented there
+  if (!ggf_internal_gfx_submit_frame(window))
+    ggf_internal_window_present(window);
+
+  ggf_data->swapped_frames++;
+  if (ggf_data->frame_limit && ggf_data->swapped_frames >= ggf_data->frame_limit)
+    ggf_window_close(window);
 }
 
 void ggf_window_set_title(ggf_window_t *window, const char *title) {
+  if (ggf_data->headless)
+    return;
   glfwSetWindowTitle((GLFWwindow *)window->internal_handle, title);
 }
 
 void ggf_window_set_size(ggf_window_t *window, u32 width, u32 height) {
+  if (ggf_data->headless)
+    return;
   glfwSetWindowSize((GLFWwindow *)window->internal_handle, width, height);
 }
 
 void ggf_window_set_position(ggf_window_t *window, u32 x, u32 y) {
+  if (ggf_data->headless)
+    return;
   glfwSetWindowPos((GLFWwindow *)window->internal_handle, x, y);
 }
 
 void ggf_window_set_visible(ggf_window_t *window, b32 visible) {
+  if (ggf_data->headless)
+    return;
   glfwSetWindowAttrib((GLFWwindow *)window->internal_handle, GLFW_VISIBLE,
                       visible ? GLFW_TRUE : GLFW_FALSE);
 }
 
 void ggf_window_set_resizable(ggf_window_t *window, b32 resizable) {
+  if (ggf_data->headless)
+    return;
   glfwSetWindowAttrib((GLFWwindow *)window->internal_handle, GLFW_RESIZABLE,
                       resizable ? GLFW_TRUE : GLFW_FALSE);
 }
 
 void ggf_window_set_fullscreen(ggf_window_t *window, b32 fullscreen) {
+  if (ggf_data->headless)
+    return;
   GLFWwindow *handle = (GLFWwindow *)window->internal_handle;
   glfwSetWindowAttrib(handle, GLFW_DECORATED,
                       fullscreen ? GLFW_FALSE : GLFW_TRUE);
@@ -443,6 +1183,8 @@ void ggf_window_set_fullscreen(ggf_window_t *window, b32 fullscreen) {
 }
 
 void ggf_window_set_always_on_top(ggf_window_t *window, b32 always_on_top) {
+  if (ggf_data->headless)
+    return;
   glfwSetWindowAttrib((GLFWwindow *)window->internal_handle, GLFW_FLOATING,
                       always_on_top ? GLFW_TRUE : GLFW_FALSE);
 }
@@ -554,10 +1296,12 @@ b32 ggf_file_write(ggf_file_handle_t handle, u64 data_size, void *data,
 // INPUT LAYER
 
 typedef struct {
-  b8 prev_keys_down[GGF_KEY_MAX];
-  b8 keys_down[GGF_KEY_MAX];
-  b8 prev_mouse_buttons_down[GGF_MOUSE_BUTTON_MAX];
-  b8 mouse_buttons_down[GGF_MOUSE_BUTTON_MAX];
+  ggf_bitset_t prev_keys_down;
+  ggf_bitset_t keys_down;
+  ggf_bitset_t prev_mouse_buttons_down;
+  ggf_bitset_t mouse_buttons_down;
+  u64 key_words[2][GGF_BITSET_WORD_COUNT(GGF_KEY_MAX)];
+  u64 mouse_button_words[2][GGF_BITSET_WORD_COUNT(GGF_MOUSE_BUTTON_MAX)];
   i32 prev_mouse_x, prev_mouse_y;
   i32 mouse_x, mouse_y;
   i32 mouse_wheel_x, mouse_wheel_y;
@@ -565,6 +1309,19 @@ typedef struct {
 
 b32 ggf_input_system_init() {
   ggf_data->input = ggf_memory_alloc(sizeof(ggf_input_t), GGF_MEMORY_TAG_INPUT);
+  ggf_input_t *input = (ggf_input_t *)ggf_data->input;
+
+  u64 key_memory = sizeof(input->key_words[0]);
+  ggf_bitset_create(GGF_KEY_MAX, &key_memory, input->key_words[0],
+                    &input->prev_keys_down);
+  ggf_bitset_create(GGF_KEY_MAX, &key_memory, input->key_words[1],
+                    &input->keys_down);
+  u64 mouse_memory = sizeof(input->mouse_button_words[0]);
+  ggf_bitset_create(GGF_MOUSE_BUTTON_MAX, &mouse_memory,
+                    input->mouse_button_words[0],
+                    &input->prev_mouse_buttons_down);
+  ggf_bitset_create(GGF_MOUSE_BUTTON_MAX, &mouse_memory,
+                    input->mouse_button_words[1], &input->mouse_buttons_down);
   return TRUE;
 }
 
@@ -572,25 +1329,24 @@ void ggf_input_system_shutdown() { ggf_memory_free(ggf_data->input); }
 
 void ggf_input_system_update() {
   ggf_input_t *input = (ggf_input_t *)ggf_data->input;
-  for (u32 i = 0; i < GGF_KEY_MAX; i++) {
-    input->prev_keys_down[i] = input->keys_down[i];
-  }
-  for (u32 i = 0; i < GGF_MOUSE_BUTTON_MAX; i++) {
-    input->prev_mouse_buttons_down[i] = input->mouse_buttons_down[i];
-  }
+  ggf_bitset_copy(&input->prev_keys_down, &input->keys_down);
+  ggf_bitset_copy(&input->prev_mouse_buttons_down, &input->mouse_buttons_down);
   input->prev_mouse_x = input->mouse_x;
   input->prev_mouse_y = input->mouse_y;
 }
 
 void ggf_input_system_set_key_state(ggf_key_t key, b8 is_down) {
   ggf_input_t *input = (ggf_input_t *)ggf_data->input;
-  input->keys_down[key] = is_down;
+  // glfw reports unknown keys as -1
+  if ((u32)key >= GGF_KEY_MAX)
+    return;
+  ggf_bitset_assign(&input->keys_down, key, is_down);
 }
 
 void ggf_input_system_set_mouse_button_state(ggf_mouse_button_t button,
                                              b8 is_down) {
   ggf_input_t *input = (ggf_input_t *)ggf_data->input;
-  input->mouse_buttons_down[button] = is_down;
+  ggf_bitset_assign(&input->mouse_buttons_down, button, is_down);
 }
 
 void ggf_input_system_set_mouse_position(i32 x, i32 y) {
@@ -606,34 +1362,36 @@ void ggf_input_system_set_mouse_wheel(i32 x, i32 y) {
 }
 
 b32 ggf_input_key_down(ggf_key_t key) {
-  return ((ggf_input_t *)ggf_data->input)->keys_down[key];
+  return ggf_bitset_test(&((ggf_input_t *)ggf_data->input)->keys_down, key);
 }
 
 b32 ggf_input_key_pressed(ggf_key_t key) {
   ggf_input_t *input = (ggf_input_t *)ggf_data->input;
-  return input->keys_down[key] && !input->prev_keys_down[key];
+  return ggf_bitset_test(&input->keys_down, key) &&
+         !ggf_bitset_test(&input->prev_keys_down, key);
 }
 
 b32 ggf_input_key_released(ggf_key_t key) {
   ggf_input_t *input = (ggf_input_t *)ggf_data->input;
-  return !input->keys_down[key] && input->prev_keys_down[key];
+  return !ggf_bitset_test(&input->keys_down, key) &&
+         ggf_bitset_test(&input->prev_keys_down, key);
 }
 
 b32 ggf_input_mouse_down(ggf_mouse_button_t button) {
   ggf_input_t *input = (ggf_input_t *)ggf_data->input;
-  return input->mouse_buttons_down[button];
+  return ggf_bitset_test(&input->mouse_buttons_down, button);
 }
 
 b32 ggf_input_mouse_pressed(ggf_mouse_button_t button) {
   ggf_input_t *input = (ggf_input_t *)ggf_data->input;
-  return input->mouse_buttons_down[button] &&
-         !input->prev_mouse_buttons_down[button];
+  return ggf_bitset_test(&input->mouse_buttons_down, button) &&
+         !ggf_bitset_test(&input->prev_mouse_buttons_down, button);
 }
 
 b32 ggf_input_mouse_released(ggf_mouse_button_t button) {
   ggf_input_t *input = (ggf_input_t *)ggf_data->input;
-  return !input->mouse_buttons_down[button] &&
-         input->prev_mouse_buttons_down[button];
+  return !ggf_bitset_test(&input->mouse_buttons_down, button) &&
+         ggf_bitset_test(&input->prev_mouse_buttons_down, button);
 }
 
 void ggf_input_get_mouse_position(i32 *x, i32 *y) {
@@ -657,6 +1415,7 @@ void ggf_input_get_mouse_wheel_delta(i32 *x, i32 *y) {
 // MEMORY Layer
 
 void *ggf_memory_alloc(u64 size, ggf_memory_tag_t memory_tag) {
+  GGF_PROFILE_SCOPE("ggf_memory_alloc");
 
   if (memory_tag == GGF_MEMORY_TAG_UNKNOWN) {
     GGF_WARN("WARNING - ggf_memory_alloc: memory allocated with "
@@ -742,7 +1501,8 @@ u64 ggf_memory_get_alloc_size(void *memory) {
 void ggf_memory_get_usage_string(char *out_string, u64 max_length) {
   local_persist const char *memory_tag_strings[GGF_MEMORY_TAG_MAX] = {
       "UNKNOWN", "WINDOW", "LINEAR ALLOCATOR", "GRAPHICS", "INPUT", "STRING",
-      "ASSETS",  "GAME",   "HASH MAP",         "IMAGE",    "DARRAY"};
+      "ASSETS",  "GAME",   "HASH MAP",         "IMAGE",    "DARRAY",
+      "HANDLE POOL"};
 
   const u64 gib = 1024 * 1024 * 1024;
   const u64 mib = 1024 * 1024;
@@ -809,10 +1569,28 @@ void *ggf_linear_allocator_alloc(ggf_linear_allocator_t *allocator, u64 size) {
   return memory;
 }
 
+void *ggf_linear_allocator_alloc_aligned(ggf_linear_allocator_t *allocator,
+                                         u64 size, u64 alignment) {
+  u64 address = (u64)allocator->memory + allocator->marker;
+  u64 padding = ((address + alignment - 1) & ~(alignment - 1)) - address;
+  ggf_linear_allocator_alloc(allocator, padding);
+  return ggf_linear_allocator_alloc(allocator, size);
+}
+
 void ggf_linear_allocator_reset(ggf_linear_allocator_t *allocator) {
   allocator->marker = 0;
 }
 
+void ggf_linear_allocator_free_to_marker(ggf_linear_allocator_t *allocator,
+                                         u64 marker) {
+  GGF_ASSERT(marker <= allocator->marker);
+  allocator->marker = marker;
+}
+
+ggf_linear_allocator_t *ggf_get_frame_allocator() {
+  return &ggf_data->frame_allocator;
+}
+
 void *
 ggf_linear_allocator_get_memory_at_marker(ggf_linear_allocator_t *allocator,
                                           u64 marker) {
@@ -827,6 +1605,12 @@ typedef struct {
   void *memory_block;
 } ggf_dynamic_allocator_internal_state_t;
 
+// every block size is rounded up, so that every offset stays aligned
+internal_func inline u64 ggf_internal_dynamic_allocator_align(u64 value) {
+  return (value + GGF_DYNAMIC_ALLOCATOR_ALIGNMENT - 1) &
+         ~((u64)GGF_DYNAMIC_ALLOCATOR_ALIGNMENT - 1);
+}
+
 b32 ggf_dynamic_allocator_create(u64 total_size, u64 *memory_requirement,
                                  void *memory,
                                  ggf_dynamic_allocator_t *out_allocator) {
@@ -836,9 +1620,10 @@ b32 ggf_dynamic_allocator_create(u64 total_size, u64 *memory_requirement,
   u64 freelist_requirement = 0;
   ggf_freelist_create(total_size, &freelist_requirement, NULL, NULL);
 
+  // slack to align the memory block
   *memory_requirement = freelist_requirement +
                         sizeof(ggf_dynamic_allocator_internal_state_t) +
-                        total_size;
+                        total_size + GGF_DYNAMIC_ALLOCATOR_ALIGNMENT;
 
   if (!memory) {
     return TRUE;
@@ -851,7 +1636,8 @@ b32 ggf_dynamic_allocator_create(u64 total_size, u64 *memory_requirement,
   state->freelist_block =
       (void *)(out_allocator->internal_memory +
                sizeof(ggf_dynamic_allocator_internal_state_t));
-  state->memory_block = (void *)(state->freelist_block + freelist_requirement);
+  state->memory_block = (void *)ggf_internal_dynamic_allocator_align(
+      (u64)(state->freelist_block + freelist_requirement));
 
   ggf_freelist_create(total_size, &freelist_requirement, state->freelist_block,
                       &state->freelist);
@@ -877,6 +1663,7 @@ void *ggf_dynamic_allocator_alloc(ggf_dynamic_allocator_t *allocator,
 
   ggf_dynamic_allocator_internal_state_t *state = allocator->internal_memory;
   u64 offset = 0;
+  size = ggf_internal_dynamic_allocator_align(size);
   if (ggf_freelist_allocate_block(&state->freelist, size, &offset)) {
     return (void *)(state->memory_block + offset);
   }
@@ -899,6 +1686,7 @@ b32 ggf_dynamic_allocator_free(ggf_dynamic_allocator_t *allocator, void *memory,
     return FALSE;
   }
   u64 offset = memory - state->memory_block;
+  size = ggf_internal_dynamic_allocator_align(size);
   if (!ggf_freelist_free_block(&state->freelist, size, offset)) {
     GGF_ERROR("ERROR - ggf_dynamic_allocator_free: failed to free block.");
     return FALSE;
@@ -920,6 +1708,8 @@ typedef enum {
   GGF_DARRAY_FIELD_CAPACITY,
   GGF_DARRAY_FIELD_LENGTH,
   GGF_DARRAY_FIELD_STRIDE,
+  // unused, keeps the elements as aligned as the block they live in
+  GGF_DARRAY_FIELD_RESERVED,
   GGF_DARRAY_FIELD_MAX,
 } ggf_darray_field_t;
 
@@ -936,9 +1726,6 @@ void *ggf_darray_create(u64 length, u64 stride) {
 
 void ggf_darray_destroy(void *array) {
   u64 *header = (u64 *)array - GGF_DARRAY_FIELD_MAX;
-  u64 header_size = GGF_DARRAY_FIELD_MAX * sizeof(u64);
-  u64 total_size = header_size + header[GGF_DARRAY_FIELD_CAPACITY] *
-                                     header[GGF_DARRAY_FIELD_STRIDE];
   ggf_memory_free(header);
 }
 
@@ -994,12 +1781,35 @@ void *ggf_darray_push(void *array, void *value_ptr) {
   return array;
 }
 
+void *ggf_darray_push_many(void *array, void *values, u64 count) {
+  u64 length = ggf_darray_get_length(array);
+  u64 stride = ggf_darray_get_stride(array);
+  while (length + count > ggf_darray_get_capacity(array)) {
+    array = ggf_darray_resize(array);
+  }
+
+  ggf_memory_copy((u8 *)array + length * stride, values, count * stride);
+  ggf_internal_darray_field_set(array, GGF_DARRAY_FIELD_LENGTH, length + count);
+  return array;
+}
+
+// appends count uninitialized values for the caller to write in place
+internal_func void *ggf_internal_darray_extend(void *array, u64 count) {
+  u64 length = ggf_darray_get_length(array);
+  while (length + count > ggf_darray_get_capacity(array)) {
+    array = ggf_darray_resize(array);
+  }
+  ggf_internal_darray_field_set(array, GGF_DARRAY_FIELD_LENGTH, length + count);
+  return array;
+}
+
 void ggf_darray_pop(void *array, void *dest) {
   u64 length = ggf_darray_get_length(array);
   u64 stride = ggf_darray_get_stride(array);
   u64 addr = (u64)array;
   addr += ((length - 1) * stride);
-  ggf_memory_copy(dest, (void *)addr, stride);
+  if (dest)
+    ggf_memory_copy(dest, (void *)addr, stride);
   ggf_internal_darray_field_set(array, GGF_DARRAY_FIELD_LENGTH, length - 1);
 }
 
@@ -1014,23 +1824,24 @@ void *ggf_darray_pop_at(void *array, u64 index, void *dest) {
   }
 
   u64 addr = (u64)array;
-  ggf_memory_copy(dest, (void *)(addr + (index * stride)), stride);
+  if (dest)
+    ggf_memory_copy(dest, (void *)(addr + (index * stride)), stride);
 
-  // If not on the last element, snip out the entry and copy the rest inward.
+  // If not on the last element, snip out the entry and move the rest inward.
   if (index != length - 1) {
-    ggf_memory_copy((void *)(addr + (index * stride)),
-                    (void *)(addr + ((index + 1) * stride)),
-                    stride * (length - index));
+    memmove((void *)(addr + (index * stride)),
+            (void *)(addr + ((index + 1) * stride)),
+            stride * (length - index - 1));
   }
 
   ggf_internal_darray_field_set(array, GGF_DARRAY_FIELD_LENGTH, length - 1);
   return array;
 }
 
-void *_darray_insert_at(void *array, u64 index, void *value_ptr) {
+void *ggf_darray_insert_at(void *array, u64 index, void *value_ptr) {
   u64 length = ggf_darray_get_length(array);
   u64 stride = ggf_darray_get_stride(array);
-  if (index >= length) {
+  if (index > length) {
     GGF_ERROR(
         "Index outside the bounds of this array! Length: %i, index: %index",
         length, index);
@@ -1042,11 +1853,10 @@ void *_darray_insert_at(void *array, u64 index, void *value_ptr) {
 
   u64 addr = (u64)array;
 
-  // If not on the last element, copy the rest outward.
-  if (index != length - 1) {
-    ggf_memory_copy((void *)(addr + ((index + 1) * stride)),
-                    (void *)(addr + (index * stride)),
-                    stride * (length - index));
+  // If not past the last element, move the rest outward.
+  if (index != length) {
+    memmove((void *)(addr + ((index + 1) * stride)),
+            (void *)(addr + (index * stride)), stride * (length - index));
   }
 
   // Set the value at the index
@@ -1156,7 +1966,7 @@ b32 ggf_freelist_allocate_block(ggf_freelist_t *freelist, u64 size,
       return TRUE;
     }
 
-    prev = node->next;
+    prev = node;
     node = node->next;
   }
 
@@ -1260,65 +2070,644 @@ u64 ggf_freelist_get_free_space(ggf_freelist_t *freelist) {
   return free_space;
 }
 
-// hash map
-
-ggf_hash_map_iter_t ggf_hash_map_next(ggf_hash_map_t *map,
-                                      ggf_hash_map_iter_t it) {
-  it += map->key_size + map->value_size;
-  ggf_hash_map_iter_t end = ggf_hash_map_end(map);
-  while (it < end && map->key_cmp_func(it, map->empty_key)) {
-    it += map->key_size + map->value_size;
-  }
+// lock-free ring buffer queues
 
-  return it >= end ? NULL : it;
-}
+/*
+    head and tail are free running counters, an item lives at (counter & mask).
+   producer and consumer fields live on separate cache lines. the consumer
+   sleeps on `signal`, which producers bump after publishing items, and
+   producers only issue a wake when `waiting` is non-zero.
+*/
 
-void ggf_hash_map_create(u64 bucket_count, u64 key_size, u64 value_size,
-                         void *empty_key,
-                         ggf_hash_map_key_comp_func_t key_cmp_func,
-                         ggf_hash_map_hash_func_t hash_func, void *memory,
-                         u64 *memory_requirement, ggf_hash_map_t *out_map) {
-  GGF_ASSERT(memory_requirement);
+typedef struct {
+  // consumer
+  u64 head;
+  u64 cached_tail;
+  u8 consumer_padding[GGF_CACHE_LINE_SIZE - 2 * sizeof(u64)];
+
+  // producer
+  u64 tail;
+  u64 cached_head;
+  u8 producer_padding[GGF_CACHE_LINE_SIZE - 2 * sizeof(u64)];
+
+  u32 signal;
+  u32 waiting;
+  u8 signal_padding[GGF_CACHE_LINE_SIZE - 2 * sizeof(u32)];
+
+  u64 capacity;
+  u64 mask;
+  u64 stride;
+  u8 *items;
+} ggf_spsc_queue_internal_state_t;
 
+typedef struct {
+  // consumer
+  u64 head;
+  u8 consumer_padding[GGF_CACHE_LINE_SIZE - sizeof(u64)];
+
+  // producers
+  u64 tail;
+  u8 producer_padding[GGF_CACHE_LINE_SIZE - sizeof(u64)];
+
+  u32 signal;
+  u32 waiting;
+  u8 signal_padding[GGF_CACHE_LINE_SIZE - 2 * sizeof(u32)];
+
+  u64 capacity;
+  u64 mask;
+  u64 stride;
+  u64 *sequences; // slot at position p is readable once sequence == p + 1
+  u8 *items;
+} ggf_mpsc_queue_internal_state_t;
+
+internal_func u64 ggf_internal_queue_round_capacity(u64 capacity) {
   u64 pow2 = 1;
-  while (pow2 < bucket_count)
+  while (pow2 < capacity)
     pow2 <<= 1;
+  return pow2;
+}
 
-  u64 mem_requirement = key_size + pow2 * (key_size + value_size);
-  if (!memory && memory_requirement) {
-    *memory_requirement = mem_requirement;
-    return;
-  }
-  GGF_ASSERT(memory && *memory_requirement == mem_requirement);
+internal_func void *ggf_internal_queue_align_memory(void *memory) {
+  return (void *)(((u64)memory + GGF_CACHE_LINE_SIZE - 1) &
+                  ~((u64)GGF_CACHE_LINE_SIZE - 1));
+}
 
-  out_map->key_size = key_size;
-  out_map->value_size = value_size;
-  out_map->empty_key = memory;
-  ggf_memory_copy(out_map->empty_key, empty_key, key_size);
-  out_map->key_cmp_func = key_cmp_func;
-  out_map->hash_func = hash_func;
+// copies count items into/out of the ring starting at position, wrapping
+internal_func void ggf_internal_queue_copy_in(u8 *items, u64 capacity,
+                                              u64 stride, u64 position,
+                                              u64 count, u8 *source) {
+  u64 start = position & (capacity - 1);
+  u64 first = GGF_MIN(count, capacity - start);
+  ggf_memory_copy(items + start * stride, source, first * stride);
+  if (count > first)
+    ggf_memory_copy(items, source + first * stride, (count - first) * stride);
+}
 
-  out_map->buckets_reserved_count = pow2;
-  out_map->buckets = (u8 *)memory + key_size;
-  ggf_hash_map_clear(out_map);
+internal_func void ggf_internal_queue_copy_out(u8 *items, u64 capacity,
+                                               u64 stride, u64 position,
+                                               u64 count, u8 *dest) {
+  u64 start = position & (capacity - 1);
+  u64 first = GGF_MIN(count, capacity - start);
+  ggf_memory_copy(dest, items + start * stride, first * stride);
+  if (count > first)
+    ggf_memory_copy(dest + first * stride, items, (count - first) * stride);
+}
 
-  out_map->memory = memory;
+internal_func void ggf_internal_queue_signal(u32 *signal, u32 *waiting) {
+  __atomic_add_fetch(signal, 1, __ATOMIC_SEQ_CST);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (__atomic_load_n(waiting, __ATOMIC_SEQ_CST))
+    ggf_platform_futex_wake(signal, TRUE);
 }
 
-void ggf_hash_map_destroy(ggf_hash_map_t *map) { ggf_memory_free(map->memory); }
+b32 ggf_spsc_queue_create(u64 capacity, u64 stride, u64 *memory_requirement,
+                          void *memory, ggf_spsc_queue_t *out_queue) {
+  GGF_ASSERT(capacity && stride && memory_requirement);
 
-void ggf_hash_map_clear(ggf_hash_map_t *map) {
-  ggf_hash_map_iter_t it = ggf_hash_map_begin(map);
-  while ((it = ggf_hash_map_next(map, it))) {
-    void *key = ggf_hash_map_key_from_iter(map, it);
-    if (!map->key_cmp_func(key, map->empty_key))
-      ggf_memory_copy(key, map->empty_key, map->key_size);
+  capacity = ggf_internal_queue_round_capacity(capacity);
+  *memory_requirement = GGF_CACHE_LINE_SIZE +
+                        sizeof(ggf_spsc_queue_internal_state_t) +
+                        capacity * stride;
+  if (!memory) {
+    return TRUE;
   }
-  map->buckets_count = 0;
+
+  ggf_memory_zero(memory, *memory_requirement);
+  out_queue->internal_memory = ggf_internal_queue_align_memory(memory);
+  ggf_spsc_queue_internal_state_t *state = out_queue->internal_memory;
+  state->capacity = capacity;
+  state->mask = capacity - 1;
+  state->stride = stride;
+  state->items = (u8 *)state + sizeof(ggf_spsc_queue_internal_state_t);
+
+  return TRUE;
 }
 
-internal_func void ggf_internal_hash_map_rehash(ggf_hash_map_t *map,
-                                                u64 count) {
+void ggf_spsc_queue_destroy(ggf_spsc_queue_t *queue) {
+  if (queue && queue->internal_memory) {
+    ggf_memory_zero(queue->internal_memory,
+                    sizeof(ggf_spsc_queue_internal_state_t));
+    queue->internal_memory = NULL;
+  }
+}
+
+u64 ggf_spsc_queue_push(ggf_spsc_queue_t *queue, u64 count, void *items) {
+  GGF_ASSERT(queue && queue->internal_memory && items);
+
+  ggf_spsc_queue_internal_state_t *state = queue->internal_memory;
+  u64 tail = __atomic_load_n(&state->tail, __ATOMIC_RELAXED);
+  u64 free = state->capacity - (tail - state->cached_head);
+  if (free < count) {
+    state->cached_head = __atomic_load_n(&state->head, __ATOMIC_ACQUIRE);
+    free = state->capacity - (tail - state->cached_head);
+  }
+
+  count = GGF_MIN(count, free);
+  if (count == 0) {
+    return 0;
+  }
+
+  ggf_internal_queue_copy_in(state->items, state->capacity, state->stride,
+                             tail, count, (u8 *)items);
+  __atomic_store_n(&state->tail, tail + count, __ATOMIC_RELEASE);
+  ggf_internal_queue_signal(&state->signal, &state->waiting);
+
+  return count;
+}
+
+u64 ggf_spsc_queue_pop(ggf_spsc_queue_t *queue, u64 max_count,
+                       void *out_items) {
+  GGF_ASSERT(queue && queue->internal_memory && out_items);
+
+  ggf_spsc_queue_internal_state_t *state = queue->internal_memory;
+  u64 head = __atomic_load_n(&state->head, __ATOMIC_RELAXED);
+  u64 available = state->cached_tail - head;
+  if (available < max_count) {
+    state->cached_tail = __atomic_load_n(&state->tail, __ATOMIC_ACQUIRE);
+    available = state->cached_tail - head;
+  }
+
+  u64 count = GGF_MIN(max_count, available);
+  if (count == 0) {
+    return 0;
+  }
+
+  ggf_internal_queue_copy_out(state->items, state->capacity, state->stride,
+                              head, count, (u8 *)out_items);
+  __atomic_store_n(&state->head, head + count, __ATOMIC_RELEASE);
+
+  return count;
+}
+
+u64 ggf_spsc_queue_get_length(ggf_spsc_queue_t *queue) {
+  ggf_spsc_queue_internal_state_t *state = queue->internal_memory;
+  return __atomic_load_n(&state->tail, __ATOMIC_ACQUIRE) -
+         __atomic_load_n(&state->head, __ATOMIC_ACQUIRE);
+}
+
+void ggf_spsc_queue_wait(ggf_spsc_queue_t *queue) {
+  ggf_spsc_queue_internal_state_t *state = queue->internal_memory;
+  while (ggf_spsc_queue_get_length(queue) == 0) {
+    u32 signal = __atomic_load_n(&state->signal, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&state->waiting, 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (ggf_spsc_queue_get_length(queue) == 0)
+      ggf_platform_futex_wait(&state->signal, signal);
+    __atomic_sub_fetch(&state->waiting, 1, __ATOMIC_SEQ_CST);
+  }
+}
+
+b32 ggf_mpsc_queue_create(u64 capacity, u64 stride, u64 *memory_requirement,
+                          void *memory, ggf_mpsc_queue_t *out_queue) {
+  GGF_ASSERT(capacity && stride && memory_requirement);
+
+  capacity = ggf_internal_queue_round_capacity(capacity);
+  *memory_requirement = GGF_CACHE_LINE_SIZE +
+                        sizeof(ggf_mpsc_queue_internal_state_t) +
+                        capacity * sizeof(u64) + capacity * stride;
+  if (!memory) {
+    return TRUE;
+  }
+
+  ggf_memory_zero(memory, *memory_requirement);
+  out_queue->internal_memory = ggf_internal_queue_align_memory(memory);
+  ggf_mpsc_queue_internal_state_t *state = out_queue->internal_memory;
+  state->capacity = capacity;
+  state->mask = capacity - 1;
+  state->stride = stride;
+  state->sequences =
+      (u64 *)((u8 *)state + sizeof(ggf_mpsc_queue_internal_state_t));
+  state->items = (u8 *)(state->sequences + capacity);
+
+  return TRUE;
+}
+
+void ggf_mpsc_queue_destroy(ggf_mpsc_queue_t *queue) {
+  if (queue && queue->internal_memory) {
+    ggf_memory_zero(queue->internal_memory,
+                    sizeof(ggf_mpsc_queue_internal_state_t));
+    queue->internal_memory = NULL;
+  }
+}
+
+u64 ggf_mpsc_queue_push(ggf_mpsc_queue_t *queue, u64 count, void *items) {
+  GGF_ASSERT(queue && queue->internal_memory && items);
+
+  ggf_mpsc_queue_internal_state_t *state = queue->internal_memory;
+
+  // claim a contiguous range of positions
+  u64 tail = __atomic_load_n(&state->tail, __ATOMIC_RELAXED);
+  u64 claimed;
+  do {
+    u64 head = __atomic_load_n(&state->head, __ATOMIC_ACQUIRE);
+    claimed = GGF_MIN(count, state->capacity - (tail - head));
+    if (claimed == 0) {
+      return 0;
+    }
+  } while (!__atomic_compare_exchange_n(&state->tail, &tail, tail + claimed,
+                                        TRUE, __ATOMIC_ACQ_REL,
+                                        __ATOMIC_RELAXED));
+
+  ggf_internal_queue_copy_in(state->items, state->capacity, state->stride,
+                             tail, claimed, (u8 *)items);
+  for (u64 position = tail; position != tail + claimed; position++) {
+    __atomic_store_n(&state->sequences[position & state->mask], position + 1,
+                     __ATOMIC_RELEASE);
+  }
+  ggf_internal_queue_signal(&state->signal, &state->waiting);
+
+  return claimed;
+}
+
+u64 ggf_mpsc_queue_pop(ggf_mpsc_queue_t *queue, u64 max_count,
+                       void *out_items) {
+  GGF_ASSERT(queue && queue->internal_memory && out_items);
+
+  ggf_mpsc_queue_internal_state_t *state = queue->internal_memory;
+  u64 head = __atomic_load_n(&state->head, __ATOMIC_RELAXED);
+
+  // producers may publish out of order, stop at the first unpublished slot
+  u64 count = 0;
+  while (count < max_count &&
+         __atomic_load_n(&state->sequences[(head + count) & state->mask],
+                         __ATOMIC_ACQUIRE) == head + count + 1) {
+    count++;
+  }
+  if (count == 0) {
+    return 0;
+  }
+
+  ggf_internal_queue_copy_out(state->items, state->capacity, state->stride,
+                              head, count, (u8 *)out_items);
+  __atomic_store_n(&state->head, head + count, __ATOMIC_RELEASE);
+
+  return count;
+}
+
+u64 ggf_mpsc_queue_get_length(ggf_mpsc_queue_t *queue) {
+  ggf_mpsc_queue_internal_state_t *state = queue->internal_memory;
+  return __atomic_load_n(&state->tail, __ATOMIC_ACQUIRE) -
+         __atomic_load_n(&state->head, __ATOMIC_ACQUIRE);
+}
+
+void ggf_mpsc_queue_wait(ggf_mpsc_queue_t *queue) {
+  ggf_mpsc_queue_internal_state_t *state = queue->internal_memory;
+  // wait for the next slot to be published, not just claimed
+  for (;;) {
+    u64 head = __atomic_load_n(&state->head, __ATOMIC_RELAXED);
+    u64 *sequence = &state->sequences[head & state->mask];
+    if (__atomic_load_n(sequence, __ATOMIC_ACQUIRE) == head + 1)
+      return;
+    u32 signal = __atomic_load_n(&state->signal, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&state->waiting, 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(sequence, __ATOMIC_ACQUIRE) != head + 1)
+      ggf_platform_futex_wait(&state->signal, signal);
+    __atomic_sub_fetch(&state->waiting, 1, __ATOMIC_SEQ_CST);
+  }
+}
+
+// handle pool
+
+// generation 0 is skipped when it wraps around, see ggf_handle_pool_t
+internal_func inline u32 ggf_internal_handle_pool_next_generation(u32 value) {
+  u32 generation = (value + 1) & GGF_HANDLE_GENERATION_MASK;
+  return generation ? generation : 1;
+}
+
+b32 ggf_handle_pool_create(u32 capacity, u64 stride,
+                           ggf_handle_pool_t *out_pool) {
+  GGF_ASSERT(capacity && stride);
+  // the all-ones index is reserved so that GGF_INVALID_ID never validates
+  GGF_ASSERT(capacity < GGF_HANDLE_INDEX_MASK);
+
+  u64 slots_size = sizeof(ggf_handle_pool_slot_t) * capacity;
+  u64 dense_slots_size = sizeof(u32) * capacity;
+  out_pool->memory =
+      ggf_memory_alloc(slots_size + dense_slots_size + stride * capacity,
+                       GGF_MEMORY_TAG_HANDLE_POOL);
+  if (!out_pool->memory) {
+    return FALSE;
+  }
+
+  out_pool->capacity = capacity;
+  out_pool->count = 0;
+  out_pool->stride = stride;
+  out_pool->slots = (ggf_handle_pool_slot_t *)out_pool->memory;
+  out_pool->dense_slots = (u32 *)((u8 *)out_pool->memory + slots_size);
+  out_pool->objects = (u8 *)out_pool->memory + slots_size + dense_slots_size;
+  for (u32 i = 0; i < capacity; i++) {
+    out_pool->slots[i].generation = 1;
+  }
+  ggf_handle_pool_clear(out_pool);
+  GGF_ASSERT(!ggf_handle_pool_is_valid(out_pool, 0));
+
+  return TRUE;
+}
+
+void ggf_handle_pool_destroy(ggf_handle_pool_t *pool) {
+  ggf_memory_free(pool->memory);
+  ggf_memory_zero(pool, sizeof(ggf_handle_pool_t));
+}
+
+void ggf_handle_pool_clear(ggf_handle_pool_t *pool) {
+  // live slots get a new generation, everything goes back on the free list
+  for (u32 i = 0; i < pool->capacity; i++) {
+    ggf_handle_pool_slot_t *slot = &pool->slots[i];
+    if (slot->dense_index < pool->count &&
+        pool->dense_slots[slot->dense_index] == i)
+      slot->generation =
+          ggf_internal_handle_pool_next_generation(slot->generation);
+    slot->dense_index = i + 1;
+  }
+  pool->free_head = 0;
+  pool->count = 0;
+}
+
+ggf_handle_t ggf_handle_pool_add(ggf_handle_pool_t *pool, void *value) {
+  if (pool->count == pool->capacity) {
+    GGF_WARN("WARNING - ggf_handle_pool_add: handle pool is full.");
+    return GGF_INVALID_ID;
+  }
+
+  u32 index = pool->free_head;
+  ggf_handle_pool_slot_t *slot = &pool->slots[index];
+  pool->free_head = slot->dense_index;
+
+  slot->dense_index = pool->count;
+  pool->dense_slots[pool->count] = index;
+  ggf_memory_copy(pool->objects + pool->count * pool->stride, value,
+                  pool->stride);
+  pool->count++;
+
+  return (slot->generation << GGF_HANDLE_INDEX_BITS) | index;
+}
+
+b32 ggf_handle_pool_remove(ggf_handle_pool_t *pool, ggf_handle_t handle) {
+  if (!ggf_handle_pool_is_valid(pool, handle)) {
+    return FALSE;
+  }
+
+  u32 index = handle & GGF_HANDLE_INDEX_MASK;
+  ggf_handle_pool_slot_t *slot = &pool->slots[index];
+
+  // keep objects dense by moving the last one into the hole
+  u32 last = pool->count - 1;
+  if (slot->dense_index != last) {
+    ggf_memory_copy(pool->objects + slot->dense_index * pool->stride,
+                    pool->objects + last * pool->stride, pool->stride);
+    u32 moved_slot = pool->dense_slots[last];
+    pool->dense_slots[slot->dense_index] = moved_slot;
+    pool->slots[moved_slot].dense_index = slot->dense_index;
+  }
+  pool->count--;
+
+  slot->generation = ggf_internal_handle_pool_next_generation(slot->generation);
+  slot->dense_index = pool->free_head;
+  pool->free_head = index;
+
+  return TRUE;
+}
+
+// bitset
+
+internal_func void ggf_internal_bitset_mask_tail(ggf_bitset_t *bitset) {
+  if (bitset->bit_count & 63)
+    bitset->words[bitset->word_count - 1] &=
+        (1ull << (bitset->bit_count & 63)) - 1;
+}
+
+void ggf_bitset_create(u32 bit_count, u64 *memory_requirement, void *memory,
+                       ggf_bitset_t *out_bitset) {
+  GGF_ASSERT(memory_requirement);
+
+  u32 word_count = GGF_BITSET_WORD_COUNT(bit_count);
+  u64 mem_requirement = sizeof(u64) * word_count;
+  if (!memory) {
+    *memory_requirement = mem_requirement;
+    return;
+  }
+  GGF_ASSERT(*memory_requirement == mem_requirement);
+
+  out_bitset->bit_count = bit_count;
+  out_bitset->word_count = word_count;
+  out_bitset->words = (u64 *)memory;
+  ggf_bitset_clear_all(out_bitset);
+}
+
+void ggf_bitset_set_all(ggf_bitset_t *bitset) {
+  ggf_memory_set(bitset->words, 0xFF, sizeof(u64) * bitset->word_count);
+  ggf_internal_bitset_mask_tail(bitset);
+}
+
+void ggf_bitset_clear_all(ggf_bitset_t *bitset) {
+  ggf_memory_zero(bitset->words, sizeof(u64) * bitset->word_count);
+}
+
+void ggf_bitset_copy(ggf_bitset_t *dst, ggf_bitset_t *src) {
+  GGF_ASSERT(dst->bit_count == src->bit_count);
+  ggf_memory_copy(dst->words, src->words, sizeof(u64) * src->word_count);
+}
+
+/*
+    the binary operations handle two words per iteration with SSE2 or NEON and
+   finish the odd word with plain u64 math. loads and stores are unaligned so
+   the words can live anywhere.
+*/
+#if defined(__SSE2__)
+#define GGF_INTERNAL_BITSET_BINARY_OP(name, simd_op, scalar_op)                \
+  void ggf_bitset_##name(ggf_bitset_t *dst, ggf_bitset_t *a,                   \
+                         ggf_bitset_t *b) {                                    \
+    GGF_ASSERT(dst->bit_count == a->bit_count &&                               \
+               a->bit_count == b->bit_count);                                  \
+    u32 i = 0;                                                                 \
+    for (; i + 2 <= dst->word_count; i += 2) {                                 \
+      __m128i x = _mm_loadu_si128((__m128i *)(a->words + i));                  \
+      __m128i y = _mm_loadu_si128((__m128i *)(b->words + i));                  \
+      _mm_storeu_si128((__m128i *)(dst->words + i), simd_op);                  \
+    }                                                                          \
+    for (; i < dst->word_count; i++) {                                         \
+      u64 x = a->words[i], y = b->words[i];                                    \
+      dst->words[i] = scalar_op;                                               \
+    }                                                                          \
+  }
+GGF_INTERNAL_BITSET_BINARY_OP(and, _mm_and_si128(x, y), x & y)
+GGF_INTERNAL_BITSET_BINARY_OP(or, _mm_or_si128(x, y), x | y)
+GGF_INTERNAL_BITSET_BINARY_OP(xor, _mm_xor_si128(x, y), x ^ y)
+GGF_INTERNAL_BITSET_BINARY_OP(andnot, _mm_andnot_si128(y, x), x & ~y)
+#elif defined(__ARM_NEON)
+#define GGF_INTERNAL_BITSET_BINARY_OP(name, simd_op, scalar_op)                \
+  void ggf_bitset_##name(ggf_bitset_t *dst, ggf_bitset_t *a,                   \
+                         ggf_bitset_t *b) {                                    \
+    GGF_ASSERT(dst->bit_count == a->bit_count &&                               \
+               a->bit_count == b->bit_count);                                  \
+    u32 i = 0;                                                                 \
+    for (; i + 2 <= dst->word_count; i += 2) {                                 \
+      uint64x2_t x = vld1q_u64(a->words + i);                                  \
+      uint64x2_t y = vld1q_u64(b->words + i);                                  \
+      vst1q_u64(dst->words + i, simd_op);                                      \
+    }                                                                          \
+    for (; i < dst->word_count; i++) {                                         \
+      u64 x = a->words[i], y = b->words[i];                                    \
+      dst->words[i] = scalar_op;                                               \
+    }                                                                          \
+  }
+GGF_INTERNAL_BITSET_BINARY_OP(and, vandq_u64(x, y), x & y)
+GGF_INTERNAL_BITSET_BINARY_OP(or, vorrq_u64(x, y), x | y)
+GGF_INTERNAL_BITSET_BINARY_OP(xor, veorq_u64(x, y), x ^ y)
+GGF_INTERNAL_BITSET_BINARY_OP(andnot, vbicq_u64(x, y), x & ~y)
+#else
+#define GGF_INTERNAL_BITSET_BINARY_OP(name, scalar_op)                         \
+  void ggf_bitset_##name(ggf_bitset_t *dst, ggf_bitset_t *a,                   \
+                         ggf_bitset_t *b) {                                    \
+    GGF_ASSERT(dst->bit_count == a->bit_count &&                               \
+               a->bit_count == b->bit_count);                                  \
+    for (u32 i = 0; i < dst->word_count; i++) {                                \
+      u64 x = a->words[i], y = b->words[i];                                    \
+      dst->words[i] = scalar_op;                                               \
+    }                                                                          \
+  }
+GGF_INTERNAL_BITSET_BINARY_OP(and, x & y)
+GGF_INTERNAL_BITSET_BINARY_OP(or, x | y)
+GGF_INTERNAL_BITSET_BINARY_OP(xor, x ^ y)
+GGF_INTERNAL_BITSET_BINARY_OP(andnot, x & ~y)
+#endif
+#undef GGF_INTERNAL_BITSET_BINARY_OP
+
+u32 ggf_bitset_popcount(ggf_bitset_t *bitset) {
+  u32 count = 0;
+  for (u32 i = 0; i < bitset->word_count; i++) {
+    count += __builtin_popcountll(bitset->words[i]);
+  }
+  return count;
+}
+
+b32 ggf_bitset_any(ggf_bitset_t *bitset) {
+  u32 i = 0;
+#if defined(__SSE2__)
+  __m128i acc = _mm_setzero_si128();
+  for (; i + 2 <= bitset->word_count; i += 2) {
+    acc = _mm_or_si128(acc, _mm_loadu_si128((__m128i *)(bitset->words + i)));
+  }
+  if (_mm_movemask_epi8(_mm_cmpeq_epi8(acc, _mm_setzero_si128())) != 0xFFFF)
+    return TRUE;
+#elif defined(__ARM_NEON)
+  uint64x2_t acc = vdupq_n_u64(0);
+  for (; i + 2 <= bitset->word_count; i += 2) {
+    acc = vorrq_u64(acc, vld1q_u64(bitset->words + i));
+  }
+  if (vgetq_lane_u64(acc, 0) | vgetq_lane_u64(acc, 1))
+    return TRUE;
+#endif
+  for (; i < bitset->word_count; i++) {
+    if (bitset->words[i])
+      return TRUE;
+  }
+  return FALSE;
+}
+
+b32 ggf_bitset_any_in_range(ggf_bitset_t *bitset, u32 first, u32 count) {
+  GGF_ASSERT(first + count <= bitset->bit_count);
+  if (!count)
+    return FALSE;
+
+  u32 last = first + count - 1;
+  u32 first_word = first >> 6, last_word = last >> 6;
+  u64 first_mask = ~0ull << (first & 63);
+  u64 last_mask = ~0ull >> (63 - (last & 63));
+
+  if (first_word == last_word)
+    return (bitset->words[first_word] & first_mask & last_mask) != 0;
+
+  if (bitset->words[first_word] & first_mask)
+    return TRUE;
+  ggf_bitset_t middle = {(last_word - first_word - 1) * 64,
+                         last_word - first_word - 1,
+                         bitset->words + first_word + 1};
+  if (ggf_bitset_any(&middle))
+    return TRUE;
+  return (bitset->words[last_word] & last_mask) != 0;
+}
+
+u32 ggf_bitset_find_next_set(ggf_bitset_t *bitset, u32 from) {
+  if (from >= bitset->bit_count)
+    return GGF_INVALID_ID;
+
+  u32 word_index = from >> 6;
+  u64 word = bitset->words[word_index] & (~0ull << (from & 63));
+  while (!word) {
+    if (++word_index == bitset->word_count)
+      return GGF_INVALID_ID;
+    word = bitset->words[word_index];
+  }
+  return word_index * 64 + __builtin_ctzll(word);
+}
+
+// hash map
+
+ggf_hash_map_iter_t ggf_hash_map_next(ggf_hash_map_t *map,
+                                      ggf_hash_map_iter_t it) {
+  it += map->key_size + map->value_size;
+  ggf_hash_map_iter_t end = ggf_hash_map_end(map);
+  while (it < end && map->key_cmp_func(it, map->empty_key)) {
+    it += map->key_size + map->value_size;
+  }
+
+  return it >= end ? NULL : it;
+}
+
+ggf_hash_map_iter_t ggf_hash_map_begin(ggf_hash_map_t *map) {
+  ggf_hash_map_iter_t it = map->buckets;
+  if (!map->key_cmp_func(it, map->empty_key))
+    return it;
+  return ggf_hash_map_next(map, it);
+}
+
+void ggf_hash_map_create(u64 bucket_count, u64 key_size, u64 value_size,
+                         void *empty_key,
+                         ggf_hash_map_key_comp_func_t key_cmp_func,
+                         ggf_hash_map_hash_func_t hash_func, void *memory,
+                         u64 *memory_requirement, ggf_hash_map_t *out_map) {
+  GGF_ASSERT(memory_requirement);
+
+  u64 pow2 = 1;
+  while (pow2 < bucket_count)
+    pow2 <<= 1;
+
+  u64 mem_requirement = key_size + pow2 * (key_size + value_size);
+  if (!memory && memory_requirement) {
+    *memory_requirement = mem_requirement;
+    return;
+  }
+  GGF_ASSERT(memory && *memory_requirement == mem_requirement);
+
+  out_map->key_size = key_size;
+  out_map->value_size = value_size;
+  out_map->empty_key = memory;
+  ggf_memory_copy(out_map->empty_key, empty_key, key_size);
+  out_map->key_cmp_func = key_cmp_func;
+  out_map->hash_func = hash_func;
+
+  out_map->buckets_reserved_count = pow2;
+  out_map->buckets = (u8 *)memory + key_size;
+  ggf_hash_map_clear(out_map);
+
+  out_map->memory = memory;
+}
+
+void ggf_hash_map_destroy(ggf_hash_map_t *map) { ggf_memory_free(map->memory); }
+
+void ggf_hash_map_clear(ggf_hash_map_t *map) {
+  // create calls this on uninitialized memory, so every bucket is reset
+  for (ggf_hash_map_iter_t it = map->buckets; it != ggf_hash_map_end(map);
+       it += map->key_size + map->value_size) {
+    ggf_memory_copy(it, map->empty_key, map->key_size);
+  }
+  map->buckets_count = 0;
+}
+
+internal_func void ggf_internal_hash_map_rehash(ggf_hash_map_t *map,
+                                                u64 count) {
   count = GGF_MAX(count, map->buckets_count * 2);
   ggf_hash_map_t new_map;
   u64 new_requirement = 0;
@@ -1328,8 +2717,8 @@ internal_func void ggf_internal_hash_map_rehash(ggf_hash_map_t *map,
   ggf_hash_map_create(count, map->key_size, map->value_size, map->empty_key,
                       map->key_cmp_func, map->hash_func, new_mem,
                       &new_requirement, &new_map);
-  for (ggf_hash_map_iter_t it = ggf_hash_map_begin(map);
-       (it = ggf_hash_map_next(map, it));) {
+  for (ggf_hash_map_iter_t it = ggf_hash_map_begin(map); it;
+       it = ggf_hash_map_next(map, it)) {
     ggf_hash_map_insert(&new_map, ggf_hash_map_key_from_iter(map, it),
                         ggf_hash_map_value_from_iter(map, it));
   }
@@ -1401,18 +2790,219 @@ void ggf_hash_map_erase(ggf_hash_map_t *map, ggf_hash_map_iter_t it) {
     u64 ideal = ggf_internal_hash_map_key_to_idx(map, key_i);
     if (ggf_internal_hash_map_diff(map, bucket, ideal) <
         ggf_internal_hash_map_diff(map, idx, ideal)) {
-      ggf_memory_copy(it, key_i, map->key_size);
+      // move the whole entry into the hole, which then moves to idx
+      ggf_memory_copy(it, key_i, map->key_size + map->value_size);
+      it = key_i;
       bucket = idx;
     }
   }
 }
 
+// transient hash map
+
+void ggf_transient_map_create(u32 capacity, u32 value_size,
+                              ggf_linear_allocator_t *allocator,
+                              ggf_transient_map_t *out_map) {
+  GGF_ASSERT(capacity && value_size);
+  if (!allocator)
+    allocator = &ggf_data->frame_allocator;
+
+  u32 slot_count = 1;
+  while (slot_count < capacity * 2)
+    slot_count <<= 1;
+
+  out_map->capacity = capacity;
+  out_map->slot_count = slot_count;
+  out_map->count = 0;
+  out_map->generation = 1;
+  out_map->value_size = value_size;
+  out_map->stamps =
+      ggf_linear_allocator_alloc_aligned(allocator, sizeof(u32) * slot_count, 8);
+  out_map->keys =
+      ggf_linear_allocator_alloc_aligned(allocator, sizeof(u64) * slot_count, 8);
+  out_map->values =
+      ggf_linear_allocator_alloc_aligned(allocator, value_size * slot_count, 8);
+  // linear allocator memory may hold anything, stamps must start stale
+  ggf_memory_zero(out_map->stamps, sizeof(u32) * slot_count);
+}
+
+void ggf_transient_map_clear(ggf_transient_map_t *map) {
+  map->count = 0;
+  map->generation++;
+  // after wrapping around, old stamps could look current again
+  if (map->generation == 0) {
+    ggf_memory_zero(map->stamps, sizeof(u32) * map->slot_count);
+    map->generation = 1;
+  }
+}
+
+internal_func u32 ggf_internal_transient_map_hash(u64 key) {
+  // murmur3 finalizer
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdull;
+  key ^= key >> 33;
+  key *= 0xc4ceb9fe1a85ec53ull;
+  key ^= key >> 33;
+  return (u32)key;
+}
+
+void *ggf_transient_map_find(ggf_transient_map_t *map, u64 key) {
+  u32 mask = map->slot_count - 1;
+  for (u32 idx = ggf_internal_transient_map_hash(key) & mask;;
+       idx = (idx + 1) & mask) {
+    if (map->stamps[idx] != map->generation)
+      return NULL;
+    if (map->keys[idx] == key)
+      return map->values + idx * map->value_size;
+  }
+}
+
+void *ggf_transient_map_insert(ggf_transient_map_t *map, u64 key,
+                               b32 *out_inserted) {
+  if (out_inserted)
+    *out_inserted = FALSE;
+
+  u32 mask = map->slot_count - 1;
+  for (u32 idx = ggf_internal_transient_map_hash(key) & mask;;
+       idx = (idx + 1) & mask) {
+    u8 *value = map->values + idx * map->value_size;
+    if (map->stamps[idx] != map->generation) {
+      if (map->count == map->capacity)
+        return NULL;
+      map->stamps[idx] = map->generation;
+      map->keys[idx] = key;
+      ggf_memory_zero(value, map->value_size);
+      map->count++;
+      if (out_inserted)
+        *out_inserted = TRUE;
+      return value;
+    }
+    if (map->keys[idx] == key)
+      return value;
+  }
+}
+
+// SORTING
+
+// radix sort
+
+#define GGF_RADIX_BITS 8
+#define GGF_RADIX_BUCKETS (1 << GGF_RADIX_BITS)
+
+// turns counts into exclusive prefix sums (start offsets)
+internal_func void ggf_internal_radix_prefix_sum(u32 *counts) {
+#if defined(__SSE2__)
+  // scan four lanes with two shifted adds, then add the running total
+  __m128i carry = _mm_setzero_si128();
+  for (u32 i = 0; i < GGF_RADIX_BUCKETS; i += 4) {
+    __m128i x = _mm_loadu_si128((__m128i *)(counts + i));
+    __m128i sums = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+    sums = _mm_add_epi32(sums, _mm_slli_si128(sums, 8));
+    sums = _mm_add_epi32(sums, carry);
+    // inclusive minus own count gives the exclusive sum
+    _mm_storeu_si128((__m128i *)(counts + i), _mm_sub_epi32(sums, x));
+    carry = _mm_shuffle_epi32(sums, _MM_SHUFFLE(3, 3, 3, 3));
+  }
+#else
+  u32 sum = 0;
+  for (u32 i = 0; i < GGF_RADIX_BUCKETS; i++) {
+    u32 count = counts[i];
+    counts[i] = sum;
+    sum += count;
+  }
+#endif
+}
+
+/*
+    keys are processed as KEY_TYPE, digits come from ((key >> shift) & 0xFF).
+   the histogram for every digit is built in one pass, then each digit whose
+   keys do not all share the same bucket is scattered between the caller's
+   arrays and the scratch copies.
+*/
+#define GGF_INTERNAL_RADIX_SORT(KEY_TYPE, DIGITS)                              \
+  if (count < 2)                                                               \
+    return;                                                                    \
+  if (!scratch)                                                                \
+    scratch = &ggf_data->frame_allocator;                                      \
+  u64 marker = scratch->marker;                                                \
+                                                                               \
+  KEY_TYPE *key_tmp = ggf_linear_allocator_alloc_aligned(                      \
+      scratch, sizeof(KEY_TYPE) * count, GGF_CACHE_LINE_SIZE);                 \
+  u32 *index_tmp =                                                             \
+      indices ? ggf_linear_allocator_alloc_aligned(                            \
+                    scratch, sizeof(u32) * count, GGF_CACHE_LINE_SIZE)         \
+              : NULL;                                                          \
+  u32 *histograms = ggf_linear_allocator_alloc_aligned(                        \
+      scratch, sizeof(u32) * GGF_RADIX_BUCKETS * DIGITS, GGF_CACHE_LINE_SIZE); \
+  ggf_memory_zero(histograms, sizeof(u32) * GGF_RADIX_BUCKETS * DIGITS);       \
+                                                                               \
+  for (u32 i = 0; i < count; i++) {                                            \
+    KEY_TYPE key = keys[i];                                                    \
+    for (u32 d = 0; d < DIGITS; d++) {                                         \
+      histograms[d * GGF_RADIX_BUCKETS +                                       \
+                 ((key >> (d * GGF_RADIX_BITS)) & (GGF_RADIX_BUCKETS - 1))]++; \
+    }                                                                          \
+  }                                                                            \
+                                                                               \
+  KEY_TYPE *key_src = keys, *key_dst = key_tmp;                                \
+  u32 *index_src = indices, *index_dst = index_tmp;                            \
+  for (u32 d = 0; d < DIGITS; d++) {                                           \
+    u32 *offsets = histograms + d * GGF_RADIX_BUCKETS;                         \
+    u32 shift = d * GGF_RADIX_BITS;                                            \
+    /* every key has the same digit, so this pass would be a plain copy */     \
+    if (offsets[(key_src[0] >> shift) & (GGF_RADIX_BUCKETS - 1)] == count)     \
+      continue;                                                                \
+    ggf_internal_radix_prefix_sum(offsets);                                    \
+                                                                               \
+    if (index_src) {                                                           \
+      for (u32 i = 0; i < count; i++) {                                        \
+        u32 dst = offsets[(key_src[i] >> shift) & (GGF_RADIX_BUCKETS - 1)]++;  \
+        key_dst[dst] = key_src[i];                                             \
+        index_dst[dst] = index_src[i];                                         \
+      }                                                                        \
+    } else {                                                                   \
+      for (u32 i = 0; i < count; i++) {                                        \
+        u32 dst = offsets[(key_src[i] >> shift) & (GGF_RADIX_BUCKETS - 1)]++;  \
+        key_dst[dst] = key_src[i];                                             \
+      }                                                                        \
+    }                                                                          \
+                                                                               \
+    KEY_TYPE *key_swap = key_src;                                              \
+    key_src = key_dst;                                                         \
+    key_dst = key_swap;                                                        \
+    u32 *index_swap = index_src;                                               \
+    index_src = index_dst;                                                     \
+    index_dst = index_swap;                                                    \
+  }                                                                            \
+                                                                               \
+  /* an odd number of passes leaves the result in the scratch copies */       \
+  if (key_src != keys) {                                                       \
+    ggf_memory_copy(keys, key_src, sizeof(KEY_TYPE) * count);                  \
+    if (indices)                                                               \
+      ggf_memory_copy(indices, index_src, sizeof(u32) * count);                \
+  }                                                                            \
+                                                                               \
+  ggf_linear_allocator_free_to_marker(scratch, marker);
+
+void ggf_radix_sort_u32(u32 count, u32 *keys, u32 *indices,
+                        ggf_linear_allocator_t *scratch) {
+  GGF_INTERNAL_RADIX_SORT(u32, 4)
+}
+
+void ggf_radix_sort_u64(u32 count, u64 *keys, u32 *indices,
+                        ggf_linear_allocator_t *scratch) {
+  GGF_INTERNAL_RADIX_SORT(u64, 8)
+}
+
+#undef GGF_INTERNAL_RADIX_SORT
+
 // ASSET Layer
 
 typedef struct {
   ggf_asset_type_t type;
-  u32 name_hash, path_hash;
-  char *path;
+  ggf_asset_handle_t handle; // valid while the asset's stage is in use
+  ggf_string_id_t name;
+  ggf_string_id_t path; // full path, shared by every stage that uses it
   u64 data_size;
   void *data;
 } ggf_asset_t;
@@ -1421,43 +3011,54 @@ typedef struct {
   ggf_asset_t *assets;
 } ggf_asset_stage_t;
 
+#define GGF_ASSET_LOAD_QUEUE_CAPACITY 1024
+#define GGF_ASSET_MAX_HANDLES 4096
+
 typedef struct {
   char assets_path[512];
-  ggf_asset_t **assets_to_load;
-  pthread_mutex_t assets_to_load_mutex;
-  pthread_cond_t assets_available_cond;
-  b32 keep_loading_thread_running;
+  ggf_spsc_queue_t assets_to_load; // NULL entry stops the loader
+  void *assets_to_load_memory;
   pthread_t loader_thread;
   ggf_asset_stage_index_t current_stage_idx;
+  ggf_handle_pool_t handles; // ggf_asset_t * of the current stage
+  // ggf_string_id_t name -> ggf_asset_handle_t, of the current stage
+  ggf_hash_map_t handles_by_name;
   u32 stage_count;
   ggf_asset_stage_t stages[64];
 } ggf_asset_system_t;
 
 // TODO: don't reload assets with same path
 
+internal_func b32 ggf_internal_asset_name_cmp(void *first, void *second) {
+  return *(ggf_string_id_t *)first == *(ggf_string_id_t *)second;
+}
+
+internal_func u64 ggf_internal_asset_name_hash(void *val) {
+  return (u64) * (ggf_string_id_t *)val;
+}
+
 internal_func void *ggf_internal_asset_system_loading_thread(void *usr) {
   ggf_asset_system_t *system = (ggf_asset_system_t *)usr;
+  GGF_PROFILE_THREAD_NAME("asset loader");
 
-  while (system->keep_loading_thread_running) {
-    pthread_mutex_lock(&system->assets_to_load_mutex);
-    while (system->keep_loading_thread_running &&
-           ggf_darray_get_length(system->assets_to_load) == 0)
-      pthread_cond_wait(&system->assets_available_cond,
-                        &system->assets_to_load_mutex);
-    pthread_mutex_unlock(&system->assets_to_load_mutex);
-    if (!system->keep_loading_thread_running)
-      break;
+  for (;;) {
+    ggf_spsc_queue_wait(&system->assets_to_load);
 
-    ggf_asset_t **end =
-        system->assets_to_load + ggf_darray_get_length(system->assets_to_load);
-    for (ggf_asset_t **asset_ptr = system->assets_to_load; asset_ptr != end;
+    ggf_asset_t *batch[32];
+    u64 batch_count = ggf_spsc_queue_pop(&system->assets_to_load,
+                                         GGF_ARRAY_COUNT(batch), batch);
+    for (ggf_asset_t **asset_ptr = batch; asset_ptr != batch + batch_count;
          asset_ptr++) {
       ggf_asset_t *asset = *asset_ptr;
+      if (!asset)
+        return NULL;
+      GGF_PROFILE_SCOPE("asset load");
 
       if (asset->type == GGF_ASSET_TYPE_TEXTURE) {
         i32 width, height, comp_count;
         stbi_uc *pixels =
-            stbi_load(asset->path, &width, &height, &comp_count, 3);
+            stbi_load(ggf_string_get(asset->path), &width, &height,
+                      &comp_count, 3);
         u64 pixels_size = width * height * 3;
 
         u64 size = sizeof(ggf_texture_asset_data_t) + pixels_size;
@@ -1474,7 +3075,8 @@ internal_func void *ggf_internal_asset_system_loading_thread(void *usr) {
         asset->data_size = size;
         asset->data = memory;
       } else {
-        ggf_file_handle_t file = ggf_file_open(asset->path, GGF_FILE_MODE_READ);
+        ggf_file_handle_t file =
+            ggf_file_open(ggf_string_get(asset->path), GGF_FILE_MODE_READ);
         u64 size = ggf_file_get_size(file);
         void *memory = ggf_memory_alloc(size, GGF_MEMORY_TAG_ASSET);
         u64 bytes_read = 0;
@@ -1486,10 +3088,6 @@ internal_func void *ggf_internal_asset_system_loading_thread(void *usr) {
       }
       GGF_DEBUG("ASSET LOADED: %llu bytes", asset->data_size);
     }
-
-    pthread_mutex_lock(&system->assets_to_load_mutex);
-    ggf_darray_clear(system->assets_to_load);
-    pthread_mutex_unlock(&system->assets_to_load_mutex);
   }
 
   return NULL;
@@ -1531,14 +3129,23 @@ b32 ggf_asset_system_init() {
   snprintf(system->assets_path, sizeof(system->assets_path), "./assets/");
 #endif
 
-  system->assets_to_load = ggf_darray_create(128, sizeof(ggf_asset_t *));
-  pthread_mutex_init(&system->assets_to_load_mutex, NULL);
-  pthread_cond_init(&system->assets_available_cond, NULL);
-  system->keep_loading_thread_running = TRUE;
+  u64 queue_requirement = 0;
+  ggf_spsc_queue_create(GGF_ASSET_LOAD_QUEUE_CAPACITY, sizeof(ggf_asset_t *),
+                        &queue_requirement, NULL, NULL);
+  system->assets_to_load_memory =
+      ggf_memory_alloc(queue_requirement, GGF_MEMORY_TAG_ASSET);
+  ggf_spsc_queue_create(GGF_ASSET_LOAD_QUEUE_CAPACITY, sizeof(ggf_asset_t *),
+                        &queue_requirement, system->assets_to_load_memory,
+                        &system->assets_to_load);
   pthread_create(&system->loader_thread, NULL,
                  ggf_internal_asset_system_loading_thread, system);
 
   system->current_stage_idx = GGF_INVALID_ID;
+  ggf_handle_pool_create(GGF_ASSET_MAX_HANDLES, sizeof(ggf_asset_t *),
+                         &system->handles);
+  GGF_HM_CREATE(ggf_string_id_t, ggf_asset_handle_t, GGF_INVALID_ID,
+                ggf_internal_asset_name_cmp, ggf_internal_asset_name_hash,
+                system->handles_by_name);
 
   return TRUE;
 }
@@ -1546,25 +3153,26 @@ b32 ggf_asset_system_init() {
 void ggf_asset_system_shutdown() {
   ggf_asset_system_t *system = (ggf_asset_system_t *)ggf_data->assets;
 
-  system->keep_loading_thread_running = FALSE;
-  pthread_cond_signal(&system->assets_available_cond);
+  ggf_asset_t *stop = NULL;
+  while (!ggf_spsc_queue_push(&system->assets_to_load, 1, &stop))
+    ;
   pthread_join(system->loader_thread, NULL);
-  pthread_cond_destroy(&system->assets_available_cond);
-  pthread_mutex_destroy(&system->assets_to_load_mutex);
-  ggf_darray_destroy(system->assets_to_load);
+  ggf_spsc_queue_destroy(&system->assets_to_load);
+  ggf_memory_free(system->assets_to_load_memory);
 
   for (ggf_asset_stage_t *stage = system->stages;
        stage != system->stages + system->stage_count; stage++) {
     ggf_asset_t *end_assets =
         stage->assets + ggf_darray_get_length(stage->assets);
     for (ggf_asset_t *asset = stage->assets; asset != end_assets; asset++) {
-      ggf_memory_free(asset->path);
       if (asset->data)
         ggf_memory_free(asset->data);
     }
     ggf_darray_destroy(stage->assets);
   }
 
+  ggf_handle_pool_destroy(&system->handles);
+  GGF_HM_DESTROY(system->handles_by_name);
   ggf_memory_free(ggf_data->assets);
 }
 
@@ -1581,8 +3189,8 @@ ggf_asset_stage_create(u64 desc_count, ggf_asset_description_t *descriptions) {
   for (ggf_asset_description_t *desc = descriptions; desc != end; desc++) {
     ggf_asset_t asset;
     asset.type = desc->type;
-    asset.name_hash = ggf_hash_string(desc->name);
-    asset.path_hash = ggf_hash_string(desc->path);
+    asset.handle = GGF_INVALID_ID;
+    asset.name = ggf_string_intern(desc->name);
     char full_path[512];
     if (!ggf_asset_system_find_full_asset_path(asset.type, (char *)desc->path,
                                                sizeof(full_path), full_path)) {
@@ -1591,9 +3199,7 @@ ggf_asset_stage_create(u64 desc_count, ggf_asset_description_t *descriptions) {
                 desc->name, desc->path);
       continue;
     }
-    u64 path_len = strlen(full_path) + 1;
-    asset.path = (char *)ggf_memory_alloc(path_len, GGF_MEMORY_TAG_STRING);
-    ggf_memory_copy(asset.path, (void *)full_path, path_len);
+    asset.path = ggf_string_intern(full_path);
     asset.data_size = 0;
     asset.data = NULL;
     ggf_darray_push(system->stages[stage_index].assets, &asset);
@@ -1621,7 +3227,7 @@ void ggf_asset_stage_use(ggf_asset_stage_index_t stage_idx) {
          old_asset != current_asset_end; old_asset++) {
       for (ggf_asset_t *new_asset = new_stage->assets;
            new_asset != new_asset_end; new_asset++) {
-        if (old_asset->data && old_asset->path_hash == new_asset->path_hash) {
+        if (old_asset->data && old_asset->path == new_asset->path) {
           new_asset->data_size = old_asset->data_size;
           new_asset->data = old_asset->data;
           old_asset->data_size = 0;
@@ -1630,9 +3236,11 @@ void ggf_asset_stage_use(ggf_asset_stage_index_t stage_idx) {
       }
     }
 
-    // free assets that are no longer used
+    // free assets that are no longer used and invalidate their handles
     for (ggf_asset_t *asset = current_stage->assets; asset != current_asset_end;
          asset++) {
+      ggf_handle_pool_remove(&system->handles, asset->handle);
+      asset->handle = GGF_INVALID_ID;
       if (asset->data) {
         ggf_memory_free(asset->data);
         asset->data = NULL;
@@ -1641,17 +3249,19 @@ void ggf_asset_stage_use(ggf_asset_stage_index_t stage_idx) {
     }
   }
 
-  // add to queue
-  pthread_mutex_lock(&system->assets_to_load_mutex);
+  // add to queue. spins if the loader is more than a full queue behind.
+  // the first asset of a name is the one found by name.
+  ggf_hash_map_clear(&system->handles_by_name);
   for (ggf_asset_t *asset = new_stage->assets; asset != new_asset_end;
        asset++) {
+    asset->handle = ggf_handle_pool_add(&system->handles, &asset);
+    ggf_hash_map_insert(&system->handles_by_name, &asset->name,
+                        &asset->handle);
     if (!asset->data) {
-      ggf_darray_push(system->assets_to_load, &asset);
+      while (!ggf_spsc_queue_push(&system->assets_to_load, 1, &asset))
+        ;
     }
   }
-  if (ggf_darray_get_length(system->assets_to_load) != 0)
-    pthread_cond_signal(&system->assets_available_cond);
-  pthread_mutex_unlock(&system->assets_to_load_mutex);
 
   system->current_stage_idx = stage_idx;
 }
@@ -1685,8 +3295,14 @@ b32 ggf_asset_system_find_full_asset_path(ggf_asset_type_t type,
     dir = "audio";
 
   if (dir) {
-    snprintf(out_buffer, out_buffer_len, "%s/%s/%s", system->assets_path, dir,
-             filename);
+    i32 length = snprintf(out_buffer, out_buffer_len, "%s/%s/%s",
+                          system->assets_path, dir, filename);
+    if (length < 0 || (u64)length >= out_buffer_len) {
+      GGF_ERROR("ERROR - ggf_asset_system_find_full_asset_path: path of %s "
+                "does not fit the buffer.",
+                filename);
+      return FALSE;
+    }
   } else {
     // TODO: Implement a search for the file
     GGF_WARN("WARNING - ggf_asset_system_find_full_asset_path: called with "
@@ -1699,79 +3315,515 @@ b32 ggf_asset_system_find_full_asset_path(ggf_asset_type_t type,
 ggf_asset_handle_t ggf_asset_get_handle(const char *name) {
   ggf_asset_system_t *system = (ggf_asset_system_t *)ggf_data->assets;
 
-  u64 name_hash = ggf_hash_string(name);
+  if (system->current_stage_idx == GGF_INVALID_ID) {
+    return GGF_INVALID_ID;
+  }
 
-  ggf_asset_t *assets = system->stages[system->current_stage_idx].assets;
-  for (u32 i = 0; i < ggf_darray_get_length(assets); i++) {
-    if ((assets + i)->name_hash == name_hash) {
-      return i;
-    }
+  // a name that was never interned cannot belong to any asset
+  ggf_string_id_t name_id = ggf_string_find(name);
+  if (name_id == GGF_INVALID_ID) {
+    return GGF_INVALID_ID;
   }
 
-  return GGF_INVALID_ID;
+  ggf_hash_map_iter_t it =
+      ggf_hash_map_find(&system->handles_by_name, &name_id);
+  if (!it) {
+    return GGF_INVALID_ID;
+  }
+  return *(ggf_asset_handle_t *)ggf_hash_map_value_from_iter(
+      &system->handles_by_name, it);
 }
 
 void *ggf_asset_get_data(ggf_asset_handle_t handle) {
   ggf_asset_system_t *system = (ggf_asset_system_t *)ggf_data->assets;
-  ggf_asset_t *asset =
-      system->stages[system->current_stage_idx].assets + handle;
-  return asset->data;
+  ggf_asset_t **asset =
+      (ggf_asset_t **)ggf_handle_pool_get(&system->handles, handle);
+  return asset ? (*asset)->data : NULL;
 }
 
 // GRAPHICS Layer
 
 #define GGF_GFX_MAX_TEXTURE_UNITS 16
-#define GGF_GFX_MAX_NUM_TRIANGLES 128
-#define GGF_GFX_MAX_NUM_QUADS 2048
-#define GGF_GFX_MAX_NUM_CIRCLES 128
-#define GGF_GFX_MAX_NUM_TEXT_CHARACTERS 512
-
+// batch storage starts this large (in primitives) and doubles when full
+#define GGF_GFX_INITIAL_BATCH_CAPACITY 64
+// draw calls recorded before a flush is forced, see ggf_gfx_set_max_commands
+#define GGF_GFX_DEFAULT_MAX_COMMANDS 65536
+
+/*
+    every draw call records a command with a 64 bit sort key, most significant
+   bits first:
+      layer (8) | blend mode (2) | pipeline (4) | texture (16) | depth (24)
+   the low 10 bits are unused. depth is encoded so that ascending keys go back
+   to front. the keys are radix sorted at flush, which is stable, so commands
+   with equal keys keep their submission order. depth stays below texture for
+   alpha blending too, see ggf_gfx_set_blend_mode in ggf.h.
+*/
+#define GGF_GFX_SORT_KEY_LAYER_SHIFT 56
+#define GGF_GFX_SORT_KEY_BLEND_MODE_SHIFT 54
+#define GGF_GFX_SORT_KEY_PIPELINE_SHIFT 50
+#define GGF_GFX_SORT_KEY_TEXTURE_SHIFT 34
+#define GGF_GFX_SORT_KEY_DEPTH_SHIFT 10
+
+// within a layer and blend mode pipelines are drawn in this order
+typedef enum {
+  GGF_GFX_PIPELINE_BASIC,
+  GGF_GFX_PIPELINE_STATIC_SPRITE, // a whole static batch per command
+  GGF_GFX_PIPELINE_SPRITE,
+  GGF_GFX_PIPELINE_SPRITE_ARRAY, // sprites sampling one texture array
+  GGF_GFX_PIPELINE_SHAPE,
+  GGF_GFX_PIPELINE_TEXT,
+  GGF_GFX_PIPELINE_MAX
+} ggf_gfx_pipeline_t;
+
+/*
+    vertex and instance layouts are uploaded as they are, so they hold plain
+   f32 arrays rather than cglm's 16 byte aligned vec4. a vec4 member would pad
+   the struct with bytes that get uploaded too, and let the compiler use
+   aligned stores when writing into mapped stream memory at any offset.
+*/
 typedef struct {
   vec3 position;
-  vec4 color;
+  f32 color[4];
   vec3 uv;
 } ggf_basic_vertex_t;
+_Static_assert(sizeof(ggf_basic_vertex_t) == 40,
+               "ggf_basic_vertex_t must not be padded");
+
+// shapes of the shape pipeline, evaluated as signed distance fields
+typedef enum {
+  GGF_GFX_SHAPE_CIRCLE,       // a: center, radius
+  GGF_GFX_SHAPE_ROUNDED_RECT, // a: center, b: half size, radius: corners
+  GGF_GFX_SHAPE_CAPSULE,      // a, b: segment end points, radius
+} ggf_gfx_shape_type_t;
 
+// one instance of the sprite pipeline, expanded to a quad in its vertex shader
 typedef struct {
-  vec3 world_position;
-  vec2 local_position;
-  vec4 color;
-  vec3 uv;
-} ggf_circle_vertex_t;
+  vec2 position; // top left corner before rotation
+  vec2 size;
+  f32 rotation; // radians, around the center
+  f32 depth;
+  u32 color; // RGBA8
+  f32 uv_rect[4]; // min u, min v, max u, max v
+  f32 texture_index; // unit, or layer for the sprite array pipeline
+} ggf_sprite_instance_t;
+_Static_assert(sizeof(ggf_sprite_instance_t) == 48,
+               "ggf_sprite_instance_t must not be padded");
+
+/*
+    one instance of the shape pipeline. the vertex shader covers the shape
+   with a quad reaching a pixel past its edge, whatever the camera's scale,
+   and the fragment shader evaluates its distance field, with one pixel of
+   anti-aliasing. a thickness above zero draws only an outline of that width
+   inside the edge, e.g. a ring for a circle.
+*/
+typedef struct {
+  vec2 a;
+  vec2 b;
+  f32 radius;
+  f32 thickness;
+  f32 rotation; // radians, rounded rects only
+  f32 depth;
+  u32 color; // RGBA8
+  f32 texture_index;
+  u32 type; // ggf_gfx_shape_type_t
+} ggf_shape_instance_t;
 
 typedef struct {
-  vec3 clear_color;
+  u32 texture;   // OpenGL texture (or texture array) id, 0 for the white
+                 // texture
+  u32 primitive; // index of the 4 vertices (or the instance) in the
+                 // pipeline's vertex stream
+} ggf_gfx_command_t;
 
-  u32 basic_vao, circle_vbo, circle_vao, basic_vbo, quad_ibo;
-  ggf_uniform_buffer_t camera_ubo;
-  u32 bound_texture_count;
-  u32 bound_textures[GGF_GFX_MAX_TEXTURE_UNITS];
-  ggf_texture_t white_texture;
-  ggf_shader_t basic_shader, circle_shader, text_shader;
+// a run of sorted commands drawn with a single draw call
+typedef struct {
+  u8 layer;
+  ggf_gfx_pipeline_t pipeline;
+  ggf_gfx_blend_mode_t blend_mode;
+  u32 first; // first primitive in the sorted vertex stream, the static
+             // draw for the static sprite pipeline
+  u32 count;
+  u32 texture_count;
+  u32 textures[GGF_GFX_MAX_TEXTURE_UNITS]; // the texture array alone for
+                                           // the sprite array pipeline
+} ggf_gfx_batch_t;
+
+/*
+    streaming vertex buffer split into GGF_GFX_STREAM_SEGMENT_COUNT segments
+   that are filled one after another. writes never wait for the GPU unless they
+   wrap around to a segment it may still read from; every segment gets a fence
+   when it is left and that fence is waited on before it is written again.
+   with buffer storage (GL 4.4 or GL_ARB_buffer_storage) the buffer is mapped
+   once, persistent and coherent. otherwise each write maps its range
+   unsynchronized.
+*/
+#define GGF_GFX_STREAM_SEGMENT_COUNT 3
 
-  u32 num_triangles;
-  ggf_basic_vertex_t triangle_vertices[3 * GGF_GFX_MAX_NUM_TRIANGLES];
+typedef struct {
+  u32 id;
+  u64 segment_size;
+  u32 segment;
+  u64 offset; // write offset in the current segment
+  u8 *persistent_memory;
+  GLsync fences[GGF_GFX_STREAM_SEGMENT_COUNT];
+} ggf_gfx_stream_buffer_t;
+
+/*
+    shadow of the GL state the renderer changes, so that binds and toggles
+   that would not change anything never reach the driver. GGF_INVALID_ID marks
+   a value as unknown, which makes the next change go through. deleting an
+   object resets the bindings GL resets along with it.
+*/
+typedef enum {
+  GGF_GFX_BUFFER_TARGET_ARRAY = 0,
+  GGF_GFX_BUFFER_TARGET_COPY_WRITE,
+  GGF_GFX_BUFFER_TARGET_UNIFORM,
+  GGF_GFX_BUFFER_TARGET_MAX
+} ggf_gfx_buffer_target_t;
 
-  u32 num_quads;
-  ggf_basic_vertex_t quad_vertices[4 * GGF_GFX_MAX_NUM_QUADS];
+typedef struct {
+  u32 program;
+  u32 vertex_array;
+  u32 buffers[GGF_GFX_BUFFER_TARGET_MAX];
+  u32 active_unit;
+  u32 textures[GGF_GFX_MAX_TEXTURE_UNITS];       // GL_TEXTURE_2D
+  u32 texture_arrays[GGF_GFX_MAX_TEXTURE_UNITS]; // GL_TEXTURE_2D_ARRAY
+  u32 depth_test;
+  u32 blend_mode;
+} ggf_gfx_state_cache_t;
+
+internal_func void ggf_internal_gfx_bind_buffer(ggf_gfx_buffer_target_t target,
+                                                u32 buffer);
+internal_func void ggf_internal_gfx_forget_buffer(u32 buffer);
 
-  u32 num_circles;
-  ggf_circle_vertex_t circle_vertices[4 * GGF_GFX_MAX_NUM_CIRCLES];
+internal_func void
+ggf_internal_gfx_stream_buffer_create(u64 segment_size,
+                                      ggf_gfx_stream_buffer_t *out_stream) {
+  ggf_memory_zero(out_stream, sizeof(ggf_gfx_stream_buffer_t));
+  out_stream->segment_size = segment_size;
+
+  u64 size = segment_size * GGF_GFX_STREAM_SEGMENT_COUNT;
+  glGenBuffers(1, &out_stream->id);
+  ggf_internal_gfx_bind_buffer(GGF_GFX_BUFFER_TARGET_ARRAY, out_stream->id);
+  if (ggf_data->gl_buffer_storage) {
+    GLbitfield flags =
+        GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(GL_ARRAY_BUFFER, size, NULL, flags);
+    out_stream->persistent_memory =
+        glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+  } else {
+    glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+  }
+}
 
-  u32 num_text_characters;
-  ggf_basic_vertex_t text_vertices[4 * GGF_GFX_MAX_NUM_TEXT_CHARACTERS];
+internal_func void
+ggf_internal_gfx_stream_buffer_destroy(ggf_gfx_stream_buffer_t *stream);
+
+// grows the segments to hold at least size bytes. returns TRUE if the buffer
+// was recreated, in which case vertex attributes have to be pointed at it again
+internal_func b32
+ggf_internal_gfx_stream_buffer_reserve(ggf_gfx_stream_buffer_t *stream,
+                                       u64 size) {
+  if (size <= stream->segment_size)
+    return FALSE;
 
-} ggf_gfx_t;
+  u64 segment_size = stream->segment_size * 2;
+  while (segment_size < size)
+    segment_size *= 2;
+  ggf_internal_gfx_stream_buffer_destroy(stream);
+  ggf_internal_gfx_stream_buffer_create(segment_size, stream);
+  return TRUE;
+}
 
-internal_func b32 ggf_internal_gfx_load_shader(const char *filename,
-                                               ggf_shader_t *out_shader) {
-  char full_file_path[512] = {};
-  if (!ggf_asset_system_find_full_asset_path(
-          GGF_ASSET_TYPE_SHADER, (char *)filename, 512, full_file_path)) {
-    GGF_ERROR("ERROR - ggf_internal_gfx_load_shader: unable to find shader "
-              "file '%s' at '%s'",
-              filename, full_file_path);
-    return FALSE;
+internal_func void
+ggf_internal_gfx_stream_buffer_destroy(ggf_gfx_stream_buffer_t *stream) {
+  for (u32 i = 0; i < GGF_GFX_STREAM_SEGMENT_COUNT; i++) {
+    if (stream->fences[i])
+      glDeleteSync(stream->fences[i]);
+  }
+  if (stream->persistent_memory) {
+    ggf_internal_gfx_bind_buffer(GGF_GFX_BUFFER_TARGET_ARRAY, stream->id);
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+  }
+  glDeleteBuffers(1, &stream->id);
+  ggf_internal_gfx_forget_buffer(stream->id);
+}
+
+// returns memory for size bytes, aligned to alignment within the buffer, and
+// its offset. must be followed by ggf_internal_gfx_stream_buffer_unmap.
+internal_func void *
+ggf_internal_gfx_stream_buffer_map(ggf_gfx_stream_buffer_t *stream, u64 size,
+                                   u64 alignment, u64 *out_offset) {
+  GGF_ASSERT(size <= stream->segment_size);
+
+  u64 offset = (stream->offset + alignment - 1) / alignment * alignment;
+  if (offset + size > stream->segment_size) {
+    // fence the segment we leave and wait until the next one is free
+    stream->fences[stream->segment] =
+        glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    stream->segment = (stream->segment + 1) % GGF_GFX_STREAM_SEGMENT_COUNT;
+    GLsync fence = stream->fences[stream->segment];
+    if (fence) {
+      // one second timeout, in nanoseconds
+      while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                              1000000000ull) == GL_TIMEOUT_EXPIRED)
+        ;
+      glDeleteSync(fence);
+      stream->fences[stream->segment] = NULL;
+    }
+    offset = 0;
+  }
+  stream->offset = offset + size;
+
+  *out_offset = stream->segment * stream->segment_size + offset;
+  if (stream->persistent_memory)
+    return stream->persistent_memory + *out_offset;
+
+  ggf_internal_gfx_bind_buffer(GGF_GFX_BUFFER_TARGET_ARRAY, stream->id);
+  return glMapBufferRange(GL_ARRAY_BUFFER, *out_offset, size,
+                          GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT |
+                              GL_MAP_INVALIDATE_RANGE_BIT);
+}
+
+internal_func void
+ggf_internal_gfx_stream_buffer_unmap(ggf_gfx_stream_buffer_t *stream) {
+  if (stream->persistent_memory)
+    return;
+  ggf_internal_gfx_bind_buffer(GGF_GFX_BUFFER_TARGET_ARRAY, stream->id);
+  glUnmapBuffer(GL_ARRAY_BUFFER);
+}
+
+/*
+    GPU timing. every timed interval lies between two GL_TIMESTAMP queries,
+   consecutive batches of a flush share the timestamp between them. the
+   queries of a frame are read back GGF_GFX_GPU_TIMER_FRAMES - 1 frames later,
+   when ggf_gfx_begin_frame reuses their slot in the ring. a frame whose
+   results are still not available then is dropped rather than waited for.
+   passes 0 to GGF_GFX_PIPELINE_MAX - 1 are the pipelines, user scopes are
+   added after them.
+*/
+#define GGF_GFX_GPU_TIMER_FRAMES 4
+#define GGF_GFX_GPU_TIMER_MAX_QUERIES 512
+#define GGF_GFX_GPU_TIMER_MAX_PASSES 32
+#define GGF_GFX_GPU_TIMER_MAX_DEPTH 8
+// weight of the newest frame in the smoothed times
+#define GGF_GFX_GPU_TIMER_SMOOTHING 0.1f
+
+typedef struct {
+  u8 pass;
+  u16 start, end; // query indices
+} ggf_gfx_gpu_interval_t;
+
+typedef struct {
+  u32 queries[GGF_GFX_GPU_TIMER_MAX_QUERIES];
+  u32 query_count;
+  ggf_gfx_gpu_interval_t intervals[GGF_GFX_GPU_TIMER_MAX_QUERIES];
+  u32 interval_count;
+} ggf_gfx_gpu_timer_frame_t;
+
+typedef struct {
+  b32 enabled, queries_created, overflowed;
+  u32 frame; // slot being recorded
+  ggf_gfx_gpu_timer_frame_t frames[GGF_GFX_GPU_TIMER_FRAMES];
+
+  u32 pass_count;
+  ggf_string_id_t pass_names[GGF_GFX_GPU_TIMER_MAX_PASSES];
+  f32 pass_ms[GGF_GFX_GPU_TIMER_MAX_PASSES];
+  f32 pass_smoothed_ms[GGF_GFX_GPU_TIMER_MAX_PASSES];
+  b32 has_samples;
+
+  // open user scopes: pass and start query
+  u32 depth;
+  u8 scope_passes[GGF_GFX_GPU_TIMER_MAX_DEPTH];
+  u32 scope_starts[GGF_GFX_GPU_TIMER_MAX_DEPTH];
+} ggf_gfx_gpu_timers_t;
+
+// the primitive of a static batch draw, the batch as it was when drawn
+typedef struct {
+  ggf_gfx_static_batch_t *batch;
+  u32 count;
+  u32 texture_count;
+  u32 textures[GGF_GFX_MAX_TEXTURE_UNITS];
+} ggf_gfx_static_draw_t;
+
+// recorded commands and their primitives, all darrays. they keep their
+// capacity between flushes.
+struct ggf_gfx_recorder_t {
+  u64 *command_keys;
+  ggf_gfx_command_t *commands;
+  ggf_basic_vertex_t *basic_vertices; // 4 vertices per element
+  ggf_sprite_instance_t *sprite_instances;
+  ggf_shape_instance_t *shape_instances;
+  ggf_gfx_static_draw_t *static_draws;
+
+  // state applied to recorded commands
+  u8 layer;
+  ggf_gfx_blend_mode_t blend_mode;
+};
+
+// the recorder of the calling thread, NULL for the main thread's
+global_variable __thread ggf_gfx_recorder_t *ggf_gfx_thread_recorder = NULL;
+
+/*
+    a static batch keeps its sprites as they are uploaded, with unit indices
+   into its own textures and hidden sprites sized zero, and records new ones
+   through a recorder. changes mark a range dirty that the next draw uploads
+   through an op, so that the GL work happens on the thread owning the
+   context. buffer and vao are only touched by that thread.
+*/
+struct ggf_gfx_static_batch_t {
+  ggf_gfx_recorder_t recorder;
+  ggf_sprite_instance_t *instances; // darray
+  vec2 *sizes;                      // darray, sizes of hidden sprites too
+  ggf_bitset_t visible;
+  u32 texture_count;
+  u32 textures[GGF_GFX_MAX_TEXTURE_UNITS]; // unit 0 is the white texture
+  u32 dirty_first, dirty_end;
+  u32 capacity; // sprites the GPU buffer holds, as of the last upload op
+
+  u32 buffer, vao;
+};
+
+/*
+    render thread mode. the main thread records a frame as a list of ops over
+   its draw calls, the ops are what ggf_gfx would otherwise have done with GL
+   right away. ggf_window_swap_buffers hands the frame to the render thread,
+   which owns the context, executes the ops and presents. frames go through
+   two spsc queues of frame indices: to_render and back to free, so neither
+   side takes a lock and a frame is only touched by one thread at a time.
+    stats and GPU pass times are measured on the render thread and come back
+   with the frame, the main thread picks them up when it reuses it.
+*/
+#define GGF_GFX_RENDER_THREAD_MAX_FRAMES 3
+// weight of the newest frame in the smoothed report
+#define GGF_GFX_RENDER_THREAD_SMOOTHING 0.1f
+
+typedef enum {
+  GGF_GFX_FRAME_OP_CLEAR,
+  GGF_GFX_FRAME_OP_FLUSH,
+  GGF_GFX_FRAME_OP_CAMERA,
+  GGF_GFX_FRAME_OP_VIEWPORT,
+  GGF_GFX_FRAME_OP_RENDER_TARGET,
+  GGF_GFX_FRAME_OP_GPU_TIMER_BEGIN,
+  GGF_GFX_FRAME_OP_GPU_TIMER_END,
+  GGF_GFX_FRAME_OP_STATIC_UPLOAD,
+  GGF_GFX_FRAME_OP_STATIC_DESTROY,
+} ggf_gfx_frame_op_type_t;
+
+// the end of the draw calls and of each primitive storage, the draw calls of
+// a flush are the ones between the previous flush's ends and its own
+typedef struct {
+  u32 commands, basic_vertices, sprite_instances, shape_instances;
+} ggf_gfx_recorder_ends_t;
+
+typedef struct {
+  ggf_gfx_frame_op_type_t type;
+  ggf_gfx_flush_reason_t reason;  // flush
+  b32 cull;                       // flush
+  ggf_gfx_recorder_ends_t ends;   // flush
+  mat4 view_projection;           // camera
+  vec3 clear_color;               // clear, render target
+  ggf_render_target_t *target;    // render target, NULL for the window
+  b32 clear;                      // render target
+  u32 width, height;              // viewport, render target
+  u32 pass;                       // GPU timer begin
+  ggf_gfx_static_batch_t *static_batch; // static upload, destroy
+  // static upload, in sprites. a capacity reallocates the buffer first.
+  u32 first, capacity;
+  // static upload. copied into the frame with a render thread, data is set
+  // to the copy when the op is executed.
+  const void *data;
+  u64 data_size, data_offset;
+} ggf_gfx_frame_op_t;
+
+typedef struct {
+  ggf_gfx_frame_op_t *ops; // darray
+  u8 *op_data;             // darray
+  ggf_gfx_recorder_t recorder;
+
+  // ns, from the main thread taking the frame to the render thread presenting
+  u64 record_start, submitted, render_start, presented;
+  f32 wait_ms; // main thread waiting for the frame to be free
+
+  // results, set once the frame has been presented
+  b32 presented_once;
+  ggf_gfx_stats_t stats;
+  f32 pass_ms[GGF_GFX_GPU_TIMER_MAX_PASSES];
+  f32 pass_smoothed_ms[GGF_GFX_GPU_TIMER_MAX_PASSES];
+} ggf_gfx_frame_t;
+
+typedef struct {
+  pthread_t thread;
+  ggf_window_t *window;
+  u32 frame_count;
+  ggf_gfx_frame_t frames[GGF_GFX_RENDER_THREAD_MAX_FRAMES];
+  ggf_spsc_queue_t to_render; // GGF_INVALID_ID stops the render thread
+  ggf_spsc_queue_t free;
+  void *queue_memory;
+  // flush scratch memory, the frame allocator belongs to the main thread
+  ggf_linear_allocator_t scratch;
+
+  // main thread side
+  u32 current; // frame being recorded
+  u32 flushed_commands; // of the current frame, ended by a flush op
+  ggf_gfx_render_thread_report_t report;
+  u64 last_presented;
+  f32 pass_ms[GGF_GFX_GPU_TIMER_MAX_PASSES];
+  f32 pass_smoothed_ms[GGF_GFX_GPU_TIMER_MAX_PASSES];
+} ggf_gfx_render_thread_t;
+
+// the camera uniform block of the shaders, std140
+typedef struct {
+  mat4 view_projection;
+  f32 viewport_size[2]; // pixels, of the viewport being drawn to
+  f32 reserved[2];
+} ggf_gfx_camera_block_t;
+
+typedef struct {
+  vec3 clear_color;
+  u32 width, height; // of the window
+  ggf_render_target_t *render_target; // NULL when drawing to the window
+
+  u32 basic_vao, sprite_vao, shape_vao, quad_ibo;
+  ggf_gfx_stream_buffer_t basic_stream, sprite_stream, shape_stream;
+  ggf_uniform_buffer_t camera_ubo;
+  ggf_texture_t white_texture;
+  ggf_shader_t basic_shader, sprite_shader, sprite_array_shader,
+      shape_shader, text_shader;
+
+  // the main thread's draw calls, flushed once there are max_commands
+  ggf_gfx_recorder_t recorder;
+  u32 max_commands;
+
+  // quads covered by quad_ibo
+  u32 quad_index_capacity;
+
+  ggf_gfx_gpu_timers_t gpu_timers;
+
+  ggf_gfx_state_cache_t state;
+
+  ggf_gfx_stats_t stats;      // of the frame being recorded
+  ggf_gfx_stats_t last_stats; // of the previous frame
+
+  ggf_gfx_render_thread_t *render_thread; // NULL when the mode is off
+
+  b32 culling_enabled; // main thread, passed on with every flush
+  // the camera draw calls are culled against, set where ops are executed
+  b32 cull_camera_set;
+  mat4 cull_view_projection;
+  // of the viewport being drawn to, set where ops are executed
+  u32 viewport_width, viewport_height;
+} ggf_gfx_t;
+
+internal_func b32 ggf_internal_gfx_load_shader(const char *filename,
+                                               ggf_shader_t *out_shader) {
+  char full_file_path[512] = {};
+  if (!ggf_asset_system_find_full_asset_path(
+          GGF_ASSET_TYPE_SHADER, (char *)filename, 512, full_file_path)) {
+    GGF_ERROR("ERROR - ggf_internal_gfx_load_shader: unable to find shader "
+              "file '%s' at '%s'",
+              filename, full_file_path);
+    return FALSE;
   }
 
   ggf_file_handle_t file = ggf_file_open(full_file_path, GGF_FILE_MODE_READ);
@@ -1821,33 +3873,176 @@ internal_func b32 ggf_internal_gfx_load_shader(const char *filename,
   return TRUE;
 }
 
-b32 ggf_gfx_init(u32 width, u32 height) {
-  GGF_ASSERT(width && height);
+// the helpers below fall back to plain GL calls while ggf_gfx isn't
+// initialized, textures and buffers can be created before it
 
-  ggf_gfx_t *gfx = ggf_memory_alloc(sizeof(ggf_gfx_t), GGF_MEMORY_TAG_GRAPHICS);
-  ggf_data->gfx = gfx;
+void ggf_gfx_reset_state_cache() {
+  ggf_gfx_t *gfx = ggf_data->gfx;
+  ggf_platform_mem_set(&gfx->state, 0xFF, sizeof(gfx->state));
+}
 
-  glm_vec3_copy((vec3){0.0f, 0.0f, 0.0f}, gfx->clear_color);
+internal_func void ggf_internal_gfx_use_program(u32 program) {
+  ggf_gfx_t *gfx = ggf_data->gfx;
+  if (gfx && gfx->state.program == program) {
+    gfx->stats.gl_calls_saved++;
+    return;
+  }
+  glUseProgram(program);
+  if (gfx) {
+    gfx->state.program = program;
+    gfx->stats.program_switches++;
+  }
+}
+
+internal_func void ggf_internal_gfx_bind_vertex_array(u32 vertex_array) {
+  ggf_gfx_t *gfx = ggf_data->gfx;
+  if (gfx && gfx->state.vertex_array == vertex_array) {
+    gfx->stats.gl_calls_saved++;
+    return;
+  }
+  glBindVertexArray(vertex_array);
+  if (gfx)
+    gfx->state.vertex_array = vertex_array;
+}
+
+internal_func void ggf_internal_gfx_bind_buffer(ggf_gfx_buffer_target_t target,
+                                                u32 buffer) {
+  const GLenum gl_targets[GGF_GFX_BUFFER_TARGET_MAX] = {
+      GL_ARRAY_BUFFER, GL_COPY_WRITE_BUFFER, GL_UNIFORM_BUFFER};
+  ggf_gfx_t *gfx = ggf_data->gfx;
+  if (gfx && gfx->state.buffers[target] == buffer) {
+    gfx->stats.gl_calls_saved++;
+    return;
+  }
+  glBindBuffer(gl_targets[target], buffer);
+  if (gfx)
+    gfx->state.buffers[target] = buffer;
+}
 
-  // basic vbo
-  glGenBuffers(1, &gfx->basic_vbo);
-  glBindBuffer(GL_ARRAY_BUFFER, gfx->basic_vbo);
-  glBufferData(GL_ARRAY_BUFFER,
-               sizeof(ggf_basic_vertex_t) *
-                   (GGF_GFX_MAX_NUM_TRIANGLES * 3 + GGF_GFX_MAX_NUM_QUADS * 4 +
-                    GGF_GFX_MAX_NUM_TEXT_CHARACTERS * 4),
-               NULL, GL_DYNAMIC_DRAW);
-
-  // circle vbo
-  glGenBuffers(1, &gfx->circle_vbo);
-  glBindBuffer(GL_ARRAY_BUFFER, gfx->circle_vbo);
-  glBufferData(GL_ARRAY_BUFFER,
-               sizeof(ggf_circle_vertex_t) * GGF_GFX_MAX_NUM_CIRCLES, NULL,
-               GL_DYNAMIC_DRAW);
-
-  u32 quad_indices[6 * GGF_GFX_MAX_NUM_QUADS];
+// binds texture to unit, target is GL_TEXTURE_2D or GL_TEXTURE_2D_ARRAY. the
+// unit is only made active when something has to be bound to it.
+internal_func void ggf_internal_gfx_bind_texture(u32 unit, GLenum target,
+                                                 u32 texture) {
+  ggf_gfx_t *gfx = ggf_data->gfx;
+  if (!gfx) {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(target, texture);
+    return;
+  }
+
+  u32 *bound = target == GL_TEXTURE_2D_ARRAY ? &gfx->state.texture_arrays[unit]
+                                             : &gfx->state.textures[unit];
+  if (*bound == texture) {
+    gfx->stats.gl_calls_saved += 2;
+    return;
+  }
+  if (gfx->state.active_unit != unit) {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    gfx->state.active_unit = unit;
+  } else {
+    gfx->stats.gl_calls_saved++;
+  }
+  glBindTexture(target, texture);
+  *bound = texture;
+  gfx->stats.texture_binds++;
+}
+
+internal_func void ggf_internal_gfx_set_depth_test(b32 enabled) {
+  ggf_gfx_t *gfx = ggf_data->gfx;
+  if (gfx->state.depth_test == enabled) {
+    gfx->stats.gl_calls_saved++;
+    return;
+  }
+  if (enabled)
+    glEnable(GL_DEPTH_TEST);
+  else
+    glDisable(GL_DEPTH_TEST);
+  gfx->state.depth_test = enabled;
+}
+
+internal_func void
+ggf_internal_gfx_apply_blend_mode(ggf_gfx_blend_mode_t blend_mode) {
+  ggf_gfx_t *gfx = ggf_data->gfx;
+  if (gfx->state.blend_mode == blend_mode) {
+    gfx->stats.gl_calls_saved +=
+        blend_mode == GGF_GFX_BLEND_MODE_OPAQUE ? 1 : 2;
+    return;
+  }
+  gfx->state.blend_mode = blend_mode;
+
+  switch (blend_mode) {
+  case GGF_GFX_BLEND_MODE_OPAQUE:
+    glDisable(GL_BLEND);
+    break;
+  case GGF_GFX_BLEND_MODE_ALPHA:
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    break;
+  case GGF_GFX_BLEND_MODE_ADDITIVE:
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+    break;
+  default:
+    GGF_ASSERT(FALSE);
+  }
+}
+
+// GL unbinds deleted objects, the cache has to follow
+internal_func void ggf_internal_gfx_forget_texture(u32 texture) {
+  ggf_gfx_t *gfx = ggf_data->gfx;
+  if (!gfx)
+    return;
+  for (u32 i = 0; i < GGF_GFX_MAX_TEXTURE_UNITS; i++) {
+    if (gfx->state.textures[i] == texture)
+      gfx->state.textures[i] = 0;
+    if (gfx->state.texture_arrays[i] == texture)
+      gfx->state.texture_arrays[i] = 0;
+  }
+}
+
+internal_func void ggf_internal_gfx_forget_buffer(u32 buffer) {
+  ggf_gfx_t *gfx = ggf_data->gfx;
+  if (!gfx)
+    return;
+  for (u32 i = 0; i < GGF_GFX_BUFFER_TARGET_MAX; i++) {
+    if (gfx->state.buffers[i] == buffer)
+      gfx->state.buffers[i] = 0;
+  }
+}
+
+internal_func void ggf_internal_gfx_forget_vertex_array(u32 vertex_array) {
+  ggf_gfx_t *gfx = ggf_data->gfx;
+  if (gfx && gfx->state.vertex_array == vertex_array)
+    gfx->state.vertex_array = 0;
+}
+
+// a deleted program stays in use until another one is, so only its name may
+// be reused
+internal_func void ggf_internal_gfx_forget_program(u32 program) {
+  ggf_gfx_t *gfx = ggf_data->gfx;
+  if (gfx && gfx->state.program == program)
+    gfx->state.program = GGF_INVALID_ID;
+}
+
+// makes quad_ibo cover at least quad_count quads. every primitive of the
+// basic pipeline is drawn as a quad, triangles repeat their last
+// vertex.
+internal_func void ggf_internal_gfx_reserve_quad_indices(u32 quad_count) {
+  ggf_gfx_t *gfx = ggf_data->gfx;
+  if (quad_count <= gfx->quad_index_capacity)
+    return;
+
+  u32 capacity = gfx->quad_index_capacity ? gfx->quad_index_capacity
+                                          : GGF_GFX_INITIAL_BATCH_CAPACITY;
+  while (capacity < quad_count)
+    capacity *= 2;
+
+  ggf_linear_allocator_t *frame_allocator = ggf_get_frame_allocator();
+  u64 marker = frame_allocator->marker;
+  u32 *quad_indices = ggf_linear_allocator_alloc_aligned(
+      frame_allocator, sizeof(u32) * 6 * capacity, 4);
   u32 offset = 0;
-  for (u32 i = 0; i < GGF_GFX_MAX_NUM_QUADS; i++) {
+  for (u32 i = 0; i < capacity; i++) {
     quad_indices[i * 6 + 0] = offset + 0;
     quad_indices[i * 6 + 1] = offset + 1;
     quad_indices[i * 6 + 2] = offset + 2;
@@ -1858,16 +4053,25 @@ b32 ggf_gfx_init(u32 width, u32 height) {
 
     offset += 4;
   }
-  glGenBuffers(1, &gfx->quad_ibo);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gfx->quad_ibo);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-               sizeof(u32) * GGF_ARRAY_COUNT(quad_indices), quad_indices,
+  // not bound as element array buffer, that would change the bound vao
+  ggf_internal_gfx_bind_buffer(GGF_GFX_BUFFER_TARGET_COPY_WRITE, gfx->quad_ibo);
+  glBufferData(GL_COPY_WRITE_BUFFER, sizeof(u32) * 6 * capacity, quad_indices,
                GL_STATIC_DRAW);
+  gfx->stats.bytes_uploaded += sizeof(u32) * 6 * capacity;
+  ggf_linear_allocator_free_to_marker(frame_allocator, marker);
 
-  // basic vao
-  glGenVertexArrays(1, &gfx->basic_vao);
-  glBindVertexArray(gfx->basic_vao);
-  glBindBuffer(GL_ARRAY_BUFFER, gfx->basic_vbo);
+  gfx->quad_index_capacity = capacity;
+}
+
+// points the basic vao at its vertex stream, needed again whenever the stream
+// is recreated
+internal_func void ggf_internal_gfx_set_stream_attributes() {
+  ggf_gfx_t *gfx = ggf_data->gfx;
+
+  ggf_internal_gfx_bind_vertex_array(gfx->basic_vao);
+  ggf_internal_gfx_bind_buffer(GGF_GFX_BUFFER_TARGET_ARRAY,
+                               gfx->basic_stream.id);
+  // part of the vao's state, not cached
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gfx->quad_ibo);
   glEnableVertexAttribArray(0);
   glEnableVertexAttribArray(1);
@@ -1879,33 +4083,141 @@ b32 ggf_gfx_init(u32 width, u32 height) {
   glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(ggf_basic_vertex_t),
                         (void *)offsetof(ggf_basic_vertex_t, uv));
 
-  // circle vao
-  glGenVertexArrays(1, &gfx->circle_vao);
-  glBindVertexArray(gfx->circle_vao);
-  glBindBuffer(GL_ARRAY_BUFFER, gfx->circle_vbo);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gfx->quad_ibo);
-  glEnableVertexAttribArray(0);
-  glEnableVertexAttribArray(1);
-  glEnableVertexAttribArray(2);
-  glEnableVertexAttribArray(3);
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(ggf_circle_vertex_t),
-                        (void *)offsetof(ggf_circle_vertex_t, world_position));
-  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(ggf_circle_vertex_t),
-                        (void *)offsetof(ggf_circle_vertex_t, local_position));
-  glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(ggf_circle_vertex_t),
-                        (void *)offsetof(ggf_circle_vertex_t, color));
-  glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(ggf_circle_vertex_t),
-                        (void *)offsetof(ggf_circle_vertex_t, uv));
+  ggf_internal_gfx_bind_vertex_array(0);
+}
+
+internal_func void ggf_internal_gfx_recorder_init(ggf_gfx_recorder_t *recorder) {
+  u32 capacity = GGF_GFX_INITIAL_BATCH_CAPACITY;
+  recorder->command_keys = ggf_darray_create(capacity, sizeof(u64));
+  recorder->commands = ggf_darray_create(capacity, sizeof(ggf_gfx_command_t));
+  recorder->basic_vertices =
+      ggf_darray_create(capacity, sizeof(ggf_basic_vertex_t) * 4);
+  recorder->sprite_instances =
+      ggf_darray_create(capacity, sizeof(ggf_sprite_instance_t));
+  recorder->shape_instances =
+      ggf_darray_create(capacity, sizeof(ggf_shape_instance_t));
+  recorder->static_draws = ggf_darray_create(4, sizeof(ggf_gfx_static_draw_t));
+  recorder->layer = 0;
+  recorder->blend_mode = GGF_GFX_BLEND_MODE_ALPHA;
+}
+
+internal_func void ggf_internal_gfx_recorder_free(ggf_gfx_recorder_t *recorder) {
+  ggf_darray_destroy(recorder->command_keys);
+  ggf_darray_destroy(recorder->commands);
+  ggf_darray_destroy(recorder->basic_vertices);
+  ggf_darray_destroy(recorder->sprite_instances);
+  ggf_darray_destroy(recorder->shape_instances);
+  ggf_darray_destroy(recorder->static_draws);
+}
+
+internal_func void
+ggf_internal_gfx_recorder_clear(ggf_gfx_recorder_t *recorder) {
+  ggf_darray_clear(recorder->command_keys);
+  ggf_darray_clear(recorder->commands);
+  ggf_darray_clear(recorder->basic_vertices);
+  ggf_darray_clear(recorder->sprite_instances);
+  ggf_darray_clear(recorder->shape_instances);
+  ggf_darray_clear(recorder->static_draws);
+}
+
+// the darray holding the primitives of pipeline
+internal_func void **
+ggf_internal_gfx_recorder_storage(ggf_gfx_recorder_t *recorder,
+                                  ggf_gfx_pipeline_t pipeline) {
+  switch (pipeline) {
+  case GGF_GFX_PIPELINE_SPRITE:
+  case GGF_GFX_PIPELINE_SPRITE_ARRAY:
+    return (void **)&recorder->sprite_instances;
+  case GGF_GFX_PIPELINE_SHAPE:
+    return (void **)&recorder->shape_instances;
+  case GGF_GFX_PIPELINE_STATIC_SPRITE:
+    return (void **)&recorder->static_draws;
+  default:
+    return (void **)&recorder->basic_vertices;
+  }
+}
+
+internal_func ggf_gfx_recorder_t *ggf_internal_gfx_get_recorder() {
+  if (ggf_gfx_thread_recorder)
+    return ggf_gfx_thread_recorder;
+  return &((ggf_gfx_t *)ggf_data->gfx)->recorder;
+}
+
+// the main thread's draw calls since the last flush. with a render thread a
+// flush only ends them, they stay recorded until the frame is submitted.
+internal_func u32 ggf_internal_gfx_unflushed_commands(ggf_gfx_t *gfx) {
+  u32 count = ggf_darray_get_length(gfx->recorder.commands);
+  if (gfx->render_thread)
+    count -= gfx->render_thread->flushed_commands;
+  return count;
+}
+
+b32 ggf_gfx_init(u32 width, u32 height) {
+  GGF_ASSERT(width && height);
+
+  ggf_gfx_t *gfx = ggf_memory_alloc(sizeof(ggf_gfx_t), GGF_MEMORY_TAG_GRAPHICS);
+  ggf_data->gfx = gfx;
+  ggf_gfx_reset_state_cache();
+
+  glm_vec3_copy((vec3){0.0f, 0.0f, 0.0f}, gfx->clear_color);
+  gfx->width = width;
+  gfx->height = height;
+
+  gfx->max_commands = GGF_GFX_DEFAULT_MAX_COMMANDS;
+  gfx->culling_enabled = TRUE;
+  u32 capacity = GGF_GFX_INITIAL_BATCH_CAPACITY;
+  ggf_internal_gfx_recorder_init(&gfx->recorder);
+
+  // vertex streams, grown at flush to the largest flush seen
+  ggf_internal_gfx_stream_buffer_create(
+      sizeof(ggf_basic_vertex_t) * 4 * capacity, &gfx->basic_stream);
+  ggf_internal_gfx_stream_buffer_create(
+      sizeof(ggf_sprite_instance_t) * capacity, &gfx->sprite_stream);
+  ggf_internal_gfx_stream_buffer_create(
+      sizeof(ggf_shape_instance_t) * capacity, &gfx->shape_stream);
+
+  glGenBuffers(1, &gfx->quad_ibo);
+  ggf_internal_gfx_reserve_quad_indices(capacity);
+
+  glGenVertexArrays(1, &gfx->basic_vao);
+  ggf_internal_gfx_set_stream_attributes();
+
+  // sprite and shape vaos, every attribute is per instance. the pointers are
+  // set per batch by ggf_internal_gfx_set_instance_attributes.
+  glGenVertexArrays(1, &gfx->sprite_vao);
+  ggf_internal_gfx_bind_vertex_array(gfx->sprite_vao);
+  for (u32 i = 0; i < 5; i++) {
+    glEnableVertexAttribArray(i);
+    glVertexAttribDivisor(i, 1);
+  }
+  glGenVertexArrays(1, &gfx->shape_vao);
+  ggf_internal_gfx_bind_vertex_array(gfx->shape_vao);
+  for (u32 i = 0; i < 5; i++) {
+    glEnableVertexAttribArray(i);
+    glVertexAttribDivisor(i, 1);
+  }
 
   ggf_internal_gfx_load_shader("basic.glsl", &gfx->basic_shader);
-  ggf_internal_gfx_load_shader("circle.glsl", &gfx->circle_shader);
+  ggf_internal_gfx_load_shader("sprite.glsl", &gfx->sprite_shader);
+  ggf_internal_gfx_load_shader("sprite_array.glsl", &gfx->sprite_array_shader);
+  ggf_internal_gfx_load_shader("shape.glsl", &gfx->shape_shader);
   ggf_internal_gfx_load_shader("text.glsl", &gfx->text_shader);
 
-  ggf_uniform_buffer_create(sizeof(mat4), NULL, &gfx->camera_ubo);
+  ggf_gfx_camera_block_t camera_block = {0};
+  camera_block.viewport_size[0] = width;
+  camera_block.viewport_size[1] = height;
+  gfx->viewport_width = width;
+  gfx->viewport_height = height;
+  ggf_uniform_buffer_create(sizeof(camera_block), &camera_block,
+                            &gfx->camera_ubo);
 
   ggf_shader_bind_uniform_buffer(&gfx->basic_shader, "camera",
                                  &gfx->camera_ubo);
-  ggf_shader_bind_uniform_buffer(&gfx->circle_shader, "camera",
+  ggf_shader_bind_uniform_buffer(&gfx->sprite_shader, "camera",
+                                 &gfx->camera_ubo);
+  ggf_shader_bind_uniform_buffer(&gfx->sprite_array_shader, "camera",
+                                 &gfx->camera_ubo);
+  ggf_shader_bind_uniform_buffer(&gfx->shape_shader, "camera",
                                  &gfx->camera_ubo);
   ggf_shader_bind_uniform_buffer(&gfx->text_shader, "camera", &gfx->camera_ubo);
 
@@ -1914,33 +4226,45 @@ b32 ggf_gfx_init(u32 width, u32 height) {
     snprintf(sampler_uniform_name, sizeof(sampler_uniform_name), "textures[%d]",
              i);
 
-    glUseProgram(gfx->basic_shader.id);
+    ggf_internal_gfx_use_program(gfx->basic_shader.id);
     i32 location =
         glGetUniformLocation(gfx->basic_shader.id, sampler_uniform_name);
     glUniform1i(location, i);
 
-    glUseProgram(gfx->circle_shader.id);
+    ggf_internal_gfx_use_program(gfx->sprite_shader.id);
+    location =
+        glGetUniformLocation(gfx->sprite_shader.id, sampler_uniform_name);
+    glUniform1i(location, i);
+
+    ggf_internal_gfx_use_program(gfx->shape_shader.id);
     location =
-        glGetUniformLocation(gfx->circle_shader.id, sampler_uniform_name);
+        glGetUniformLocation(gfx->shape_shader.id, sampler_uniform_name);
     glUniform1i(location, i);
 
-    glUseProgram(gfx->text_shader.id);
+    ggf_internal_gfx_use_program(gfx->text_shader.id);
     location = glGetUniformLocation(gfx->text_shader.id, sampler_uniform_name);
     glUniform1i(location, i);
   }
+  ggf_internal_gfx_use_program(gfx->sprite_array_shader.id);
+  glUniform1i(
+      glGetUniformLocation(gfx->sprite_array_shader.id, "texture_array"), 0);
 
   glEnable(GL_FRAMEBUFFER_SRGB);
-  glEnable(GL_DEPTH_TEST);
-  glEnable(GL_BLEND);
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  ggf_internal_gfx_set_depth_test(TRUE);
+  ggf_internal_gfx_apply_blend_mode(GGF_GFX_BLEND_MODE_ALPHA);
 
   u32 white_pixel_data = 0xFFFFFFFF;
   ggf_texture_create(&white_pixel_data, GGF_TEXTURE_FORMAT_RGBA8, 1, 1,
                      GGF_TEXTURE_FILTER_NEAREST, GGF_TEXTURE_WRAP_REPEAT,
                      &gfx->white_texture);
 
-  gfx->bound_texture_count = 1;
-  gfx->bound_textures[0] = gfx->white_texture.id;
+  // pipeline passes, in ggf_gfx_pipeline_t order
+  const char *pipeline_names[GGF_GFX_PIPELINE_MAX] = {
+      "basic", "static sprite", "sprite", "sprite array", "shape", "text"};
+  for (u32 i = 0; i < GGF_GFX_PIPELINE_MAX; i++) {
+    gfx->gpu_timers.pass_names[i] = ggf_string_intern(pipeline_names[i]);
+  }
+  gfx->gpu_timers.pass_count = GGF_GFX_PIPELINE_MAX;
 
   i32 err = glGetError();
   if (err != GL_NO_ERROR) {
@@ -1952,256 +4276,1938 @@ b32 ggf_gfx_init(u32 width, u32 height) {
 }
 
 void ggf_gfx_shutdown() {
+  ggf_gfx_stop_render_thread();
   ggf_gfx_t *gfx = ggf_data->gfx;
 
   ggf_texture_destroy(&gfx->white_texture);
 
+  if (gfx->gpu_timers.queries_created) {
+    for (u32 i = 0; i < GGF_GFX_GPU_TIMER_FRAMES; i++) {
+      glDeleteQueries(GGF_GFX_GPU_TIMER_MAX_QUERIES,
+                      gfx->gpu_timers.frames[i].queries);
+    }
+  }
+
   glDeleteBuffers(1, &gfx->quad_ibo);
-  glDeleteBuffers(1, &gfx->circle_vbo);
-  glDeleteBuffers(1, &gfx->basic_vbo);
-  glDeleteVertexArrays(1, &gfx->circle_vao);
+  ggf_internal_gfx_forget_buffer(gfx->quad_ibo);
+  ggf_internal_gfx_stream_buffer_destroy(&gfx->shape_stream);
+  ggf_internal_gfx_stream_buffer_destroy(&gfx->sprite_stream);
+  ggf_internal_gfx_stream_buffer_destroy(&gfx->basic_stream);
+  glDeleteVertexArrays(1, &gfx->shape_vao);
+  glDeleteVertexArrays(1, &gfx->sprite_vao);
   glDeleteVertexArrays(1, &gfx->basic_vao);
+  ggf_internal_gfx_bind_vertex_array(0);
 
   ggf_shader_destroy(&gfx->basic_shader);
 
-  ggf_memory_free(gfx);
+  ggf_internal_gfx_recorder_free(&gfx->recorder);
+
+  ggf_memory_free(gfx);
+  // textures may outlive ggf_gfx, see the state cache
+  ggf_data->gfx = NULL;
+}
+
+void ggf_gfx_set_clear_color(vec3 color) {
+  ggf_gfx_t *gfx = ggf_data->gfx;
+  glm_vec3_copy(color, gfx->clear_color);
+}
+
+// issues a timestamp query in the frame being recorded. returns its index, or
+// GGF_INVALID_ID if timers are off or the frame ran out of queries.
+internal_func u32 ggf_internal_gfx_gpu_timestamp() {
+  ggf_gfx_gpu_timers_t *timers = &((ggf_gfx_t *)ggf_data->gfx)->gpu_timers;
+  if (!timers->enabled)
+    return GGF_INVALID_ID;
+
+  ggf_gfx_gpu_timer_frame_t *frame = &timers->frames[timers->frame];
+  if (frame->query_count == GGF_GFX_GPU_TIMER_MAX_QUERIES) {
+    if (!timers->overflowed)
+      GGF_WARN("WARNING - ggf_internal_gfx_gpu_timestamp: out of queries, "
+               "increase [GGF_GFX_GPU_TIMER_MAX_QUERIES]");
+    timers->overflowed = TRUE;
+    return GGF_INVALID_ID;
+  }
+  glQueryCounter(frame->queries[frame->query_count], GL_TIMESTAMP);
+  return frame->query_count++;
+}
+
+internal_func void ggf_internal_gfx_gpu_interval(u32 pass, u32 start,
+                                                 u32 end) {
+  ggf_gfx_gpu_timers_t *timers = &((ggf_gfx_t *)ggf_data->gfx)->gpu_timers;
+  if (start == GGF_INVALID_ID || end == GGF_INVALID_ID)
+    return;
+  ggf_gfx_gpu_timer_frame_t *frame = &timers->frames[timers->frame];
+  ggf_gfx_gpu_interval_t *interval =
+      &frame->intervals[frame->interval_count++];
+  interval->pass = pass;
+  interval->start = start;
+  interval->end = end;
+}
+
+// reads back the oldest frame of the ring, if the GPU is done with it, and
+// clears its slot for recording
+internal_func void ggf_internal_gfx_gpu_timers_next_frame() {
+  ggf_gfx_gpu_timers_t *timers = &((ggf_gfx_t *)ggf_data->gfx)->gpu_timers;
+  timers->frame = (timers->frame + 1) % GGF_GFX_GPU_TIMER_FRAMES;
+  ggf_gfx_gpu_timer_frame_t *frame = &timers->frames[timers->frame];
+  if (frame->query_count == 0)
+    return;
+
+  // timestamps complete in order, so the last one tells for all of them
+  GLint available = 0;
+  glGetQueryObjectiv(frame->queries[frame->query_count - 1],
+                     GL_QUERY_RESULT_AVAILABLE, &available);
+  if (available) {
+    GLuint64 timestamps[GGF_GFX_GPU_TIMER_MAX_QUERIES];
+    for (u32 i = 0; i < frame->query_count; i++) {
+      glGetQueryObjectui64v(frame->queries[i], GL_QUERY_RESULT, &timestamps[i]);
+    }
+
+    f32 frame_ms[GGF_GFX_GPU_TIMER_MAX_PASSES] = {0};
+    for (u32 i = 0; i < frame->interval_count; i++) {
+      ggf_gfx_gpu_interval_t *interval = &frame->intervals[i];
+      frame_ms[interval->pass] +=
+          (f32)(timestamps[interval->end] - timestamps[interval->start]) /
+          1000000.0f;
+    }
+    // every pass, pass_count belongs to the main thread in render thread mode
+    for (u32 i = 0; i < GGF_GFX_GPU_TIMER_MAX_PASSES; i++) {
+      timers->pass_ms[i] = frame_ms[i];
+      timers->pass_smoothed_ms[i] =
+          timers->has_samples
+              ? glm_lerp(timers->pass_smoothed_ms[i], frame_ms[i],
+                         GGF_GFX_GPU_TIMER_SMOOTHING)
+              : frame_ms[i];
+    }
+    timers->has_samples = TRUE;
+  }
+
+  frame->query_count = 0;
+  frame->interval_count = 0;
+}
+
+// points the attributes of the bound sprite or shape vao at the instances
+// starting at offset in buffer. done per batch for the streams because base
+// instance draws need GL 4.2.
+internal_func void
+ggf_internal_gfx_set_instance_attributes(ggf_gfx_pipeline_t pipeline,
+                                         u32 buffer, u64 offset) {
+  ggf_internal_gfx_bind_buffer(GGF_GFX_BUFFER_TARGET_ARRAY, buffer);
+  if (pipeline == GGF_GFX_PIPELINE_SHAPE) {
+    u32 stride = sizeof(ggf_shape_instance_t);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, stride,
+                          (void *)(offset + offsetof(ggf_shape_instance_t, a)));
+    glVertexAttribPointer(
+        1, 4, GL_FLOAT, GL_FALSE, stride,
+        (void *)(offset + offsetof(ggf_shape_instance_t, radius)));
+    glVertexAttribPointer(
+        2, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride,
+        (void *)(offset + offsetof(ggf_shape_instance_t, color)));
+    glVertexAttribPointer(
+        3, 1, GL_FLOAT, GL_FALSE, stride,
+        (void *)(offset + offsetof(ggf_shape_instance_t, texture_index)));
+    glVertexAttribIPointer(
+        4, 1, GL_UNSIGNED_INT, stride,
+        (void *)(offset + offsetof(ggf_shape_instance_t, type)));
+    return;
+  }
+
+  u32 stride = sizeof(ggf_sprite_instance_t);
+  glVertexAttribPointer(
+      0, 4, GL_FLOAT, GL_FALSE, stride,
+      (void *)(offset + offsetof(ggf_sprite_instance_t, position)));
+  glVertexAttribPointer(
+      1, 2, GL_FLOAT, GL_FALSE, stride,
+      (void *)(offset + offsetof(ggf_sprite_instance_t, rotation)));
+  glVertexAttribPointer(
+      2, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride,
+      (void *)(offset + offsetof(ggf_sprite_instance_t, color)));
+  glVertexAttribPointer(
+      3, 4, GL_FLOAT, GL_FALSE, stride,
+      (void *)(offset + offsetof(ggf_sprite_instance_t, uv_rect)));
+  glVertexAttribPointer(
+      4, 1, GL_FLOAT, GL_FALSE, stride,
+      (void *)(offset + offsetof(ggf_sprite_instance_t, texture_index)));
+}
+
+// creates the buffer and vao of a static batch on its first upload, a
+// capacity reallocates the buffer before the data is written
+internal_func void ggf_internal_gfx_static_upload(ggf_gfx_frame_op_t *op) {
+  ggf_gfx_t *gfx = ggf_data->gfx;
+  ggf_gfx_static_batch_t *batch = op->static_batch;
+  if (!batch->vao) {
+    glGenBuffers(1, &batch->buffer);
+    glGenVertexArrays(1, &batch->vao);
+    ggf_internal_gfx_bind_vertex_array(batch->vao);
+    for (u32 i = 0; i < 5; i++) {
+      glEnableVertexAttribArray(i);
+      glVertexAttribDivisor(i, 1);
+    }
+    ggf_internal_gfx_set_instance_attributes(GGF_GFX_PIPELINE_SPRITE,
+                                             batch->buffer, 0);
+  }
+
+  u64 stride = sizeof(ggf_sprite_instance_t);
+  ggf_internal_gfx_bind_buffer(GGF_GFX_BUFFER_TARGET_ARRAY, batch->buffer);
+  if (op->capacity)
+    glBufferData(GL_ARRAY_BUFFER, stride * op->capacity, NULL,
+                 GL_STATIC_DRAW);
+  glBufferSubData(GL_ARRAY_BUFFER, stride * op->first, op->data_size,
+                  op->data);
+  gfx->stats.bytes_uploaded += op->data_size;
+}
+
+// the shape shader sizes its anti-aliased edge with the viewport size
+internal_func void ggf_internal_gfx_set_viewport(u32 width, u32 height) {
+  ggf_gfx_t *gfx = ggf_data->gfx;
+  glViewport(0, 0, width, height);
+  gfx->viewport_width = width;
+  gfx->viewport_height = height;
+  f32 viewport_size[2] = {(f32)width, (f32)height};
+  ggf_uniform_buffer_set_data(&gfx->camera_ubo,
+                              offsetof(ggf_gfx_camera_block_t, viewport_size),
+                              sizeof(viewport_size), viewport_size);
+  gfx->stats.bytes_uploaded += sizeof(viewport_size);
+}
+
+// does the GL work of an op, flushes excepted
+internal_func void ggf_internal_gfx_execute_op(ggf_gfx_frame_op_t *op) {
+  ggf_gfx_t *gfx = ggf_data->gfx;
+  ggf_gfx_gpu_timers_t *timers = &gfx->gpu_timers;
+  switch (op->type) {
+  case GGF_GFX_FRAME_OP_CLEAR:
+    ggf_internal_gfx_gpu_timers_next_frame();
+    glClearColor(op->clear_color[0], op->clear_color[1], op->clear_color[2],
+                 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    break;
+  case GGF_GFX_FRAME_OP_CAMERA:
+    ggf_uniform_buffer_set_data(&gfx->camera_ubo, 0, sizeof(mat4),
+                                &op->view_projection[0][0]);
+    gfx->stats.bytes_uploaded += sizeof(mat4);
+    glm_mat4_copy(op->view_projection, gfx->cull_view_projection);
+    gfx->cull_camera_set = TRUE;
+    break;
+  case GGF_GFX_FRAME_OP_VIEWPORT:
+    ggf_internal_gfx_set_viewport(op->width, op->height);
+    break;
+  case GGF_GFX_FRAME_OP_RENDER_TARGET:
+    glBindFramebuffer(GL_FRAMEBUFFER, op->target ? op->target->framebuffer : 0);
+    ggf_internal_gfx_set_viewport(op->width, op->height);
+    if (op->clear) {
+      glClearColor(op->clear_color[0], op->clear_color[1], op->clear_color[2],
+                   0.0f);
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+    break;
+  case GGF_GFX_FRAME_OP_GPU_TIMER_BEGIN:
+    GGF_ASSERT(timers->depth < GGF_GFX_GPU_TIMER_MAX_DEPTH);
+    timers->scope_passes[timers->depth] = op->pass;
+    timers->scope_starts[timers->depth] = ggf_internal_gfx_gpu_timestamp();
+    timers->depth++;
+    break;
+  case GGF_GFX_FRAME_OP_GPU_TIMER_END:
+    GGF_ASSERT(timers->depth > 0);
+    timers->depth--;
+    ggf_internal_gfx_gpu_interval(timers->scope_passes[timers->depth],
+                                  timers->scope_starts[timers->depth],
+                                  ggf_internal_gfx_gpu_timestamp());
+    break;
+  case GGF_GFX_FRAME_OP_STATIC_UPLOAD:
+    ggf_internal_gfx_static_upload(op);
+    break;
+  case GGF_GFX_FRAME_OP_STATIC_DESTROY:
+    // the batch's CPU side is gone already, the rest goes with its GL objects
+    if (op->static_batch->vao) {
+      glDeleteVertexArrays(1, &op->static_batch->vao);
+      ggf_internal_gfx_forget_vertex_array(op->static_batch->vao);
+      glDeleteBuffers(1, &op->static_batch->buffer);
+      ggf_internal_gfx_forget_buffer(op->static_batch->buffer);
+    }
+    ggf_memory_free(op->static_batch);
+    break;
+  default:
+    GGF_ASSERT(FALSE);
+  }
+}
+
+// executes op now, or records it into the current frame when a render thread
+// owns the context
+internal_func void ggf_internal_gfx_run_op(ggf_gfx_frame_op_t *op) {
+  ggf_gfx_render_thread_t *render_thread =
+      ((ggf_gfx_t *)ggf_data->gfx)->render_thread;
+  if (!render_thread) {
+    ggf_internal_gfx_execute_op(op);
+    return;
+  }
+  ggf_gfx_frame_t *frame = &render_thread->frames[render_thread->current];
+  if (op->data_size) {
+    op->data_offset = ggf_darray_get_length(frame->op_data);
+    frame->op_data = ggf_darray_push_many(frame->op_data, (void *)op->data,
+                                          op->data_size);
+  }
+  frame->ops = ggf_darray_push(frame->ops, op);
+}
+
+void ggf_gfx_begin_frame() {
+  ggf_gfx_t *gfx = ggf_data->gfx;
+  // with a render thread, stats come back with the frames
+  if (!gfx->render_thread) {
+    gfx->last_stats = gfx->stats;
+    ggf_memory_zero(&gfx->stats, sizeof(gfx->stats));
+  }
+  ggf_gfx_frame_op_t op = {0};
+  op.type = GGF_GFX_FRAME_OP_CLEAR;
+  glm_vec3_copy(gfx->clear_color, op.clear_color);
+  ggf_internal_gfx_run_op(&op);
+}
+
+void ggf_gfx_resize(u32 width, u32 height) {
+  ggf_gfx_t *gfx = ggf_data->gfx;
+  gfx->width = width;
+  gfx->height = height;
+  // a bound render target keeps its own viewport until it ends
+  if (!gfx->render_target) {
+    ggf_gfx_frame_op_t op = {0};
+    op.type = GGF_GFX_FRAME_OP_VIEWPORT;
+    op.width = width;
+    op.height = height;
+    ggf_internal_gfx_run_op(&op);
+  }
+}
+
+internal_func ggf_gfx_recorder_ends_t
+ggf_internal_gfx_recorder_get_ends(ggf_gfx_recorder_t *recorder) {
+  ggf_gfx_recorder_ends_t ends;
+  ends.commands = ggf_darray_get_length(recorder->commands);
+  ends.basic_vertices = ggf_darray_get_length(recorder->basic_vertices);
+  ends.sprite_instances = ggf_darray_get_length(recorder->sprite_instances);
+  ends.shape_instances = ggf_darray_get_length(recorder->shape_instances);
+  return ends;
+}
+
+/*
+    view culling. every command gets a bounding box around its primitive in
+   world space, then the boxes are tested four at a time against the sides of
+   the camera's view: a box is outside when its four corners, transformed to
+   clip space, all lie beyond the same side. depth is not tested, and boxes
+   may be larger than their primitive, so nothing visible is ever dropped.
+*/
+typedef struct {
+  f32 *min_x, *min_y, *max_x, *max_y;
+  f32 *z; // depth, the same for every corner
+} ggf_gfx_cull_boxes_t;
+
+// returns FALSE for primitives that are never culled
+// world units covered by a pixel of a width x height viewport seen through
+// view_projection, along the world axis where they are largest
+internal_func f32 ggf_internal_gfx_pixel_size(mat4 view_projection, u32 width,
+                                              u32 height) {
+  f32 x = glm_vec2_norm((vec2){view_projection[0][0] * width,
+                               view_projection[0][1] * height});
+  f32 y = glm_vec2_norm((vec2){view_projection[1][0] * width,
+                               view_projection[1][1] * height});
+  return 2.0f / GGF_MAX(GGF_MIN(x, y), 0.0001f);
+}
+
+// pixel_size in world units, see ggf_internal_gfx_pixel_size
+internal_func b32 ggf_internal_gfx_command_bounds(ggf_gfx_recorder_t *recorder,
+                                                  ggf_gfx_pipeline_t pipeline,
+                                                  ggf_gfx_command_t *command,
+                                                  f32 pixel_size,
+                                                  vec4 out_box, f32 *out_z) {
+  switch (pipeline) {
+  case GGF_GFX_PIPELINE_BASIC:
+  case GGF_GFX_PIPELINE_TEXT: {
+    ggf_basic_vertex_t *vertices =
+        &recorder->basic_vertices[command->primitive * 4];
+    out_box[0] = out_box[2] = vertices[0].position[0];
+    out_box[1] = out_box[3] = vertices[0].position[1];
+    for (u32 v = 1; v < 4; v++) {
+      out_box[0] = GGF_MIN(out_box[0], vertices[v].position[0]);
+      out_box[1] = GGF_MIN(out_box[1], vertices[v].position[1]);
+      out_box[2] = GGF_MAX(out_box[2], vertices[v].position[0]);
+      out_box[3] = GGF_MAX(out_box[3], vertices[v].position[1]);
+    }
+    *out_z = vertices[0].position[2];
+    return TRUE;
+  }
+  case GGF_GFX_PIPELINE_SPRITE:
+  case GGF_GFX_PIPELINE_SPRITE_ARRAY: {
+    ggf_sprite_instance_t *sprite =
+        &recorder->sprite_instances[command->primitive];
+    *out_z = sprite->depth;
+    if (sprite->rotation == 0.0f) {
+      out_box[0] = sprite->position[0];
+      out_box[1] = sprite->position[1];
+      out_box[2] = sprite->position[0] + sprite->size[0];
+      out_box[3] = sprite->position[1] + sprite->size[1];
+      return TRUE;
+    }
+    // rotated around the center, so within half the diagonal of it
+    f32 radius = glm_vec2_norm(sprite->size) * 0.5f;
+    vec2 center = {sprite->position[0] + sprite->size[0] * 0.5f,
+                   sprite->position[1] + sprite->size[1] * 0.5f};
+    glm_vec4_copy((vec4){center[0] - radius, center[1] - radius,
+                         center[0] + radius, center[1] + radius},
+                  out_box);
+    return TRUE;
+  }
+  case GGF_GFX_PIPELINE_SHAPE: {
+    ggf_shape_instance_t *shape =
+        &recorder->shape_instances[command->primitive];
+    *out_z = shape->depth;
+    // the shape shader's quad reaches a pixel past the shape
+    vec2 extent = {shape->radius + pixel_size, shape->radius + pixel_size};
+    vec2 min, max;
+    glm_vec2_copy(shape->a, min);
+    glm_vec2_copy(shape->a, max);
+    if (shape->type == GGF_GFX_SHAPE_ROUNDED_RECT) {
+      vec2 half_size = {shape->b[0] + pixel_size, shape->b[1] + pixel_size};
+      if (shape->rotation == 0.0f)
+        glm_vec2_copy(half_size, extent);
+      else
+        extent[0] = extent[1] = glm_vec2_norm(half_size);
+    } else if (shape->type == GGF_GFX_SHAPE_CAPSULE) {
+      glm_vec2_minv(shape->a, shape->b, min);
+      glm_vec2_maxv(shape->a, shape->b, max);
+    }
+    glm_vec4_copy((vec4){min[0] - extent[0], min[1] - extent[1],
+                         max[0] + extent[0], max[1] + extent[1]},
+                  out_box);
+    return TRUE;
+  }
+  default:
+    return FALSE;
+  }
+}
+
+// tests the box at index against the sides of the view of view_projection
+internal_func b32 ggf_internal_gfx_box_outside(mat4 m,
+                                               ggf_gfx_cull_boxes_t *boxes,
+                                               u32 index) {
+  b32 left = TRUE, right = TRUE, bottom = TRUE, top = TRUE;
+  f32 z = boxes->z[index];
+  for (u32 corner = 0; corner < 4; corner++) {
+    f32 x = corner & 1 ? boxes->max_x[index] : boxes->min_x[index];
+    f32 y = corner & 2 ? boxes->max_y[index] : boxes->min_y[index];
+    f32 clip_x = m[0][0] * x + m[1][0] * y + m[2][0] * z + m[3][0];
+    f32 clip_y = m[0][1] * x + m[1][1] * y + m[2][1] * z + m[3][1];
+    f32 clip_w = m[0][3] * x + m[1][3] * y + m[2][3] * z + m[3][3];
+    left = left && clip_x < -clip_w;
+    right = right && clip_x > clip_w;
+    bottom = bottom && clip_y < -clip_w;
+    top = top && clip_y > clip_w;
+  }
+  return left || right || bottom || top;
+}
+
+// sets out_visible[i] to 0 for the boxes outside the view, 1 otherwise
+internal_func void ggf_internal_gfx_cull_boxes(mat4 m,
+                                               ggf_gfx_cull_boxes_t *boxes,
+                                               u32 count, u8 *out_visible) {
+  u32 i = 0;
+#if defined(__SSE2__)
+  __m128 row_x[4], row_y[4], row_w[4];
+  for (u32 c = 0; c < 4; c++) {
+    row_x[c] = _mm_set1_ps(m[c][0]);
+    row_y[c] = _mm_set1_ps(m[c][1]);
+    row_w[c] = _mm_set1_ps(m[c][3]);
+  }
+  for (; i + 4 <= count; i += 4) {
+    __m128 xs[2] = {_mm_loadu_ps(boxes->min_x + i),
+                    _mm_loadu_ps(boxes->max_x + i)};
+    __m128 ys[2] = {_mm_loadu_ps(boxes->min_y + i),
+                    _mm_loadu_ps(boxes->max_y + i)};
+    __m128 z = _mm_loadu_ps(boxes->z + i);
+    // depth and translation are the same for the four corners
+    __m128 base_x = _mm_add_ps(_mm_mul_ps(row_x[2], z), row_x[3]);
+    __m128 base_y = _mm_add_ps(_mm_mul_ps(row_y[2], z), row_y[3]);
+    __m128 base_w = _mm_add_ps(_mm_mul_ps(row_w[2], z), row_w[3]);
+
+    __m128 all = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    __m128 left = all, right = all, bottom = all, top = all;
+    for (u32 corner = 0; corner < 4; corner++) {
+      __m128 x = xs[corner & 1], y = ys[corner >> 1];
+      __m128 clip_x = _mm_add_ps(
+          base_x, _mm_add_ps(_mm_mul_ps(row_x[0], x), _mm_mul_ps(row_x[1], y)));
+      __m128 clip_y = _mm_add_ps(
+          base_y, _mm_add_ps(_mm_mul_ps(row_y[0], x), _mm_mul_ps(row_y[1], y)));
+      __m128 clip_w = _mm_add_ps(
+          base_w, _mm_add_ps(_mm_mul_ps(row_w[0], x), _mm_mul_ps(row_w[1], y)));
+      __m128 neg_w = _mm_sub_ps(_mm_setzero_ps(), clip_w);
+      left = _mm_and_ps(left, _mm_cmplt_ps(clip_x, neg_w));
+      right = _mm_and_ps(right, _mm_cmpgt_ps(clip_x, clip_w));
+      bottom = _mm_and_ps(bottom, _mm_cmplt_ps(clip_y, neg_w));
+      top = _mm_and_ps(top, _mm_cmpgt_ps(clip_y, clip_w));
+    }
+    i32 outside = _mm_movemask_ps(
+        _mm_or_ps(_mm_or_ps(left, right), _mm_or_ps(bottom, top)));
+    for (u32 lane = 0; lane < 4; lane++) {
+      out_visible[i + lane] = !((outside >> lane) & 1);
+    }
+  }
+#elif defined(__ARM_NEON)
+  float32x4_t row_x[4], row_y[4], row_w[4];
+  for (u32 c = 0; c < 4; c++) {
+    row_x[c] = vdupq_n_f32(m[c][0]);
+    row_y[c] = vdupq_n_f32(m[c][1]);
+    row_w[c] = vdupq_n_f32(m[c][3]);
+  }
+  for (; i + 4 <= count; i += 4) {
+    float32x4_t xs[2] = {vld1q_f32(boxes->min_x + i),
+                         vld1q_f32(boxes->max_x + i)};
+    float32x4_t ys[2] = {vld1q_f32(boxes->min_y + i),
+                         vld1q_f32(boxes->max_y + i)};
+    float32x4_t z = vld1q_f32(boxes->z + i);
+    // depth and translation are the same for the four corners
+    float32x4_t base_x = vmlaq_f32(row_x[3], row_x[2], z);
+    float32x4_t base_y = vmlaq_f32(row_y[3], row_y[2], z);
+    float32x4_t base_w = vmlaq_f32(row_w[3], row_w[2], z);
+
+    uint32x4_t left = vdupq_n_u32(~0u), right = left, bottom = left,
+               top = left;
+    for (u32 corner = 0; corner < 4; corner++) {
+      float32x4_t x = xs[corner & 1], y = ys[corner >> 1];
+      float32x4_t clip_x =
+          vmlaq_f32(vmlaq_f32(base_x, row_x[0], x), row_x[1], y);
+      float32x4_t clip_y =
+          vmlaq_f32(vmlaq_f32(base_y, row_y[0], x), row_y[1], y);
+      float32x4_t clip_w =
+          vmlaq_f32(vmlaq_f32(base_w, row_w[0], x), row_w[1], y);
+      float32x4_t neg_w = vnegq_f32(clip_w);
+      left = vandq_u32(left, vcltq_f32(clip_x, neg_w));
+      right = vandq_u32(right, vcgtq_f32(clip_x, clip_w));
+      bottom = vandq_u32(bottom, vcltq_f32(clip_y, neg_w));
+      top = vandq_u32(top, vcgtq_f32(clip_y, clip_w));
+    }
+    uint32x4_t outside =
+        vorrq_u32(vorrq_u32(left, right), vorrq_u32(bottom, top));
+    out_visible[i + 0] = vgetq_lane_u32(outside, 0) == 0;
+    out_visible[i + 1] = vgetq_lane_u32(outside, 1) == 0;
+    out_visible[i + 2] = vgetq_lane_u32(outside, 2) == 0;
+    out_visible[i + 3] = vgetq_lane_u32(outside, 3) == 0;
+  }
+#endif
+  for (; i < count; i++) {
+    out_visible[i] = !ggf_internal_gfx_box_outside(m, boxes, i);
+  }
+}
+
+// drops the commands outside the view of the cull camera: the keys of the
+// visible ones are moved to the front and out_order gets their indices.
+// returns how many are visible.
+internal_func u32 ggf_internal_gfx_cull_commands(
+    ggf_gfx_recorder_t *recorder, u64 *keys, ggf_gfx_command_t *commands,
+    u32 count, u32 *out_order, ggf_linear_allocator_t *scratch) {
+  GGF_PROFILE_SCOPE("ggf_gfx_cull");
+  ggf_gfx_t *gfx = ggf_data->gfx;
+
+  ggf_gfx_cull_boxes_t boxes;
+  f32 **arrays[] = {&boxes.min_x, &boxes.min_y, &boxes.max_x, &boxes.max_y,
+                    &boxes.z};
+  for (u32 a = 0; a < GGF_ARRAY_COUNT(arrays); a++) {
+    *arrays[a] = ggf_linear_allocator_alloc_aligned(scratch,
+                                                    sizeof(f32) * count, 16);
+  }
+  u8 *visible = ggf_linear_allocator_alloc_aligned(scratch, count, 1);
+  // 1 for the commands drawn whatever their box
+  u8 *always = ggf_linear_allocator_alloc_aligned(scratch, count, 1);
+  f32 pixel_size = ggf_internal_gfx_pixel_size(
+      gfx->cull_view_projection, gfx->viewport_width, gfx->viewport_height);
+
+  for (u32 i = 0; i < count; i++) {
+    ggf_gfx_pipeline_t pipeline =
+        (keys[i] >> GGF_GFX_SORT_KEY_PIPELINE_SHIFT) & 0xF;
+    vec4 box = {0};
+    f32 z = 0.0f;
+    always[i] = !ggf_internal_gfx_command_bounds(
+        recorder, pipeline, &commands[i], pixel_size, box, &z);
+    boxes.min_x[i] = box[0];
+    boxes.min_y[i] = box[1];
+    boxes.max_x[i] = box[2];
+    boxes.max_y[i] = box[3];
+    boxes.z[i] = z;
+  }
+  ggf_internal_gfx_cull_boxes(gfx->cull_view_projection, &boxes, count,
+                              visible);
+
+  u32 visible_count = 0;
+  for (u32 i = 0; i < count; i++) {
+    if (!visible[i] && !always[i])
+      continue;
+    keys[visible_count] = keys[i];
+    out_order[visible_count++] = i;
+  }
+  return visible_count;
+}
+
+// sorts and draws the draw calls of recorder between from and to, the ones
+// outside the camera's view are dropped if cull is TRUE. scratch holds the
+// temporary arrays and is back at its marker afterwards.
+internal_func void ggf_internal_gfx_draw_commands(
+    ggf_gfx_recorder_t *recorder, ggf_gfx_recorder_ends_t *from,
+    ggf_gfx_recorder_ends_t *to, ggf_gfx_flush_reason_t reason, b32 cull,
+    ggf_linear_allocator_t *scratch) {
+  GGF_PROFILE_SCOPE("ggf_gfx_flush");
+  ggf_gfx_t *gfx = ggf_data->gfx;
+  u32 command_count = to->commands - from->commands;
+  if (command_count == 0)
+    return;
+
+  ggf_gfx_stats_t *stats = &gfx->stats;
+  stats->flushes++;
+  stats->flush_reasons[reason]++;
+  stats->commands += command_count;
+
+  u64 marker = scratch->marker;
+
+  u64 *keys = recorder->command_keys + from->commands;
+  ggf_gfx_command_t *commands = recorder->commands + from->commands;
+  u32 *order = ggf_linear_allocator_alloc_aligned(
+      scratch, sizeof(u32) * command_count, 4);
+  if (cull && gfx->cull_camera_set) {
+    u32 visible_count = ggf_internal_gfx_cull_commands(
+        recorder, keys, commands, command_count, order, scratch);
+    stats->culled += command_count - visible_count;
+    command_count = visible_count;
+    if (command_count == 0) {
+      ggf_linear_allocator_free_to_marker(scratch, marker);
+      return;
+    }
+  } else {
+    for (u32 i = 0; i < command_count; i++) {
+      order[i] = i;
+    }
+  }
+  ggf_radix_sort_u64(command_count, keys, order, scratch);
+
+  // gather the vertices in sorted order straight into the vertex streams,
+  // starting a new batch whenever the layer, pipeline or blend mode changes
+  // or the texture units run out
+  u32 num_basic = to->basic_vertices - from->basic_vertices;
+  u32 num_sprites = to->sprite_instances - from->sprite_instances;
+  u32 num_shapes = to->shape_instances - from->shape_instances;
+  u64 basic_size = sizeof(ggf_basic_vertex_t) * 4 * num_basic;
+  u64 sprite_size = sizeof(ggf_sprite_instance_t) * num_sprites;
+  u64 shape_size = sizeof(ggf_shape_instance_t) * num_shapes;
+
+  if (ggf_internal_gfx_stream_buffer_reserve(&gfx->basic_stream, basic_size))
+    ggf_internal_gfx_set_stream_attributes();
+  ggf_internal_gfx_stream_buffer_reserve(&gfx->sprite_stream, sprite_size);
+  ggf_internal_gfx_stream_buffer_reserve(&gfx->shape_stream, shape_size);
+  ggf_internal_gfx_reserve_quad_indices(num_basic);
+
+  u64 basic_offset = 0, sprite_offset = 0, shape_offset = 0;
+  ggf_basic_vertex_t *basic_vertices = NULL;
+  ggf_sprite_instance_t *sprite_instances = NULL;
+  ggf_shape_instance_t *shape_instances = NULL;
+  if (num_basic > 0)
+    basic_vertices = ggf_internal_gfx_stream_buffer_map(
+        &gfx->basic_stream, basic_size, sizeof(ggf_basic_vertex_t),
+        &basic_offset);
+  if (num_sprites > 0)
+    sprite_instances = ggf_internal_gfx_stream_buffer_map(
+        &gfx->sprite_stream, sprite_size, sizeof(ggf_sprite_instance_t),
+        &sprite_offset);
+  if (num_shapes > 0)
+    shape_instances = ggf_internal_gfx_stream_buffer_map(
+        &gfx->shape_stream, shape_size, sizeof(ggf_shape_instance_t),
+        &shape_offset);
+  ggf_gfx_batch_t *batches = ggf_linear_allocator_alloc_aligned(
+      scratch, sizeof(ggf_gfx_batch_t) * command_count, 8);
+  u32 batch_count = 0, basic_count = 0, sprite_count = 0, shape_count = 0;
+  ggf_gfx_batch_t *batch = NULL;
+  // texture id -> unit in the batch being built. scratch is the frame
+  // allocator, or the render thread's own when flushing there.
+  ggf_transient_map_t texture_units;
+  ggf_transient_map_create(GGF_GFX_MAX_TEXTURE_UNITS, sizeof(u32), scratch,
+                           &texture_units);
+
+  for (u32 i = 0; i < command_count; i++) {
+    u64 key = keys[i];
+    ggf_gfx_command_t *command = &commands[order[i]];
+    u8 layer = (u8)(key >> GGF_GFX_SORT_KEY_LAYER_SHIFT);
+    ggf_gfx_pipeline_t pipeline =
+        (key >> GGF_GFX_SORT_KEY_PIPELINE_SHIFT) & 0xF;
+    ggf_gfx_blend_mode_t blend_mode =
+        (key >> GGF_GFX_SORT_KEY_BLEND_MODE_SHIFT) & 0x3;
+
+    // sprite array batches hold a single texture array and need no units,
+    // static batches come with theirs
+    b32 is_static = pipeline == GGF_GFX_PIPELINE_STATIC_SPRITE;
+    b32 uses_units = pipeline != GGF_GFX_PIPELINE_SPRITE_ARRAY && !is_static;
+    u32 *unit = NULL;
+    if (batch && command->texture && uses_units)
+      unit = ggf_transient_map_find(&texture_units, command->texture);
+
+    // checked in sort key order, so the first difference is the cause
+    u32 batch_break = GGF_INVALID_ID;
+    if (!batch)
+      batch_break = GGF_GFX_BATCH_BREAK_MAX;
+    else if (batch->layer != layer)
+      batch_break = GGF_GFX_BATCH_BREAK_LAYER;
+    else if (batch->blend_mode != blend_mode)
+      batch_break = GGF_GFX_BATCH_BREAK_BLEND_MODE;
+    else if (batch->pipeline != pipeline)
+      batch_break = GGF_GFX_BATCH_BREAK_PIPELINE;
+    else if (is_static)
+      batch_break = GGF_GFX_BATCH_BREAK_STATIC_BATCH;
+    else if (uses_units && command->texture && !unit &&
+             batch->texture_count == GGF_GFX_MAX_TEXTURE_UNITS)
+      batch_break = GGF_GFX_BATCH_BREAK_TEXTURE_UNITS;
+    else if (!uses_units && batch->textures[0] != command->texture)
+      batch_break = GGF_GFX_BATCH_BREAK_TEXTURE_ARRAY;
+
+    if (batch_break != GGF_INVALID_ID) {
+      if (batch_break != GGF_GFX_BATCH_BREAK_MAX)
+        stats->batch_breaks[batch_break]++;
+      batch = &batches[batch_count++];
+      batch->layer = layer;
+      batch->pipeline = pipeline;
+      batch->blend_mode = blend_mode;
+      switch (pipeline) {
+      case GGF_GFX_PIPELINE_SPRITE:
+      case GGF_GFX_PIPELINE_SPRITE_ARRAY:
+        batch->first = sprite_count;
+        break;
+      case GGF_GFX_PIPELINE_SHAPE:
+        batch->first = shape_count;
+        break;
+      default:
+        batch->first = basic_count;
+      }
+      batch->count = 0;
+      batch->texture_count = 1;
+      batch->textures[0] = uses_units ? gfx->white_texture.id : command->texture;
+      ggf_transient_map_clear(&texture_units);
+      unit = NULL;
+    }
+
+    if (is_static) {
+      ggf_gfx_static_draw_t *draw =
+          &recorder->static_draws[command->primitive];
+      batch->first = command->primitive;
+      batch->count = draw->count;
+      batch->texture_count = draw->texture_count;
+      ggf_memory_copy(batch->textures, draw->textures,
+                      sizeof(u32) * draw->texture_count);
+      continue;
+    }
+
+    if (!uses_units) {
+      // the layer was stored at record time
+      ggf_memory_copy(&sprite_instances[sprite_count],
+                      &recorder->sprite_instances[command->primitive],
+                      sizeof(ggf_sprite_instance_t));
+      sprite_count++;
+      batch->count++;
+      continue;
+    }
+
+    // unit 0 is always the white texture
+    f32 texture_index = 0.0f;
+    if (command->texture) {
+      if (!unit) {
+        unit = ggf_transient_map_insert(&texture_units, command->texture, NULL);
+        *unit = batch->texture_count;
+        batch->textures[batch->texture_count++] = command->texture;
+      }
+      texture_index = (f32)*unit;
+    }
+
+    // patched on the stack so that mapped memory is only written once
+    if (pipeline == GGF_GFX_PIPELINE_SPRITE) {
+      ggf_sprite_instance_t instance =
+          recorder->sprite_instances[command->primitive];
+      instance.texture_index = texture_index;
+      ggf_memory_copy(&sprite_instances[sprite_count], &instance,
+                      sizeof(instance));
+      sprite_count++;
+    } else if (pipeline == GGF_GFX_PIPELINE_SHAPE) {
+      ggf_shape_instance_t instance =
+          recorder->shape_instances[command->primitive];
+      instance.texture_index = texture_index;
+      ggf_memory_copy(&shape_instances[shape_count], &instance,
+                      sizeof(instance));
+      shape_count++;
+    } else {
+      ggf_basic_vertex_t vertices[4];
+      ggf_memory_copy(vertices,
+                      &recorder->basic_vertices[command->primitive * 4],
+                      sizeof(vertices));
+      for (u32 v = 0; v < 4; v++) {
+        vertices[v].uv[2] = texture_index;
+      }
+      ggf_memory_copy(&basic_vertices[basic_count * 4], vertices,
+                      sizeof(vertices));
+      basic_count++;
+    }
+    batch->count++;
+  }
+
+  if (basic_vertices)
+    ggf_internal_gfx_stream_buffer_unmap(&gfx->basic_stream);
+  if (sprite_instances)
+    ggf_internal_gfx_stream_buffer_unmap(&gfx->sprite_stream);
+  if (shape_instances)
+    ggf_internal_gfx_stream_buffer_unmap(&gfx->shape_stream);
+
+  // culled primitives were never written
+  stats->bytes_uploaded += sizeof(ggf_basic_vertex_t) * 4 * basic_count +
+                           sizeof(ggf_sprite_instance_t) * sprite_count +
+                           sizeof(ggf_shape_instance_t) * shape_count;
+
+  u32 batch_start = ggf_internal_gfx_gpu_timestamp();
+  for (u32 i = 0; i < batch_count; i++) {
+    batch = &batches[i];
+
+    // layers are stacked regardless of depth
+    if (i > 0 && batch->layer != batches[i - 1].layer)
+      glClear(GL_DEPTH_BUFFER_BIT);
+
+    if (batch->pipeline == GGF_GFX_PIPELINE_SPRITE_ARRAY) {
+      ggf_internal_gfx_bind_texture(0, GL_TEXTURE_2D_ARRAY, batch->textures[0]);
+    } else {
+      for (u32 t = 0; t < batch->texture_count; t++) {
+        ggf_internal_gfx_bind_texture(t, GL_TEXTURE_2D, batch->textures[t]);
+      }
+    }
+    ggf_internal_gfx_apply_blend_mode(batch->blend_mode);
+
+    u64 base_vertex = basic_offset / sizeof(ggf_basic_vertex_t);
+    switch (batch->pipeline) {
+    case GGF_GFX_PIPELINE_BASIC:
+      ggf_internal_gfx_set_depth_test(TRUE);
+      ggf_internal_gfx_use_program(gfx->basic_shader.id);
+      ggf_internal_gfx_bind_vertex_array(gfx->basic_vao);
+      break;
+    case GGF_GFX_PIPELINE_SPRITE:
+    case GGF_GFX_PIPELINE_SPRITE_ARRAY:
+      ggf_internal_gfx_set_depth_test(TRUE);
+      ggf_internal_gfx_use_program(batch->pipeline == GGF_GFX_PIPELINE_SPRITE
+                                       ? gfx->sprite_shader.id
+                                       : gfx->sprite_array_shader.id);
+      ggf_internal_gfx_bind_vertex_array(gfx->sprite_vao);
+      ggf_internal_gfx_set_instance_attributes(
+          batch->pipeline, gfx->sprite_stream.id,
+          sprite_offset + sizeof(ggf_sprite_instance_t) * batch->first);
+      break;
+    case GGF_GFX_PIPELINE_SHAPE:
+      ggf_internal_gfx_set_depth_test(TRUE);
+      ggf_internal_gfx_use_program(gfx->shape_shader.id);
+      ggf_internal_gfx_bind_vertex_array(gfx->shape_vao);
+      ggf_internal_gfx_set_instance_attributes(
+          batch->pipeline, gfx->shape_stream.id,
+          shape_offset + sizeof(ggf_shape_instance_t) * batch->first);
+      break;
+    case GGF_GFX_PIPELINE_STATIC_SPRITE:
+      ggf_internal_gfx_set_depth_test(TRUE);
+      ggf_internal_gfx_use_program(gfx->sprite_shader.id);
+      ggf_internal_gfx_bind_vertex_array(
+          recorder->static_draws[batch->first].batch->vao);
+      break;
+    case GGF_GFX_PIPELINE_TEXT:
+      ggf_internal_gfx_set_depth_test(FALSE);
+      ggf_internal_gfx_use_program(gfx->text_shader.id);
+      ggf_internal_gfx_bind_vertex_array(gfx->basic_vao);
+      break;
+    default:
+      GGF_ASSERT(FALSE);
+    }
+
+    if (batch->pipeline == GGF_GFX_PIPELINE_BASIC ||
+        batch->pipeline == GGF_GFX_PIPELINE_TEXT) {
+      glDrawElementsBaseVertex(GL_TRIANGLES, batch->count * 6,
+                               GL_UNSIGNED_INT, 0,
+                               base_vertex + batch->first * 4);
+      stats->indices += batch->count * 6;
+    } else {
+      glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, batch->count);
+      stats->instances += batch->count;
+    }
+    stats->draw_calls++;
+    stats->vertices += batch->count * 4;
+
+    u32 batch_end = ggf_internal_gfx_gpu_timestamp();
+    ggf_internal_gfx_gpu_interval(batch->pipeline, batch_start, batch_end);
+    batch_start = batch_end;
+  }
+
+  ggf_internal_gfx_set_depth_test(TRUE);
+  ggf_internal_gfx_apply_blend_mode(GGF_GFX_BLEND_MODE_ALPHA);
+
+  ggf_linear_allocator_free_to_marker(scratch, marker);
+}
+
+internal_func void ggf_internal_gfx_flush(ggf_gfx_flush_reason_t reason) {
+  ggf_gfx_t *gfx = ggf_data->gfx;
+  ggf_gfx_recorder_t *recorder = &gfx->recorder;
+  ggf_gfx_render_thread_t *render_thread = gfx->render_thread;
+  if (render_thread) {
+    // the render thread draws them when it executes the frame
+    if (ggf_internal_gfx_unflushed_commands(gfx) == 0)
+      return;
+    ggf_gfx_frame_op_t op = {0};
+    op.type = GGF_GFX_FRAME_OP_FLUSH;
+    op.reason = reason;
+    op.cull = gfx->culling_enabled;
+    op.ends = ggf_internal_gfx_recorder_get_ends(recorder);
+    ggf_internal_gfx_run_op(&op);
+    render_thread->flushed_commands = op.ends.commands;
+    return;
+  }
+
+  ggf_gfx_recorder_ends_t from = {0};
+  ggf_gfx_recorder_ends_t to = ggf_internal_gfx_recorder_get_ends(recorder);
+  ggf_internal_gfx_draw_commands(recorder, &from, &to, reason,
+                                 gfx->culling_enabled,
+                                 ggf_get_frame_allocator());
+  ggf_internal_gfx_recorder_clear(recorder);
+}
+
+void ggf_gfx_flush() { ggf_internal_gfx_flush(GGF_GFX_FLUSH_REASON_EXPLICIT); }
+
+void ggf_gfx_get_stats(ggf_gfx_stats_t *out_stats) {
+  ggf_gfx_t *gfx = ggf_data->gfx;
+  *out_stats = gfx->last_stats;
+}
+
+void ggf_gfx_set_layer(u8 layer) {
+  ggf_internal_gfx_get_recorder()->layer = layer;
+}
+
+void ggf_gfx_set_blend_mode(ggf_gfx_blend_mode_t mode) {
+  GGF_ASSERT(mode < GGF_GFX_BLEND_MODE_MAX);
+  ggf_internal_gfx_get_recorder()->blend_mode = mode;
+}
+
+void ggf_gfx_set_culling_enabled(b32 enabled) {
+  ((ggf_gfx_t *)ggf_data->gfx)->culling_enabled = enabled;
+}
+
+void ggf_gfx_set_max_commands(u32 max_commands) {
+  ggf_gfx_t *gfx = ggf_data->gfx;
+  GGF_ASSERT(max_commands > 0);
+  gfx->max_commands = max_commands;
+  if (ggf_internal_gfx_unflushed_commands(gfx) >= max_commands)
+    ggf_internal_gfx_flush(GGF_GFX_FLUSH_REASON_COMMAND_CAPACITY);
+}
+
+ggf_gfx_recorder_t *ggf_gfx_recorder_create() {
+  ggf_gfx_recorder_t *recorder =
+      ggf_memory_alloc(sizeof(ggf_gfx_recorder_t), GGF_MEMORY_TAG_GRAPHICS);
+  ggf_internal_gfx_recorder_init(recorder);
+  return recorder;
+}
+
+void ggf_gfx_recorder_destroy(ggf_gfx_recorder_t *recorder) {
+  GGF_ASSERT(ggf_gfx_thread_recorder != recorder);
+  ggf_internal_gfx_recorder_free(recorder);
+  ggf_memory_free(recorder);
+}
+
+void ggf_gfx_recorder_begin(ggf_gfx_recorder_t *recorder) {
+  GGF_ASSERT(recorder && !ggf_gfx_thread_recorder);
+  ggf_gfx_thread_recorder = recorder;
+}
+
+void ggf_gfx_recorder_end() {
+  GGF_ASSERT(ggf_gfx_thread_recorder);
+  ggf_gfx_thread_recorder = NULL;
+}
+
+void ggf_gfx_submit_recorder(ggf_gfx_recorder_t *recorder) {
+  ggf_gfx_t *gfx = ggf_data->gfx;
+  GGF_ASSERT(!ggf_gfx_thread_recorder);
+  u32 count = ggf_darray_get_length(recorder->commands);
+  ggf_gfx_recorder_t *target = &gfx->recorder;
+
+  // pipelines sharing a storage collect their primitive ranges on the first
+  u32 owners[GGF_GFX_PIPELINE_MAX];
+  for (u32 i = 0; i < GGF_GFX_PIPELINE_MAX; i++) {
+    void **storage =
+        ggf_internal_gfx_recorder_storage(recorder, (ggf_gfx_pipeline_t)i);
+    owners[i] = i;
+    for (u32 j = 0; j < i; j++) {
+      if (ggf_internal_gfx_recorder_storage(recorder, (ggf_gfx_pipeline_t)j) ==
+          storage) {
+        owners[i] = j;
+        break;
+      }
+    }
+  }
+
+  // appended in chunks that fit under max_commands, like push_sprites
+  u32 done = 0;
+  while (done < count) {
+    if (ggf_internal_gfx_unflushed_commands(gfx) >= gfx->max_commands)
+      ggf_internal_gfx_flush(GGF_GFX_FLUSH_REASON_COMMAND_CAPACITY);
+    u32 chunk = GGF_MIN(count - done,
+                        gfx->max_commands -
+                            ggf_internal_gfx_unflushed_commands(gfx));
+
+    // every draw call appends one primitive, so the primitives of a run of
+    // commands are a contiguous range of each storage
+    u32 first[GGF_GFX_PIPELINE_MAX], end[GGF_GFX_PIPELINE_MAX];
+    for (u32 i = 0; i < GGF_GFX_PIPELINE_MAX; i++) {
+      first[i] = GGF_INVALID_ID;
+      end[i] = 0;
+    }
+    for (u32 i = done; i < done + chunk; i++) {
+      u32 owner = owners[(recorder->command_keys[i] >>
+                          GGF_GFX_SORT_KEY_PIPELINE_SHIFT) &
+                         0xF];
+      first[owner] = GGF_MIN(first[owner], recorder->commands[i].primitive);
+      end[owner] = GGF_MAX(end[owner], recorder->commands[i].primitive + 1);
+    }
+
+    // primitives are appended, so commands point past the ones already there
+    u32 bases[GGF_GFX_PIPELINE_MAX];
+    for (u32 i = 0; i < GGF_GFX_PIPELINE_MAX; i++) {
+      if (owners[i] != i || first[i] >= end[i])
+        continue;
+      ggf_gfx_pipeline_t pipeline = (ggf_gfx_pipeline_t)i;
+      void **source = ggf_internal_gfx_recorder_storage(recorder, pipeline);
+      void **destination = ggf_internal_gfx_recorder_storage(target, pipeline);
+      bases[i] = ggf_darray_get_length(*destination);
+      *destination = ggf_darray_push_many(
+          *destination,
+          (u8 *)*source + (u64)first[i] * ggf_darray_get_stride(*source),
+          end[i] - first[i]);
+    }
+
+    target->command_keys = ggf_darray_push_many(
+        target->command_keys, recorder->command_keys + done, chunk);
+    for (u32 i = done; i < done + chunk; i++) {
+      ggf_gfx_command_t command = recorder->commands[i];
+      u32 owner = owners[(recorder->command_keys[i] >>
+                          GGF_GFX_SORT_KEY_PIPELINE_SHIFT) &
+                         0xF];
+      command.primitive = command.primitive - first[owner] + bases[owner];
+      target->commands = ggf_darray_push(target->commands, &command);
+    }
+    done += chunk;
+  }
+  ggf_internal_gfx_recorder_clear(recorder);
+}
+
+internal_func void ggf_internal_gfx_recorder_swap(ggf_gfx_recorder_t *a,
+                                                   ggf_gfx_recorder_t *b) {
+  ggf_gfx_recorder_t t = *a;
+  a->command_keys = b->command_keys;
+  a->commands = b->commands;
+  a->basic_vertices = b->basic_vertices;
+  a->sprite_instances = b->sprite_instances;
+  a->shape_instances = b->shape_instances;
+  a->static_draws = b->static_draws;
+  b->command_keys = t.command_keys;
+  b->commands = t.commands;
+  b->basic_vertices = t.basic_vertices;
+  b->sprite_instances = t.sprite_instances;
+  b->shape_instances = t.shape_instances;
+  b->static_draws = t.static_draws;
+}
+
+// runs the ops of frame in order and empties it
+internal_func void ggf_internal_gfx_execute_frame(
+    ggf_gfx_frame_t *frame, ggf_linear_allocator_t *scratch) {
+  ggf_gfx_recorder_ends_t flushed = {0};
+  u32 op_count = ggf_darray_get_length(frame->ops);
+  for (u32 i = 0; i < op_count; i++) {
+    ggf_gfx_frame_op_t *op = &frame->ops[i];
+    if (op->type == GGF_GFX_FRAME_OP_FLUSH) {
+      ggf_internal_gfx_draw_commands(&frame->recorder, &flushed, &op->ends,
+                                     op->reason, op->cull, scratch);
+      flushed = op->ends;
+    } else {
+      if (op->data_size)
+        op->data = frame->op_data + op->data_offset;
+      ggf_internal_gfx_execute_op(op);
+    }
+  }
+  ggf_darray_clear(frame->ops);
+  ggf_darray_clear(frame->op_data);
+  ggf_internal_gfx_recorder_clear(&frame->recorder);
+}
+
+// set on the render thread while it holds the GL context
+global_variable __thread b32 ggf_gfx_on_render_thread = FALSE;
+
+// the GL context belongs to the main thread unless the render thread runs
+internal_func inline b32 ggf_internal_gfx_owns_context() {
+  ggf_gfx_t *gfx = ggf_data->gfx;
+  return !gfx || !gfx->render_thread || ggf_gfx_on_render_thread;
+}
+
+internal_func void *ggf_internal_gfx_render_thread(void *usr) {
+  ggf_gfx_render_thread_t *render_thread = usr;
+  ggf_gfx_t *gfx = ggf_data->gfx;
+  GGF_PROFILE_THREAD_NAME("render");
+  ggf_window_switch_context(render_thread->window);
+  ggf_gfx_on_render_thread = TRUE;
+
+  for (;;) {
+    u32 index;
+    while (!ggf_spsc_queue_pop(&render_thread->to_render, 1, &index))
+      ggf_spsc_queue_wait(&render_thread->to_render);
+    if (index == GGF_INVALID_ID)
+      break;
+    GGF_PROFILE_SCOPE("render frame");
+
+    ggf_gfx_frame_t *frame = &render_thread->frames[index];
+    frame->render_start = ggf_platform_get_time_ns();
+    ggf_internal_gfx_execute_frame(frame, &render_thread->scratch);
+    ggf_internal_window_present(render_thread->window);
+    frame->presented = ggf_platform_get_time_ns();
+
+    frame->stats = gfx->stats;
+    ggf_memory_zero(&gfx->stats, sizeof(gfx->stats));
+    ggf_memory_copy(frame->pass_ms, gfx->gpu_timers.pass_ms,
+                    sizeof(frame->pass_ms));
+    ggf_memory_copy(frame->pass_smoothed_ms, gfx->gpu_timers.pass_smoothed_ms,
+                    sizeof(frame->pass_smoothed_ms));
+    frame->presented_once = TRUE;
+    ggf_spsc_queue_push(&render_thread->free, 1, &index);
+  }
+
+  ggf_gfx_on_render_thread = FALSE;
+  ggf_internal_window_release_context();
+  return NULL;
+}
+
+// makes the next free frame current, waiting for the render thread if all of
+// them are in flight, and takes in the results it came back with
+internal_func void
+ggf_internal_gfx_acquire_frame(ggf_gfx_render_thread_t *render_thread) {
+  ggf_gfx_t *gfx = ggf_data->gfx;
+  u64 wait_start = ggf_platform_get_time_ns();
+  u32 index;
+  while (!ggf_spsc_queue_pop(&render_thread->free, 1, &index))
+    ggf_spsc_queue_wait(&render_thread->free);
+  u64 now = ggf_platform_get_time_ns();
+
+  ggf_gfx_frame_t *frame = &render_thread->frames[index];
+  render_thread->current = index;
+  render_thread->flushed_commands = 0;
+
+  if (frame->presented_once) {
+    gfx->last_stats = frame->stats;
+    ggf_memory_copy(render_thread->pass_ms, frame->pass_ms,
+                    sizeof(frame->pass_ms));
+    ggf_memory_copy(render_thread->pass_smoothed_ms, frame->pass_smoothed_ms,
+                    sizeof(frame->pass_smoothed_ms));
+
+    ggf_gfx_render_thread_report_t *report = &render_thread->report;
+    f32 samples[] = {
+        (frame->presented - frame->record_start) / 1000000.0f,
+        render_thread->last_presented
+            ? (frame->presented - render_thread->last_presented) / 1000000.0f
+            : 0.0f,
+        (frame->submitted - frame->record_start) / 1000000.0f,
+        frame->wait_ms,
+        (frame->presented - frame->render_start) / 1000000.0f,
+    };
+    f32 *smoothed[] = {&report->latency_ms, &report->frame_ms,
+                       &report->record_ms, &report->wait_ms,
+                       &report->render_ms};
+    for (u32 i = 0; i < GGF_ARRAY_COUNT(samples); i++) {
+      *smoothed[i] = report->frames ? glm_lerp(*smoothed[i], samples[i],
+                                               GGF_GFX_RENDER_THREAD_SMOOTHING)
+                                    : samples[i];
+    }
+    report->frames++;
+    render_thread->last_presented = frame->presented;
+  }
+
+  frame->record_start = now;
+  frame->wait_ms = (now - wait_start) / 1000000.0f;
+}
+
+internal_func b32 ggf_internal_gfx_submit_frame(ggf_window_t *window) {
+  ggf_gfx_t *gfx = ggf_data->gfx;
+  if (!gfx || !gfx->render_thread)
+    return FALSE;
+  ggf_gfx_render_thread_t *render_thread = gfx->render_thread;
+  GGF_ASSERT(window == render_thread->window);
+
+  // draw calls that were never flushed go with the frame
+  ggf_internal_gfx_flush(GGF_GFX_FLUSH_REASON_END_OF_FRAME);
+  ggf_gfx_frame_t *frame = &render_thread->frames[render_thread->current];
+  ggf_internal_gfx_recorder_swap(&gfx->recorder, &frame->recorder);
+  frame->submitted = ggf_platform_get_time_ns();
+  ggf_spsc_queue_push(&render_thread->to_render, 1, &render_thread->current);
+
+  ggf_internal_gfx_acquire_frame(render_thread);
+  return TRUE;
+}
+
+b32 ggf_gfx_start_render_thread(ggf_window_t *window, u32 frame_count) {
+  ggf_gfx_t *gfx = ggf_data->gfx;
+  GGF_ASSERT(window);
+  if (gfx->render_thread) {
+    GGF_ERROR("ERROR - ggf_gfx_start_render_thread: already running");
+    return FALSE;
+  }
+  if (frame_count < 2 || frame_count > GGF_GFX_RENDER_THREAD_MAX_FRAMES) {
+    GGF_ERROR("ERROR - ggf_gfx_start_render_thread: frame_count must be 2 or "
+              "3, got %u",
+              frame_count);
+    return FALSE;
+  }
+  GGF_ASSERT(!gfx->render_target && gfx->gpu_timers.depth == 0);
+
+  ggf_gfx_render_thread_t *render_thread = ggf_memory_alloc(
+      sizeof(ggf_gfx_render_thread_t), GGF_MEMORY_TAG_GRAPHICS);
+  render_thread->window = window;
+  render_thread->frame_count = frame_count;
+  render_thread->report.frame_count = frame_count;
+  for (u32 i = 0; i < frame_count; i++) {
+    render_thread->frames[i].ops =
+        ggf_darray_create(64, sizeof(ggf_gfx_frame_op_t));
+    render_thread->frames[i].op_data = ggf_darray_create(1024, sizeof(u8));
+    ggf_internal_gfx_recorder_init(&render_thread->frames[i].recorder);
+  }
+
+  // one more entry for the stop
+  u64 queue_requirement = 0;
+  ggf_spsc_queue_create(GGF_GFX_RENDER_THREAD_MAX_FRAMES + 1, sizeof(u32),
+                        &queue_requirement, NULL, NULL);
+  render_thread->queue_memory =
+      ggf_memory_alloc(queue_requirement * 2, GGF_MEMORY_TAG_GRAPHICS);
+  ggf_spsc_queue_create(GGF_GFX_RENDER_THREAD_MAX_FRAMES + 1, sizeof(u32),
+                        &queue_requirement, render_thread->queue_memory,
+                        &render_thread->to_render);
+  ggf_spsc_queue_create(GGF_GFX_RENDER_THREAD_MAX_FRAMES + 1, sizeof(u32),
+                        &queue_requirement,
+                        (u8 *)render_thread->queue_memory + queue_requirement,
+                        &render_thread->free);
+  for (u32 i = 0; i < frame_count; i++) {
+    ggf_spsc_queue_push(&render_thread->free, 1, &i);
+  }
+  ggf_linear_allocator_create(GGF_FRAME_ALLOCATOR_SIZE, NULL,
+                              &render_thread->scratch);
+
+  gfx->render_thread = render_thread;
+  ggf_internal_gfx_acquire_frame(render_thread);
+
+  ggf_internal_window_release_context();
+  pthread_create(&render_thread->thread, NULL, ggf_internal_gfx_render_thread,
+                 render_thread);
+  return TRUE;
+}
+
+void ggf_gfx_stop_render_thread() {
+  ggf_gfx_t *gfx = ggf_data->gfx;
+  ggf_gfx_render_thread_t *render_thread = gfx->render_thread;
+  if (!render_thread)
+    return;
+
+  u32 stop = GGF_INVALID_ID;
+  ggf_spsc_queue_push(&render_thread->to_render, 1, &stop);
+  pthread_join(render_thread->thread, NULL);
+  ggf_window_switch_context(render_thread->window);
+
+  // the frame being recorded, drawn here without a present
+  ggf_internal_gfx_flush(GGF_GFX_FLUSH_REASON_END_OF_FRAME);
+  ggf_gfx_frame_t *frame = &render_thread->frames[render_thread->current];
+  ggf_internal_gfx_recorder_swap(&gfx->recorder, &frame->recorder);
+  gfx->render_thread = NULL;
+  ggf_internal_gfx_execute_frame(frame, ggf_get_frame_allocator());
+
+  ggf_gfx_render_thread_report_t *report = &render_thread->report;
+  GGF_DEBUG("ggf_gfx_stop_render_thread: %llu frames, %u in flight, latency "
+            "%.2f ms, %.2f ms per frame, record %.2f ms, wait %.2f ms, "
+            "render %.2f ms",
+            report->frames, report->frame_count, report->latency_ms,
+            report->frame_ms, report->record_ms, report->wait_ms,
+            report->render_ms);
+
+  for (u32 i = 0; i < render_thread->frame_count; i++) {
+    ggf_darray_destroy(render_thread->frames[i].ops);
+    ggf_darray_destroy(render_thread->frames[i].op_data);
+    ggf_internal_gfx_recorder_free(&render_thread->frames[i].recorder);
+  }
+  ggf_spsc_queue_destroy(&render_thread->to_render);
+  ggf_spsc_queue_destroy(&render_thread->free);
+  ggf_memory_free(render_thread->queue_memory);
+  ggf_linear_allocator_destroy(&render_thread->scratch);
+  ggf_memory_free(render_thread);
 }
 
-void ggf_gfx_resize(u32 width, u32 height) {
-  glViewport(0, 0, width, height);
+b32 ggf_gfx_is_render_thread_running() {
+  return ((ggf_gfx_t *)ggf_data->gfx)->render_thread != NULL;
 }
 
-void ggf_gfx_set_clear_color(vec3 color) {
-  ggf_gfx_t *gfx = ggf_data->gfx;
-  glm_vec3_copy(color, gfx->clear_color);
+void ggf_gfx_get_render_thread_report(ggf_gfx_render_thread_report_t *out) {
+  ggf_gfx_render_thread_t *render_thread =
+      ((ggf_gfx_t *)ggf_data->gfx)->render_thread;
+  if (render_thread)
+    *out = render_thread->report;
+  else
+    ggf_memory_zero(out, sizeof(*out));
 }
 
-void ggf_gfx_begin_frame() {
+void ggf_gfx_set_gpu_timers_enabled(b32 enabled) {
   ggf_gfx_t *gfx = ggf_data->gfx;
-  glClearColor(gfx->clear_color[0], gfx->clear_color[1], gfx->clear_color[2], 1.0f);
-  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  ggf_gfx_gpu_timers_t *timers = &gfx->gpu_timers;
+  GGF_ASSERT(ggf_internal_gfx_owns_context());
+  if (enabled && !timers->queries_created) {
+    for (u32 i = 0; i < GGF_GFX_GPU_TIMER_FRAMES; i++) {
+      glGenQueries(GGF_GFX_GPU_TIMER_MAX_QUERIES, timers->frames[i].queries);
+    }
+    timers->queries_created = TRUE;
+  }
+  timers->enabled = enabled;
 }
 
-void ggf_gfx_flush() {
-  ggf_gfx_t *gfx = ggf_data->gfx;
+void ggf_gfx_gpu_timer_begin(const char *name) {
+  ggf_gfx_gpu_timers_t *timers = &((ggf_gfx_t *)ggf_data->gfx)->gpu_timers;
+  ggf_internal_gfx_flush(GGF_GFX_FLUSH_REASON_GPU_TIMER);
 
-  for (u32 i = 0; i < gfx->bound_texture_count; i++) {
-    glActiveTexture(GL_TEXTURE0 + i);
-    glBindTexture(GL_TEXTURE_2D, gfx->bound_textures[i]);
-  }
-  gfx->bound_texture_count = 1;
-
-  // basic drawing - quads
-  glUseProgram(gfx->basic_shader.id);
-  glBindVertexArray(gfx->basic_vao);
-  glBindBuffer(GL_ARRAY_BUFFER, gfx->basic_vbo);
-  if (gfx->num_triangles > 0) {
-    glBufferSubData(GL_ARRAY_BUFFER, 0,
-                    sizeof(ggf_basic_vertex_t) * gfx->num_triangles * 3,
-                    (void *)gfx->triangle_vertices);
-    glDrawArrays(GL_TRIANGLES, 0, gfx->num_triangles * 3);
-    gfx->num_triangles = 0;
-  }
-  if (gfx->num_quads > 0) {
-    glBufferSubData(GL_ARRAY_BUFFER,
-                    sizeof(ggf_basic_vertex_t) * gfx->num_triangles * 3,
-                    sizeof(ggf_basic_vertex_t) * gfx->num_quads * 4,
-                    (void *)gfx->quad_vertices);
-    glDrawElementsBaseVertex(GL_TRIANGLES, gfx->num_quads * 6, GL_UNSIGNED_INT,
-                             0, gfx->num_triangles * 3);
-    gfx->num_quads = 0;
-  }
-  if (gfx->num_text_characters > 0) {
-    glDisable(GL_DEPTH_TEST);
-    glUseProgram(gfx->text_shader.id);
-    glBufferSubData(GL_ARRAY_BUFFER,
-                    sizeof(ggf_basic_vertex_t) *
-                        (gfx->num_triangles * 3 + gfx->num_quads * 4),
-                    sizeof(ggf_basic_vertex_t) * gfx->num_text_characters * 4,
-                    (void *)gfx->text_vertices);
-    glDrawElementsBaseVertex(GL_TRIANGLES, gfx->num_text_characters * 6,
-                             GL_UNSIGNED_INT, 0,
-                             gfx->num_triangles * 3 + gfx->num_quads * 4);
-    gfx->num_text_characters = 0;
-    glEnable(GL_DEPTH_TEST);
+  ggf_string_id_t name_id = ggf_string_intern(name);
+  u32 pass = 0;
+  while (pass < timers->pass_count && timers->pass_names[pass] != name_id)
+    pass++;
+  if (pass == timers->pass_count) {
+    GGF_ASSERT(pass < GGF_GFX_GPU_TIMER_MAX_PASSES);
+    timers->pass_names[timers->pass_count++] = name_id;
   }
 
-  // circle drawing
-  if (gfx->num_circles > 0) {
-    glUseProgram(gfx->circle_shader.id);
-    glBindVertexArray(gfx->circle_vao);
-    glBindBuffer(GL_ARRAY_BUFFER, gfx->circle_vbo);
-    glBufferSubData(GL_ARRAY_BUFFER, 0,
-                    sizeof(ggf_circle_vertex_t) * gfx->num_circles * 4,
-                    (void *)gfx->circle_vertices);
-    glDrawElements(GL_TRIANGLES, gfx->circle_vao * 6, GL_UNSIGNED_INT, NULL);
-    gfx->num_circles = 0;
-  }
+  ggf_gfx_frame_op_t op = {0};
+  op.type = GGF_GFX_FRAME_OP_GPU_TIMER_BEGIN;
+  op.pass = pass;
+  ggf_internal_gfx_run_op(&op);
 }
 
-void ggf_gfx_set_camera(ggf_camera_t *camera) {
-  ggf_gfx_t *gfx = ggf_data->gfx;
+void ggf_gfx_gpu_timer_end() {
+  ggf_internal_gfx_flush(GGF_GFX_FLUSH_REASON_GPU_TIMER);
 
-  ggf_uniform_buffer_set_data(&gfx->camera_ubo, 0, sizeof(mat4),
-                              &camera->view_projection[0][0]);
+  ggf_gfx_frame_op_t op = {0};
+  op.type = GGF_GFX_FRAME_OP_GPU_TIMER_END;
+  ggf_internal_gfx_run_op(&op);
 }
 
-internal_func inline f32
-ggf_internal_gfx_get_texture_index(ggf_texture_t *texture) {
+u32 ggf_gfx_get_gpu_passes(ggf_gfx_gpu_pass_t *out_passes, u32 max_count) {
   ggf_gfx_t *gfx = ggf_data->gfx;
+  ggf_gfx_gpu_timers_t *timers = &gfx->gpu_timers;
+  // the render thread's times, as they came back with the last frame
+  f32 *pass_ms = timers->pass_ms, *pass_smoothed_ms = timers->pass_smoothed_ms;
+  if (gfx->render_thread) {
+    pass_ms = gfx->render_thread->pass_ms;
+    pass_smoothed_ms = gfx->render_thread->pass_smoothed_ms;
+  }
 
-  u32 texture_index = 0;
-  if (texture != NULL && texture->id != 0) {
-    for (u32 i = 1; i < gfx->bound_texture_count; i++) {
-      if (gfx->bound_textures[i] == texture->id) {
-        texture_index = i;
-        break;
-      }
-    }
-    if (texture_index == 0) {
-      if (gfx->bound_texture_count + 1 >= GGF_GFX_MAX_TEXTURE_UNITS) {
-        ggf_gfx_flush();
-      }
-      gfx->bound_textures[gfx->bound_texture_count] = texture->id;
-      texture_index = gfx->bound_texture_count;
-      gfx->bound_texture_count++;
-    }
+  u32 count = GGF_MIN(timers->pass_count, max_count);
+  for (u32 i = 0; i < count; i++) {
+    out_passes[i].name = ggf_string_get(timers->pass_names[i]);
+    out_passes[i].ms = pass_ms[i];
+    out_passes[i].smoothed_ms = pass_smoothed_ms[i];
   }
+  return count;
+}
 
-  return (f32)texture_index;
+void ggf_gfx_set_camera(ggf_camera_t *camera) {
+  ggf_gfx_frame_op_t op = {0};
+  op.type = GGF_GFX_FRAME_OP_CAMERA;
+  glm_mat4_copy(camera->view_projection, op.view_projection);
+  ggf_internal_gfx_run_op(&op);
 }
 
-void ggf_gfx_draw_triangle(vec2 a, vec2 b, vec2 c, f32 depth, vec4 color,
-                           ggf_texture_t *texture) {
+void ggf_gfx_begin_render_target(ggf_render_target_t *target, b32 clear) {
   ggf_gfx_t *gfx = ggf_data->gfx;
-  if (gfx->num_triangles + 1 >= GGF_GFX_MAX_NUM_TRIANGLES) {
-    GGF_WARN("WARNING: ggf_gfx_draw_triangle - Max num triangles surpassed. "
-             "Flusing graphics buffers which may cause artifacts. IMPORTANT! - "
-             "INCREASE [GGF_GFX_MAX_NUM_TRIANGLES]");
-    ggf_gfx_flush();
-  }
+  GGF_ASSERT(target && !gfx->render_target);
+  ggf_internal_gfx_flush(GGF_GFX_FLUSH_REASON_RENDER_TARGET);
 
-  f32 texture_index = ggf_internal_gfx_get_texture_index(texture);
+  gfx->render_target = target;
+  ggf_gfx_frame_op_t op = {0};
+  op.type = GGF_GFX_FRAME_OP_RENDER_TARGET;
+  op.target = target;
+  op.clear = clear;
+  glm_vec3_copy(gfx->clear_color, op.clear_color);
+  op.width = target->width;
+  op.height = target->height;
+  ggf_internal_gfx_run_op(&op);
+}
+
+void ggf_gfx_end_render_target() {
+  ggf_gfx_t *gfx = ggf_data->gfx;
+  GGF_ASSERT(gfx->render_target);
+  ggf_internal_gfx_flush(GGF_GFX_FLUSH_REASON_RENDER_TARGET);
+
+  gfx->render_target = NULL;
+  ggf_gfx_frame_op_t op = {0};
+  op.type = GGF_GFX_FRAME_OP_RENDER_TARGET;
+  op.width = gfx->width;
+  op.height = gfx->height;
+  ggf_internal_gfx_run_op(&op);
+}
+
+// records a command and copies its primitive (4 vertices or one sprite
+// instance) into the pipeline's storage. texture is an OpenGL texture id, 0 for
+// none.
+internal_func void ggf_internal_gfx_push_command(ggf_gfx_pipeline_t pipeline,
+                                                 u32 texture, f32 depth,
+                                                 void *primitive) {
+  ggf_gfx_t *gfx = ggf_data->gfx;
+  ggf_gfx_recorder_t *recorder = ggf_internal_gfx_get_recorder();
+  // only the main thread's draw calls are flushed, recorders just grow
+  if (recorder == &gfx->recorder &&
+      ggf_internal_gfx_unflushed_commands(gfx) >= gfx->max_commands)
+    ggf_internal_gfx_flush(GGF_GFX_FLUSH_REASON_COMMAND_CAPACITY);
+
+  void **storage = ggf_internal_gfx_recorder_storage(recorder, pipeline);
+  ggf_gfx_command_t command;
+  command.texture = texture;
+  command.primitive = ggf_darray_get_length(*storage);
+  *storage = ggf_darray_push(*storage, primitive);
+
+  // flip the bits of the float so that it sorts as an unsigned integer
+  u32 depth_bits;
+  ggf_memory_copy(&depth_bits, &depth, sizeof(u32));
+  depth_bits = (depth_bits & 0x80000000u) ? ~depth_bits
+                                          : depth_bits | 0x80000000u;
+
+  u64 key = ((u64)recorder->layer << GGF_GFX_SORT_KEY_LAYER_SHIFT) |
+            ((u64)recorder->blend_mode << GGF_GFX_SORT_KEY_BLEND_MODE_SHIFT) |
+            ((u64)pipeline << GGF_GFX_SORT_KEY_PIPELINE_SHIFT) |
+            ((u64)(command.texture & 0xFFFF)
+             << GGF_GFX_SORT_KEY_TEXTURE_SHIFT) |
+            ((u64)(depth_bits >> 8) << GGF_GFX_SORT_KEY_DEPTH_SHIFT);
+  recorder->command_keys = ggf_darray_push(recorder->command_keys, &key);
+  recorder->commands = ggf_darray_push(recorder->commands, &command);
+}
 
-  ggf_basic_vertex_t vertices[3] = {
+void ggf_gfx_draw_triangle(vec2 a, vec2 b, vec2 c, f32 depth, vec4 color,
+                           ggf_texture_t *texture) {
+  // the texture unit in uv[2] is filled in at flush. the last vertex is
+  // repeated so that triangles can be drawn as quads.
+  ggf_basic_vertex_t vertices[4] = {
       {{a[0], a[1], depth},
        {color[0], color[1], color[2], color[3]},
-       {0.0f, 0.0f, texture_index}},
+       {0.0f, 0.0f, 0.0f}},
       {{b[0], b[1], depth},
        {color[0], color[1], color[2], color[3]},
-       {0.5f, 1.0f, texture_index}},
+       {0.5f, 1.0f, 0.0f}},
       {{c[0], c[1], depth},
        {color[0], color[1], color[2], color[3]},
-       {1.0f, 0.0f, texture_index}},
+       {1.0f, 0.0f, 0.0f}},
+      {{c[0], c[1], depth},
+       {color[0], color[1], color[2], color[3]},
+       {1.0f, 0.0f, 0.0f}},
   };
 
-  ggf_memory_copy(&gfx->triangle_vertices[gfx->num_triangles * 3], vertices,
-                  sizeof(ggf_basic_vertex_t) * 3);
-
-  gfx->num_triangles++;
+  ggf_internal_gfx_push_command(GGF_GFX_PIPELINE_BASIC,
+                                texture ? texture->id : 0, depth, vertices);
 }
 
 void ggf_gfx_draw_quad(vec2 tl, vec2 tr, vec2 br, vec2 bl, f32 depth,
                        vec4 color, ggf_texture_t *texture) {
-  ggf_gfx_t *gfx = ggf_data->gfx;
-  if (gfx->num_quads + 1 >= GGF_GFX_MAX_NUM_QUADS) {
-    /*GGF_WARN("WARNING: ggf_gfx_draw_quad - Max num quads surpassed. Flusing "
-             "graphics buffers which may cause artifacts. IMPORTANT! - "
-             "INCREASE [GGF_GFX_MAX_NUM_QUADS]");*/
-    ggf_gfx_flush();
-  }
-
-  f32 texture_index = ggf_internal_gfx_get_texture_index(texture);
-
   ggf_basic_vertex_t vertices[4] = {
       {{tl[0], tl[1], depth},
        {color[0], color[1], color[2], color[3]},
-       {0.0f, 1.0f, texture_index}},
+       {0.0f, 1.0f, 0.0f}},
       {{tr[0], tr[1], depth},
        {color[0], color[1], color[2], color[3]},
-       {1.0f, 1.0f, texture_index}},
+       {1.0f, 1.0f, 0.0f}},
       {{br[0], br[1], depth},
        {color[0], color[1], color[2], color[3]},
-       {1.0f, 0.0f, texture_index}},
+       {1.0f, 0.0f, 0.0f}},
       {{bl[0], bl[1], depth},
        {color[0], color[1], color[2], color[3]},
-       {0.0f, 0.0f, texture_index}},
+       {0.0f, 0.0f, 0.0f}},
   };
 
-  ggf_memory_copy(&gfx->quad_vertices[gfx->num_quads * 4], vertices,
-                  sizeof(vertices));
+  ggf_internal_gfx_push_command(GGF_GFX_PIPELINE_BASIC,
+                                texture ? texture->id : 0, depth, vertices);
+}
 
-  gfx->num_quads++;
+internal_func u32 ggf_internal_gfx_pack_color(vec4 color) {
+  u32 rgba = 0;
+  for (u32 i = 0; i < 4; i++) {
+    f32 channel = glm_clamp(color[i], 0.0f, 1.0f);
+    rgba |= (u32)(channel * 255.0f + 0.5f) << (i * 8);
+  }
+  return rgba;
+}
+
+internal_func void ggf_internal_gfx_sprite_instance(
+    vec2 pos, vec2 size, f32 rotation, f32 depth, vec4 color, vec4 uv_rect,
+    f32 texture_index, ggf_sprite_instance_t *out_instance) {
+  out_instance->position[0] = pos[0];
+  out_instance->position[1] = pos[1];
+  out_instance->size[0] = size[0];
+  out_instance->size[1] = size[1];
+  out_instance->rotation = rotation;
+  out_instance->depth = depth;
+  out_instance->color = ggf_internal_gfx_pack_color(color);
+  ggf_memory_copy(out_instance->uv_rect, uv_rect, sizeof(f32) * 4);
+  out_instance->texture_index = texture_index;
+}
+
+void ggf_gfx_draw_sprite(vec2 pos, vec2 size, f32 rotation, f32 depth,
+                         vec4 color, vec4 uv_rect, ggf_texture_t *texture) {
+  // the texture unit is filled in at flush
+  ggf_sprite_instance_t instance;
+  ggf_internal_gfx_sprite_instance(pos, size, rotation, depth, color, uv_rect,
+                                   0.0f, &instance);
+  ggf_internal_gfx_push_command(GGF_GFX_PIPELINE_SPRITE,
+                                texture ? texture->id : 0, depth, &instance);
+}
+
+void ggf_gfx_draw_sprite_layer(vec2 pos, vec2 size, f32 rotation, f32 depth,
+                               vec4 color, vec4 uv_rect,
+                               ggf_texture_array_t *array, u32 layer) {
+  GGF_ASSERT(array && layer < array->layer_count);
+  ggf_sprite_instance_t instance;
+  ggf_internal_gfx_sprite_instance(pos, size, rotation, depth, color, uv_rect,
+                                   (f32)layer, &instance);
+  ggf_internal_gfx_push_command(GGF_GFX_PIPELINE_SPRITE_ARRAY, array->id,
+                                depth, &instance);
 }
 
 void ggf_draw_quad_extent(vec2 pos, vec2 size, f32 depth, vec4 color,
                           ggf_texture_t *texture) {
-  ggf_gfx_draw_quad(pos, (vec2){pos[0] + size[0], pos[1]},
-                    (vec2){pos[0] + size[0], pos[1] + size[1]},
-                    (vec2){pos[0], pos[1] + size[1]}, depth, color, texture);
+  ggf_gfx_draw_sprite(pos, size, 0.0f, depth, color,
+                      (vec4){0.0f, 0.0f, 1.0f, 1.0f}, texture);
 }
 
-void ggf_gfx_draw_line(vec2 p1, vec2 p2, f32 depth, f32 width, vec4 color,
-                       ggf_texture_t *texture) {
+// ggf_internal_gfx_pack_color for count colors, four at a time
+internal_func void ggf_internal_gfx_pack_colors(vec4 *colors, u32 count,
+                                                u32 *out_rgba) {
+  u32 i = 0;
+#if defined(__SSE2__)
+  __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+  __m128 scale = _mm_set1_ps(255.0f), half = _mm_set1_ps(0.5f);
+  for (; i + 4 <= count; i += 4) {
+    __m128i channels[4];
+    for (u32 lane = 0; lane < 4; lane++) {
+      __m128 color = _mm_loadu_ps(colors[i + lane]);
+      color = _mm_min_ps(_mm_max_ps(color, zero), one);
+      channels[lane] =
+          _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(color, scale), half));
+    }
+    // channels are 0-255, the saturating packs only narrow them
+    __m128i low = _mm_packs_epi32(channels[0], channels[1]);
+    __m128i high = _mm_packs_epi32(channels[2], channels[3]);
+    __m128i packed = _mm_packus_epi16(low, high);
+    _mm_storeu_si128((__m128i *)(out_rgba + i), packed);
+  }
+#elif defined(__ARM_NEON)
+  float32x4_t zero = vdupq_n_f32(0.0f), one = vdupq_n_f32(1.0f);
+  float32x4_t scale = vdupq_n_f32(255.0f), half = vdupq_n_f32(0.5f);
+  for (; i + 4 <= count; i += 4) {
+    uint32x4_t channels[4];
+    for (u32 lane = 0; lane < 4; lane++) {
+      float32x4_t color = vld1q_f32(colors[i + lane]);
+      color = vminq_f32(vmaxq_f32(color, zero), one);
+      channels[lane] = vcvtq_u32_f32(vmlaq_f32(half, color, scale));
+    }
+    uint16x8_t low =
+        vcombine_u16(vmovn_u32(channels[0]), vmovn_u32(channels[1]));
+    uint16x8_t high =
+        vcombine_u16(vmovn_u32(channels[2]), vmovn_u32(channels[3]));
+    uint8x16_t packed = vcombine_u8(vmovn_u16(low), vmovn_u16(high));
+    vst1q_u8((u8 *)(out_rgba + i), packed);
+  }
+#endif
+  for (; i < count; i++) {
+    out_rgba[i] = ggf_internal_gfx_pack_color(colors[i]);
+  }
+}
+
+// sort keys of count commands that differ only in depth, see
+// ggf_internal_gfx_push_command. depths NULL is depth 0 for all of them.
+internal_func void ggf_internal_gfx_depth_keys(u64 base_key, f32 *depths,
+                                               u32 count, u64 *out_keys) {
+  u32 i = 0;
+  if (!depths) {
+    // 0.0f with the sign bit flipped
+    u64 key = base_key | ((u64)(0x80000000u >> 8)
+                          << GGF_GFX_SORT_KEY_DEPTH_SHIFT);
+    for (; i < count; i++) {
+      out_keys[i] = key;
+    }
+    return;
+  }
+#if defined(__SSE2__)
+  __m128i sign = _mm_set1_epi32((i32)0x80000000u);
+  __m128i base = _mm_set1_epi64x((i64)base_key);
+  for (; i + 4 <= count; i += 4) {
+    // negative depths get all bits flipped, positive ones only the sign
+    __m128i bits = _mm_castps_si128(_mm_loadu_ps(depths + i));
+    __m128i flip = _mm_or_si128(_mm_srai_epi32(bits, 31), sign);
+    bits = _mm_srli_epi32(_mm_xor_si128(bits, flip), 8);
+    __m128i low = _mm_unpacklo_epi32(bits, _mm_setzero_si128());
+    __m128i high = _mm_unpackhi_epi32(bits, _mm_setzero_si128());
+    low = _mm_or_si128(base, _mm_slli_epi64(low, GGF_GFX_SORT_KEY_DEPTH_SHIFT));
+    high =
+        _mm_or_si128(base, _mm_slli_epi64(high, GGF_GFX_SORT_KEY_DEPTH_SHIFT));
+    _mm_storeu_si128((__m128i *)(out_keys + i), low);
+    _mm_storeu_si128((__m128i *)(out_keys + i + 2), high);
+  }
+#elif defined(__ARM_NEON)
+  uint32x4_t sign = vdupq_n_u32(0x80000000u);
+  uint64x2_t base = vdupq_n_u64(base_key);
+  for (; i + 4 <= count; i += 4) {
+    // negative depths get all bits flipped, positive ones only the sign
+    uint32x4_t bits = vreinterpretq_u32_f32(vld1q_f32(depths + i));
+    uint32x4_t flip = vorrq_u32(
+        vreinterpretq_u32_s32(vshrq_n_s32(vreinterpretq_s32_u32(bits), 31)),
+        sign);
+    bits = vshrq_n_u32(veorq_u32(bits, flip), 8);
+    uint64x2_t low = vmovl_u32(vget_low_u32(bits));
+    uint64x2_t high = vmovl_u32(vget_high_u32(bits));
+    vst1q_u64(out_keys + i,
+              vorrq_u64(base, vshlq_n_u64(low, GGF_GFX_SORT_KEY_DEPTH_SHIFT)));
+    vst1q_u64(out_keys + i + 2,
+              vorrq_u64(base, vshlq_n_u64(high, GGF_GFX_SORT_KEY_DEPTH_SHIFT)));
+  }
+#endif
+  for (; i < count; i++) {
+    u32 depth_bits;
+    ggf_memory_copy(&depth_bits, depths + i, sizeof(u32));
+    depth_bits = (depth_bits & 0x80000000u) ? ~depth_bits
+                                            : depth_bits | 0x80000000u;
+    out_keys[i] =
+        base_key | ((u64)(depth_bits >> 8) << GGF_GFX_SORT_KEY_DEPTH_SHIFT);
+  }
+}
+
+/*
+    records count sprites from separate arrays, the same commands and
+   instances as count ggf_gfx_draw_sprite calls. keys, commands and instances
+   are written in place into the recorder's storage, and the main thread's
+   recorder is flushed at the same points as it would be call by call.
+   rotations and depths may be NULL for 0.
+*/
+internal_func void ggf_internal_gfx_push_sprites(u32 texture, u32 count,
+                                                 vec2 *positions, vec2 *sizes,
+                                                 f32 *rotations, f32 *depths,
+                                                 vec4 *colors, vec4 uv_rect) {
   ggf_gfx_t *gfx = ggf_data->gfx;
+  ggf_gfx_recorder_t *recorder = ggf_internal_gfx_get_recorder();
+  u64 base_key =
+      ((u64)recorder->layer << GGF_GFX_SORT_KEY_LAYER_SHIFT) |
+      ((u64)recorder->blend_mode << GGF_GFX_SORT_KEY_BLEND_MODE_SHIFT) |
+      ((u64)GGF_GFX_PIPELINE_SPRITE << GGF_GFX_SORT_KEY_PIPELINE_SHIFT) |
+      ((u64)(texture & 0xFFFF) << GGF_GFX_SORT_KEY_TEXTURE_SHIFT);
+
+  u32 done = 0;
+  while (done < count) {
+    u32 chunk = count - done;
+    if (recorder == &gfx->recorder) {
+      if (ggf_internal_gfx_unflushed_commands(gfx) >= gfx->max_commands)
+        ggf_internal_gfx_flush(GGF_GFX_FLUSH_REASON_COMMAND_CAPACITY);
+      chunk = GGF_MIN(chunk, gfx->max_commands -
+                                 ggf_internal_gfx_unflushed_commands(gfx));
+    }
+
+    u32 first_instance = ggf_darray_get_length(recorder->sprite_instances);
+    u32 first_command = ggf_darray_get_length(recorder->commands);
+    recorder->sprite_instances =
+        ggf_internal_darray_extend(recorder->sprite_instances, chunk);
+    recorder->commands = ggf_internal_darray_extend(recorder->commands, chunk);
+    recorder->command_keys =
+        ggf_internal_darray_extend(recorder->command_keys, chunk);
+
+    ggf_internal_gfx_depth_keys(base_key, depths ? depths + done : NULL, chunk,
+                                recorder->command_keys + first_command);
+    ggf_gfx_command_t *commands = recorder->commands + first_command;
+    for (u32 i = 0; i < chunk; i++) {
+      commands[i].texture = texture;
+      commands[i].primitive = first_instance + i;
+    }
+
+    ggf_sprite_instance_t *instances =
+        recorder->sprite_instances + first_instance;
+    u32 rgba[64];
+    for (u32 block = 0; block < chunk; block += GGF_ARRAY_COUNT(rgba)) {
+      u32 block_count = GGF_MIN(chunk - block, GGF_ARRAY_COUNT(rgba));
+      u32 source = done + block;
+      ggf_internal_gfx_pack_colors(colors + source, block_count, rgba);
+      for (u32 i = 0; i < block_count; i++, source++) {
+        // the texture unit is filled in at flush
+        // written field by field, glm copies may assume aligned storage
+        ggf_sprite_instance_t *instance = &instances[block + i];
+        instance->position[0] = positions[source][0];
+        instance->position[1] = positions[source][1];
+        instance->size[0] = sizes[source][0];
+        instance->size[1] = sizes[source][1];
+        instance->rotation = rotations ? rotations[source] : 0.0f;
+        instance->depth = depths ? depths[source] : 0.0f;
+        instance->color = rgba[i];
+        instance->uv_rect[0] = uv_rect[0];
+        instance->uv_rect[1] = uv_rect[1];
+        instance->uv_rect[2] = uv_rect[2];
+        instance->uv_rect[3] = uv_rect[3];
+        instance->texture_index = 0.0f;
+      }
+    }
+    done += chunk;
+  }
+}
 
-  vec3 along = {p2[0] - p1[0], p2[1] - p1[1], 0.0f};
-  glm_vec3_cross(along, (vec3){0.0f, 0.0f, 1.0f}, along);
-  glm_vec3_normalize(along);
-  ggf_gfx_draw_quad((vec2){p1[0] + along[0] * width, p1[1] + along[1] * width},
-                    (vec2){p1[0] - along[0] * width, p1[1] - along[1] * width},
-                    (vec2){p2[0] - along[0] * width, p2[1] - along[1] * width},
-                    (vec2){p2[0] + along[0] * width, p2[1] + along[1] * width},
-                    depth, color, texture);
+void ggf_gfx_draw_quads(u32 count, vec2 *positions, vec2 *sizes, f32 *depths,
+                        vec4 *colors, ggf_texture_t *texture) {
+  ggf_internal_gfx_push_sprites(texture ? texture->id : 0, count, positions,
+                                sizes, NULL, depths, colors,
+                                (vec4){0.0f, 0.0f, 1.0f, 1.0f});
 }
 
-void ggf_gfx_draw_point(vec2 point, f32 depth, f32 size, vec4 color,
-                        ggf_texture_t *texture) {
-  ggf_gfx_draw_quad((vec2){point[0] - size, point[1] - size},
-                    (vec2){point[0] + size, point[1] - size},
-                    (vec2){point[0] + size, point[1] + size},
-                    (vec2){point[0] - size, point[1] + size}, depth, color,
-                    texture);
+void ggf_gfx_draw_sprites(u32 count, vec2 *positions, vec2 *sizes,
+                          f32 *rotations, f32 *depths, vec4 *colors,
+                          vec4 uv_rect, ggf_texture_t *texture) {
+  ggf_internal_gfx_push_sprites(texture ? texture->id : 0, count, positions,
+                                sizes, rotations, depths, colors, uv_rect);
 }
 
-void ggf_gfx_draw_circle(vec2 center, f32 depth, f32 radius, vec4 color,
-                         ggf_texture_t *texture) {
+ggf_gfx_static_batch_t *ggf_gfx_static_batch_create() {
+  ggf_gfx_static_batch_t *batch =
+      ggf_memory_alloc(sizeof(ggf_gfx_static_batch_t), GGF_MEMORY_TAG_GRAPHICS);
+  ggf_internal_gfx_recorder_init(&batch->recorder);
+  batch->instances = ggf_darray_create(GGF_GFX_INITIAL_BATCH_CAPACITY,
+                                       sizeof(ggf_sprite_instance_t));
+  batch->sizes =
+      ggf_darray_create(GGF_GFX_INITIAL_BATCH_CAPACITY, sizeof(vec2));
+  return batch;
+}
+
+void ggf_gfx_static_batch_destroy(ggf_gfx_static_batch_t *batch) {
+  GGF_ASSERT(!ggf_gfx_thread_recorder);
+  ggf_internal_gfx_flush(GGF_GFX_FLUSH_REASON_STATIC_BATCH);
+
+  ggf_internal_gfx_recorder_free(&batch->recorder);
+  ggf_darray_destroy(batch->instances);
+  ggf_darray_destroy(batch->sizes);
+  ggf_memory_free(batch->visible.words);
+
+  // frees the batch once its GL objects are deleted
+  ggf_gfx_frame_op_t op = {0};
+  op.type = GGF_GFX_FRAME_OP_STATIC_DESTROY;
+  op.static_batch = batch;
+  ggf_internal_gfx_run_op(&op);
+}
+
+void ggf_gfx_static_batch_begin(ggf_gfx_static_batch_t *batch) {
+  ggf_gfx_recorder_begin(&batch->recorder);
+}
+
+internal_func void
+ggf_internal_gfx_static_batch_mark(ggf_gfx_static_batch_t *batch, u32 first,
+                                   u32 end) {
+  if (batch->dirty_first == batch->dirty_end) {
+    batch->dirty_first = first;
+    batch->dirty_end = end;
+    return;
+  }
+  batch->dirty_first = GGF_MIN(batch->dirty_first, first);
+  batch->dirty_end = GGF_MAX(batch->dirty_end, end);
+}
+
+b32 ggf_gfx_static_batch_end(ggf_gfx_static_batch_t *batch) {
   ggf_gfx_t *gfx = ggf_data->gfx;
+  ggf_gfx_recorder_t *recorder = &batch->recorder;
+  GGF_ASSERT(ggf_gfx_thread_recorder == recorder);
+  ggf_gfx_recorder_end();
+
+  ggf_darray_clear(batch->instances);
+  ggf_darray_clear(batch->sizes);
+  batch->texture_count = 1;
+  batch->textures[0] = gfx->white_texture.id;
+
+  // in recording order, with the texture units resolved once
+  b32 result = TRUE;
+  u32 count = ggf_darray_get_length(recorder->commands);
+  for (u32 i = 0; i < count && result; i++) {
+    ggf_gfx_command_t *command = &recorder->commands[i];
+    ggf_gfx_pipeline_t pipeline =
+        (recorder->command_keys[i] >> GGF_GFX_SORT_KEY_PIPELINE_SHIFT) & 0xF;
+    if (pipeline != GGF_GFX_PIPELINE_SPRITE) {
+      GGF_ERROR("ERROR - ggf_gfx_static_batch_end: only sprites can be "
+                "retained");
+      result = FALSE;
+      break;
+    }
+
+    u32 unit = 0;
+    if (command->texture) {
+      unit = 1;
+      while (unit < batch->texture_count &&
+             batch->textures[unit] != command->texture)
+        unit++;
+      if (unit == GGF_GFX_MAX_TEXTURE_UNITS) {
+        GGF_ERROR("ERROR - ggf_gfx_static_batch_end: more than %d textures",
+                  GGF_GFX_MAX_TEXTURE_UNITS - 1);
+        result = FALSE;
+        break;
+      }
+      if (unit == batch->texture_count)
+        batch->textures[batch->texture_count++] = command->texture;
+    }
 
-  // FIXME: stops working after two circles.
+    ggf_sprite_instance_t instance =
+        recorder->sprite_instances[command->primitive];
+    instance.texture_index = (f32)unit;
+    batch->instances = ggf_darray_push(batch->instances, &instance);
+    batch->sizes = ggf_darray_push(batch->sizes, instance.size);
+  }
+  ggf_internal_gfx_recorder_clear(recorder);
 
-  if (gfx->num_circles + 1 >= GGF_GFX_MAX_NUM_CIRCLES) {
-    GGF_WARN("WARNING: ggf_gfx_draw_circle - Max num circles surpassed. "
-             "Flusing graphics buffers which may cause artifacts. IMPORTANT! - "
-             "INCREASE [GGF_GFX_MAX_NUM_CIRCLES]");
-    ggf_gfx_flush();
+  if (!result) {
+    ggf_darray_clear(batch->instances);
+    ggf_darray_clear(batch->sizes);
+    count = 0;
   }
 
-  f32 texture_index = ggf_internal_gfx_get_texture_index(texture);
+  ggf_memory_free(batch->visible.words);
+  ggf_memory_zero(&batch->visible, sizeof(batch->visible));
+  if (count > 0) {
+    u64 memory_requirement;
+    ggf_bitset_create(count, &memory_requirement, NULL, &batch->visible);
+    ggf_bitset_create(
+        count, &memory_requirement,
+        ggf_memory_alloc(memory_requirement, GGF_MEMORY_TAG_GRAPHICS),
+        &batch->visible);
+    ggf_bitset_set_all(&batch->visible);
+  }
+  ggf_internal_gfx_static_batch_mark(batch, 0, count);
+  return result;
+}
 
-  ggf_circle_vertex_t vertices[4] = {
-      {{center[0] - radius, center[1] - radius, depth},
-       {-1.0f, -1.0f},
-       {color[0], color[1], color[2], color[3]},
-       {0.0f, 1.0f, texture_index}},
-      {{center[0] + radius, center[1] - radius, depth},
-       {1.0f, -1.0f},
-       {color[0], color[1], color[2], color[3]},
-       {1.0f, 1.0f, texture_index}},
-      {{center[0] + radius, center[1] + radius, depth},
-       {1.0f, 1.0f},
-       {color[0], color[1], color[2], color[3]},
-       {1.0f, 0.0f, texture_index}},
-      {{center[0] - radius, center[1] + radius, depth},
-       {-1.0f, 1.0f},
-       {color[0], color[1], color[2], color[3]},
-       {0.0f, 0.0f, texture_index}},
-  };
+u32 ggf_gfx_static_batch_get_count(ggf_gfx_static_batch_t *batch) {
+  return ggf_darray_get_length(batch->instances);
+}
+
+void ggf_gfx_static_batch_set_visible(ggf_gfx_static_batch_t *batch, u32 first,
+                                      u32 count, b32 visible) {
+  GGF_ASSERT(first + count <= ggf_darray_get_length(batch->instances));
+  for (u32 i = first; i < first + count; i++) {
+    ggf_bitset_assign(&batch->visible, i, visible);
+    if (visible)
+      glm_vec2_copy(batch->sizes[i], batch->instances[i].size);
+    else
+      glm_vec2_zero(batch->instances[i].size);
+  }
+  ggf_internal_gfx_static_batch_mark(batch, first, first + count);
+}
+
+void ggf_gfx_static_batch_update(ggf_gfx_static_batch_t *batch, u32 index,
+                                 vec2 pos, vec2 size, f32 rotation, f32 depth,
+                                 vec4 color, vec4 uv_rect) {
+  GGF_ASSERT(index < ggf_darray_get_length(batch->instances));
+  ggf_sprite_instance_t *instance = &batch->instances[index];
+  ggf_internal_gfx_sprite_instance(pos, size, rotation, depth, color, uv_rect,
+                                   instance->texture_index, instance);
+  glm_vec2_copy(size, batch->sizes[index]);
+  if (!ggf_bitset_test(&batch->visible, index))
+    glm_vec2_zero(instance->size);
+  ggf_internal_gfx_static_batch_mark(batch, index, index + 1);
+}
+
+void ggf_gfx_draw_static_batch(ggf_gfx_static_batch_t *batch) {
+  GGF_ASSERT(!ggf_gfx_thread_recorder);
+  u32 count = ggf_darray_get_length(batch->instances);
+  if (count == 0)
+    return;
+
+  if (batch->dirty_first != batch->dirty_end) {
+    ggf_gfx_frame_op_t op = {0};
+    op.type = GGF_GFX_FRAME_OP_STATIC_UPLOAD;
+    op.static_batch = batch;
+    // grown batches get a new buffer, filled completely
+    if (count > batch->capacity) {
+      op.capacity = count;
+      batch->capacity = count;
+      batch->dirty_first = 0;
+      batch->dirty_end = count;
+    }
+    op.first = batch->dirty_first;
+    op.data = &batch->instances[batch->dirty_first];
+    op.data_size = sizeof(ggf_sprite_instance_t) *
+                   (batch->dirty_end - batch->dirty_first);
+    ggf_internal_gfx_run_op(&op);
+    batch->dirty_first = batch->dirty_end = 0;
+  }
+
+  ggf_gfx_static_draw_t draw;
+  draw.batch = batch;
+  draw.count = count;
+  draw.texture_count = batch->texture_count;
+  ggf_memory_copy(draw.textures, batch->textures,
+                  sizeof(u32) * batch->texture_count);
+  ggf_internal_gfx_push_command(GGF_GFX_PIPELINE_STATIC_SPRITE, 0, 0.0f, &draw);
+}
+
+// records a shape, the texture unit is filled in at flush
+internal_func void ggf_internal_gfx_push_shape(ggf_gfx_shape_type_t type,
+                                               vec2 a, vec2 b, f32 radius,
+                                               f32 thickness, f32 rotation,
+                                               f32 depth, vec4 color,
+                                               ggf_texture_t *texture) {
+  ggf_shape_instance_t instance;
+  glm_vec2_copy(a, instance.a);
+  glm_vec2_copy(b, instance.b);
+  instance.radius = radius;
+  instance.thickness = thickness;
+  instance.rotation = rotation;
+  instance.depth = depth;
+  instance.color = ggf_internal_gfx_pack_color(color);
+  instance.texture_index = 0.0f;
+  instance.type = type;
+
+  ggf_internal_gfx_push_command(GGF_GFX_PIPELINE_SHAPE,
+                                texture ? texture->id : 0, depth, &instance);
+}
+
+void ggf_gfx_draw_line(vec2 p1, vec2 p2, f32 depth, f32 width, vec4 color,
+                       ggf_texture_t *texture) {
+  ggf_internal_gfx_push_shape(GGF_GFX_SHAPE_CAPSULE, p1, p2, width, 0.0f, 0.0f,
+                              depth, color, texture);
+}
+
+void ggf_gfx_draw_point(vec2 point, f32 depth, f32 size, vec4 color,
+                        ggf_texture_t *texture) {
+  ggf_internal_gfx_push_shape(GGF_GFX_SHAPE_CIRCLE, point, point, size, 0.0f,
+                              0.0f, depth, color, texture);
+}
+
+void ggf_gfx_draw_circle(vec2 center, f32 depth, f32 radius, vec4 color,
+                         ggf_texture_t *texture) {
+  ggf_internal_gfx_push_shape(GGF_GFX_SHAPE_CIRCLE, center, center, radius,
+                              0.0f, 0.0f, depth, color, texture);
+}
+
+void ggf_gfx_draw_ring(vec2 center, f32 depth, f32 radius, f32 thickness,
+                       vec4 color, ggf_texture_t *texture) {
+  ggf_internal_gfx_push_shape(GGF_GFX_SHAPE_CIRCLE, center, center, radius,
+                              thickness, 0.0f, depth, color, texture);
+}
+
+void ggf_gfx_draw_rounded_rect(vec2 pos, vec2 size, f32 corner_radius,
+                               f32 rotation, f32 depth, vec4 color,
+                               ggf_texture_t *texture) {
+  vec2 half_size = {size[0] * 0.5f, size[1] * 0.5f};
+  vec2 center = {pos[0] + half_size[0], pos[1] + half_size[1]};
+  ggf_internal_gfx_push_shape(GGF_GFX_SHAPE_ROUNDED_RECT, center, half_size,
+                              corner_radius, 0.0f, rotation, depth, color,
+                              texture);
+}
 
-  ggf_memory_copy(&gfx->circle_vertices[gfx->num_circles * 4], vertices,
-                  sizeof(vertices));
+void ggf_gfx_draw_rect_outline(vec2 pos, vec2 size, f32 corner_radius,
+                               f32 thickness, f32 depth, vec4 color,
+                               ggf_texture_t *texture) {
+  vec2 half_size = {size[0] * 0.5f, size[1] * 0.5f};
+  vec2 center = {pos[0] + half_size[0], pos[1] + half_size[1]};
+  ggf_internal_gfx_push_shape(GGF_GFX_SHAPE_ROUNDED_RECT, center, half_size,
+                              corner_radius, thickness, 0.0f, depth, color,
+                              texture);
+}
 
-  gfx->num_circles++;
+void ggf_gfx_draw_capsule(vec2 p1, vec2 p2, f32 depth, f32 radius,
+                          f32 thickness, vec4 color, ggf_texture_t *texture) {
+  ggf_internal_gfx_push_shape(GGF_GFX_SHAPE_CAPSULE, p1, p2, radius,
+                              thickness, 0.0f, depth, color, texture);
 }
 
 internal_func void ggf_internal_gfx_utf8_to_unicode(char *str, u32 *out_unicode,
@@ -2243,10 +6249,6 @@ internal_func void ggf_internal_gfx_utf8_to_unicode(char *str, u32 *out_unicode,
 
 void ggf_gfx_draw_text(char *text, vec2 pos, u32 size, vec4 color,
                        ggf_font_t *font) {
-  ggf_gfx_t *gfx = ggf_data->gfx;
-
-  f32 texture_index = ggf_internal_gfx_get_texture_index(&font->sdf_texture);
-
   u32 unicode[512];
   u32 len = 0;
   ggf_internal_gfx_utf8_to_unicode(text, unicode, &len);
@@ -2261,12 +6263,6 @@ void ggf_gfx_draw_text(char *text, vec2 pos, u32 size, vec4 color,
       x_off = 0.0f;
       continue;
     }
-    if (gfx->num_text_characters + 1 >= GGF_GFX_MAX_NUM_TEXT_CHARACTERS) {
-      GGF_WARN("WARNING: ggf_gfx_draw_text - Max num text characters "
-               "surpassed. Flusing graphics buffers which may cause artifacts. "
-               "IMPORTANT! - INCREASE [GGF_GFX_MAX_NUM_TEXT_CHARACTERS]");
-      ggf_gfx_flush();
-    }
 
     ggf_hash_map_iter_t iter = ggf_hash_map_find(&font->glyphs, &unicode[i]);
     if (!iter) {
@@ -2291,25 +6287,25 @@ void ggf_gfx_draw_text(char *text, vec2 pos, u32 size, vec4 color,
     ggf_basic_vertex_t vertices[4] = {
         {{left, top, screen_px_range},
          {color[0], color[1], color[2], color[3]},
-         {uv_l, uv_t, texture_index}},
+         {uv_l, uv_t, 0.0f}},
         {{right, top, screen_px_range},
          {color[0], color[1], color[2], color[3]},
-         {uv_r, uv_t, texture_index}},
+         {uv_r, uv_t, 0.0f}},
         {{right, bottom, screen_px_range},
          {color[0], color[1], color[2], color[3]},
-         {uv_r, uv_b, texture_index}},
+         {uv_r, uv_b, 0.0f}},
         {{left, bottom, screen_px_range},
          {color[0], color[1], color[2], color[3]},
-         {uv_l, uv_b, texture_index}},
+         {uv_l, uv_b, 0.0f}},
     };
-    ggf_memory_copy(&gfx->text_vertices[gfx->num_text_characters * 4], vertices,
-                    sizeof(vertices));
-    gfx->num_text_characters++;
+    ggf_internal_gfx_push_command(GGF_GFX_PIPELINE_TEXT, font->sdf_texture.id,
+                                  0.0f, vertices);
   }
 }
 
 b32 ggf_shader_create(u8 stage_count, ggf_shader_stage_t *stages,
                       const char **source_codes, ggf_shader_t *out_shader) {
+  GGF_ASSERT(ggf_internal_gfx_owns_context());
   u32 program = glCreateProgram();
 
   GLenum shader_stages[GGF_SHADER_STAGE_MAX] = {
@@ -2367,11 +6363,16 @@ b32 ggf_shader_create(u8 stage_count, ggf_shader_stage_t *stages,
   return TRUE;
 }
 
-void ggf_shader_destroy(ggf_shader_t *shader) { glDeleteProgram(shader->id); }
+void ggf_shader_destroy(ggf_shader_t *shader) {
+  GGF_ASSERT(ggf_internal_gfx_owns_context());
+  glDeleteProgram(shader->id);
+  ggf_internal_gfx_forget_program(shader->id);
+}
 
 void ggf_shader_bind_uniform_buffer(ggf_shader_t *shader, const char *name,
                                     ggf_uniform_buffer_t *buffer) {
-  glUseProgram(shader->id);
+  GGF_ASSERT(ggf_internal_gfx_owns_context());
+  ggf_internal_gfx_use_program(shader->id);
   u32 location = glGetUniformBlockIndex(shader->id, name);
   glUniformBlockBinding(shader->id, location, buffer->index);
 }
@@ -2432,42 +6433,50 @@ global_variable const struct {
     {GL_R11F_G11F_B10F, GL_RGB, GL_UNSIGNED_INT_10F_11F_11F_REV},
 };
 
-b32 ggf_texture_create(void *data, ggf_texture_format_t format, u32 width,
-                       u32 height, ggf_texture_filter_t filter,
-                       ggf_texture_wrap_t wrap, ggf_texture_t *out_texture) {
-  GLint gl_min_filter, gl_mag_filter;
+// maps a filter and wrap mode to their OpenGL values. returns FALSE if either
+// is invalid.
+internal_func b32 ggf_internal_texture_gl_sampling(ggf_texture_filter_t filter,
+                                                   ggf_texture_wrap_t wrap,
+                                                   GLint *out_gl_filter,
+                                                   GLint *out_gl_wrap) {
   if (filter == GGF_TEXTURE_FILTER_NEAREST) {
-    gl_min_filter = GL_NEAREST;
-    gl_mag_filter = GL_NEAREST;
+    *out_gl_filter = GL_NEAREST;
   } else if (filter == GGF_TEXTURE_FILTER_LINEAR) {
-    gl_min_filter = GL_LINEAR;
-    gl_mag_filter = GL_LINEAR;
+    *out_gl_filter = GL_LINEAR;
   } else {
-    GGF_ERROR("ERROR - ggf_texture_create: Invalid texture filter!");
     return FALSE;
   }
 
-  GLint gl_wrap;
   switch (wrap) {
   case GGF_TEXTURE_WRAP_REPEAT:
-    gl_wrap = GL_REPEAT;
+    *out_gl_wrap = GL_REPEAT;
     break;
   case GGF_TEXTURE_WRAP_CLAMP_TO_EDGE:
-    gl_wrap = GL_CLAMP_TO_EDGE;
+    *out_gl_wrap = GL_CLAMP_TO_EDGE;
     break;
   case GGF_TEXTURE_WRAP_CLAMP_TO_BORDER:
-    gl_wrap = GL_CLAMP_TO_BORDER;
+    *out_gl_wrap = GL_CLAMP_TO_BORDER;
     break;
   case GGF_TEXTURE_WRAP_MIRRORED_REPEAT:
-    gl_wrap = GL_MIRRORED_REPEAT;
+    *out_gl_wrap = GL_MIRRORED_REPEAT;
     break;
   case GGF_TEXTURE_WRAP_MIRRORED_CLAMP_TO_EDGE:
-    gl_wrap = GL_MIRROR_CLAMP_TO_EDGE;
+    *out_gl_wrap = GL_MIRROR_CLAMP_TO_EDGE;
     break;
-  default: {
-    GGF_ERROR("ERROR - ggf_texture_create: Invalid texture wrap!");
+  default:
     return FALSE;
   }
+  return TRUE;
+}
+
+b32 ggf_texture_create(void *data, ggf_texture_format_t format, u32 width,
+                       u32 height, ggf_texture_filter_t filter,
+                       ggf_texture_wrap_t wrap, ggf_texture_t *out_texture) {
+  GGF_ASSERT(ggf_internal_gfx_owns_context());
+  GLint gl_filter, gl_wrap;
+  if (!ggf_internal_texture_gl_sampling(filter, wrap, &gl_filter, &gl_wrap)) {
+    GGF_ERROR("ERROR - ggf_texture_create: Invalid texture filter or wrap!");
+    return FALSE;
   }
 
   glGenTextures(1, &out_texture->id);
@@ -2475,11 +6484,10 @@ b32 ggf_texture_create(void *data, ggf_texture_format_t format, u32 width,
     GGF_ERROR("ERROR - ggf_texture_create: Failed to generate texture!");
     return FALSE;
   }
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, out_texture->id);
+  ggf_internal_gfx_bind_texture(0, GL_TEXTURE_2D, out_texture->id);
 
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, gl_min_filter);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, gl_mag_filter);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, gl_filter);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, gl_filter);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, gl_wrap);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, gl_wrap);
 
@@ -2495,17 +6503,20 @@ b32 ggf_texture_create(void *data, ggf_texture_format_t format, u32 width,
 }
 
 void ggf_texture_destroy(ggf_texture_t *texture) {
+  GGF_ASSERT(ggf_internal_gfx_owns_context());
   glDeleteTextures(1, &texture->id);
+  ggf_internal_gfx_forget_texture(texture->id);
 }
 
 b32 ggf_texture_set_data(ggf_texture_t *texture, void *data,
                          ggf_texture_format_t format) {
+  GGF_ASSERT(ggf_internal_gfx_owns_context());
   if (texture->format != format) {
     GGF_ERROR("ERROR - ggf_texture_set_data: Texture format mismatch!");
     return FALSE;
   }
 
-  glBindTexture(GL_TEXTURE_2D, texture->id);
+  ggf_internal_gfx_bind_texture(0, GL_TEXTURE_2D, texture->id);
   glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, texture->width, texture->height,
                   gl_formats[texture->format].format,
                   gl_formats[texture->format].type, data);
@@ -2513,10 +6524,130 @@ b32 ggf_texture_set_data(ggf_texture_t *texture, void *data,
   return TRUE;
 }
 
+b32 ggf_texture_array_create(void *data, ggf_texture_format_t format,
+                             u32 width, u32 height, u32 layer_count,
+                             ggf_texture_filter_t filter,
+                             ggf_texture_wrap_t wrap,
+                             ggf_texture_array_t *out_array) {
+  GGF_ASSERT(ggf_internal_gfx_owns_context());
+  GGF_ASSERT(layer_count > 0);
+  GLint gl_filter, gl_wrap;
+  if (!ggf_internal_texture_gl_sampling(filter, wrap, &gl_filter, &gl_wrap)) {
+    GGF_ERROR(
+        "ERROR - ggf_texture_array_create: Invalid texture filter or wrap!");
+    return FALSE;
+  }
+
+  glGenTextures(1, &out_array->id);
+  if (out_array->id == 0) {
+    GGF_ERROR("ERROR - ggf_texture_array_create: Failed to generate texture!");
+    return FALSE;
+  }
+  ggf_internal_gfx_bind_texture(0, GL_TEXTURE_2D_ARRAY, out_array->id);
+
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, gl_filter);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, gl_filter);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, gl_wrap);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, gl_wrap);
+
+  glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, gl_formats[format].internal_format,
+               width, height, layer_count, 0, gl_formats[format].format,
+               gl_formats[format].type, data);
+
+  out_array->width = width;
+  out_array->height = height;
+  out_array->layer_count = layer_count;
+  out_array->format = format;
+
+  return TRUE;
+}
+
+void ggf_texture_array_destroy(ggf_texture_array_t *array) {
+  GGF_ASSERT(ggf_internal_gfx_owns_context());
+  glDeleteTextures(1, &array->id);
+  ggf_internal_gfx_forget_texture(array->id);
+}
+
+b32 ggf_texture_array_set_layer(ggf_texture_array_t *array, u32 layer,
+                                void *data, ggf_texture_format_t format) {
+  GGF_ASSERT(ggf_internal_gfx_owns_context());
+  if (array->format != format) {
+    GGF_ERROR("ERROR - ggf_texture_array_set_layer: Texture format mismatch!");
+    return FALSE;
+  }
+  if (layer >= array->layer_count) {
+    GGF_ERROR("ERROR - ggf_texture_array_set_layer: Layer %u out of range!",
+              layer);
+    return FALSE;
+  }
+
+  ggf_internal_gfx_bind_texture(0, GL_TEXTURE_2D_ARRAY, array->id);
+  glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, array->width,
+                  array->height, 1, gl_formats[array->format].format,
+                  gl_formats[array->format].type, data);
+
+  return TRUE;
+}
+
+b32 ggf_render_target_create(u32 width, u32 height,
+                             ggf_texture_format_t format,
+                             ggf_texture_filter_t filter, b32 with_depth,
+                             ggf_render_target_t *out_target) {
+  GGF_ASSERT(ggf_internal_gfx_owns_context());
+  GGF_ASSERT(width && height);
+  ggf_memory_zero(out_target, sizeof(ggf_render_target_t));
+  out_target->width = width;
+  out_target->height = height;
+
+  if (!ggf_texture_create(NULL, format, width, height, filter,
+                          GGF_TEXTURE_WRAP_CLAMP_TO_EDGE, &out_target->color)) {
+    GGF_ERROR("ERROR - ggf_render_target_create: Failed to create the color "
+              "texture!");
+    return FALSE;
+  }
+
+  glGenFramebuffers(1, &out_target->framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, out_target->framebuffer);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                         out_target->color.id, 0);
+  if (with_depth) {
+    glGenRenderbuffers(1, &out_target->depth_renderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, out_target->depth_renderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width,
+                          height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                              GL_RENDERBUFFER, out_target->depth_renderbuffer);
+  }
+
+  GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  ggf_gfx_t *gfx = ggf_data->gfx;
+  glBindFramebuffer(GL_FRAMEBUFFER,
+                    gfx && gfx->render_target
+                        ? gfx->render_target->framebuffer
+                        : 0);
+  if (status != GL_FRAMEBUFFER_COMPLETE) {
+    GGF_ERROR("ERROR - ggf_render_target_create: Incomplete framebuffer: %x",
+              status);
+    ggf_render_target_destroy(out_target);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+void ggf_render_target_destroy(ggf_render_target_t *target) {
+  GGF_ASSERT(ggf_internal_gfx_owns_context());
+  if (target->depth_renderbuffer)
+    glDeleteRenderbuffers(1, &target->depth_renderbuffer);
+  glDeleteFramebuffers(1, &target->framebuffer);
+  ggf_texture_destroy(&target->color);
+}
+
 b32 ggf_uniform_buffer_create(u64 size, void *data,
                               ggf_uniform_buffer_t *out_buffer) {
+  GGF_ASSERT(ggf_internal_gfx_owns_context());
   glGenBuffers(1, &out_buffer->id);
-  glBindBuffer(GL_UNIFORM_BUFFER, out_buffer->id);
+  ggf_internal_gfx_bind_buffer(GGF_GFX_BUFFER_TARGET_UNIFORM, out_buffer->id);
   glBufferData(GL_UNIFORM_BUFFER, size, data, GL_DYNAMIC_DRAW);
 
   local_persist u32 index = 0;
@@ -2528,12 +6659,15 @@ b32 ggf_uniform_buffer_create(u64 size, void *data,
 }
 
 void ggf_uniform_buffer_destroy(ggf_uniform_buffer_t *buffer) {
+  GGF_ASSERT(ggf_internal_gfx_owns_context());
   glDeleteBuffers(1, &buffer->id);
+  ggf_internal_gfx_forget_buffer(buffer->id);
 }
 
 void ggf_uniform_buffer_set_data(ggf_uniform_buffer_t *buffer, u64 offset,
                                  u64 size, void *data) {
-  glBindBuffer(GL_UNIFORM_BUFFER, buffer->id);
+  GGF_ASSERT(ggf_internal_gfx_owns_context());
+  ggf_internal_gfx_bind_buffer(GGF_GFX_BUFFER_TARGET_UNIFORM, buffer->id);
   glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
 }
 
@@ -2559,6 +6693,7 @@ internal_func char *ggf_internal_font_read_csv_value(char *line, f64 *out_val) {
 
 b32 ggf_font_load(const char *sdf_filename, const char *csv_filename,
                   ggf_font_t *out_font) {
+  GGF_ASSERT(ggf_internal_gfx_owns_context());
   char path[512];
 
   // load image
@@ -2622,6 +6757,7 @@ b32 ggf_font_load(const char *sdf_filename, const char *csv_filename,
 }
 
 void ggf_font_destroy(ggf_font_t *font) {
+  GGF_ASSERT(ggf_internal_gfx_owns_context());
   GGF_HM_DESTROY(font->glyphs);
   ggf_texture_destroy(&font->sdf_texture);
 }
@@ -2635,4 +6771,307 @@ f32 ggf_font_get_text_width(ggf_font_t *font, char *text, u32 size) {
     width += glyph->advance * (f32)size;
   }
   return width;
-}
\ No newline at end of file
+}
+// texture atlas
+
+typedef struct {
+  u32 x, width;
+} ggf_internal_atlas_span_t;
+
+typedef struct {
+  u32 y, height;
+  ggf_internal_atlas_span_t *free_spans; // darray, sorted by x
+} ggf_internal_atlas_shelf_t;
+
+b32 ggf_atlas_create(u32 page_width, u32 page_height,
+                     ggf_texture_filter_t filter, b32 use_texture_array,
+                     ggf_atlas_t *out_atlas) {
+  GGF_ASSERT(ggf_internal_gfx_owns_context());
+  GGF_ASSERT(page_width && page_height);
+  ggf_memory_zero(out_atlas, sizeof(ggf_atlas_t));
+  out_atlas->page_width = page_width;
+  out_atlas->page_height = page_height;
+  out_atlas->filter = filter;
+  out_atlas->use_texture_array = use_texture_array;
+  if (use_texture_array &&
+      !ggf_texture_array_create(NULL, GGF_TEXTURE_FORMAT_RGBA8, page_width,
+                                page_height, GGF_ATLAS_MAX_PAGES, filter,
+                                GGF_TEXTURE_WRAP_CLAMP_TO_EDGE,
+                                &out_atlas->page_array))
+    return FALSE;
+  return ggf_handle_pool_create(GGF_ATLAS_MAX_REGIONS,
+                                sizeof(ggf_atlas_region_t),
+                                &out_atlas->regions);
+}
+
+void ggf_atlas_destroy(ggf_atlas_t *atlas) {
+  GGF_ASSERT(ggf_internal_gfx_owns_context());
+  for (u32 page = 0; page < atlas->page_count; page++) {
+    ggf_internal_atlas_shelf_t *shelves = atlas->shelves[page];
+    for (u64 i = 0; i < ggf_darray_get_length(shelves); i++) {
+      ggf_darray_destroy(shelves[i].free_spans);
+    }
+    ggf_darray_destroy(shelves);
+    if (!atlas->use_texture_array)
+      ggf_texture_destroy(&atlas->pages[page]);
+  }
+  if (atlas->use_texture_array)
+    ggf_texture_array_destroy(&atlas->page_array);
+  ggf_handle_pool_destroy(&atlas->regions);
+}
+
+// takes width from the first free span that fits. returns FALSE if none does.
+internal_func b32 ggf_internal_atlas_shelf_alloc(
+    ggf_internal_atlas_shelf_t *shelf, u32 width, u32 *out_x) {
+  u64 span_count = ggf_darray_get_length(shelf->free_spans);
+  for (u64 i = 0; i < span_count; i++) {
+    ggf_internal_atlas_span_t *span = &shelf->free_spans[i];
+    if (span->width < width)
+      continue;
+    *out_x = span->x;
+    span->x += width;
+    span->width -= width;
+    if (span->width == 0)
+      ggf_darray_pop_at(shelf->free_spans, i, NULL);
+    return TRUE;
+  }
+  return FALSE;
+}
+
+// finds space for a padded rect, best fitting shelf first, then a new shelf,
+// then a new page
+internal_func b32 ggf_internal_atlas_alloc(ggf_atlas_t *atlas, u32 width,
+                                           u32 height,
+                                           ggf_atlas_region_t *out_region) {
+  if (width > atlas->page_width || height > atlas->page_height)
+    return FALSE;
+
+  for (u32 page = 0; page < atlas->page_count; page++) {
+    ggf_internal_atlas_shelf_t *shelves = atlas->shelves[page];
+    u64 shelf_count = ggf_darray_get_length(shelves);
+
+    // try shelves from the tightest height up
+    u32 tried_height = height;
+    for (;;) {
+      u32 best = GGF_INVALID_ID;
+      for (u64 i = 0; i < shelf_count; i++) {
+        if (shelves[i].height >= tried_height &&
+            (best == GGF_INVALID_ID ||
+             shelves[i].height < shelves[best].height))
+          best = i;
+      }
+      if (best == GGF_INVALID_ID)
+        break;
+
+      for (u64 i = 0; i < shelf_count; i++) {
+        u32 x;
+        if (shelves[i].height == shelves[best].height &&
+            ggf_internal_atlas_shelf_alloc(&shelves[i], width, &x)) {
+          out_region->page = page;
+          out_region->shelf = i;
+          out_region->x = x;
+          out_region->y = shelves[i].y;
+          return TRUE;
+        }
+      }
+      tried_height = shelves[best].height + 1;
+    }
+
+    u32 top = 0;
+    if (shelf_count > 0)
+      top = shelves[shelf_count - 1].y + shelves[shelf_count - 1].height;
+    if (top + height <= atlas->page_height) {
+      ggf_internal_atlas_shelf_t shelf;
+      shelf.y = top;
+      shelf.height = height;
+      shelf.free_spans = ggf_darray_create(4, sizeof(ggf_internal_atlas_span_t));
+      ggf_internal_atlas_span_t span = {0, atlas->page_width};
+      shelf.free_spans = ggf_darray_push(shelf.free_spans, &span);
+      atlas->shelves[page] = ggf_darray_push(shelves, &shelf);
+
+      shelves = atlas->shelves[page];
+      ggf_internal_atlas_shelf_alloc(&shelves[shelf_count], width,
+                                     &out_region->x);
+      out_region->page = page;
+      out_region->shelf = shelf_count;
+      out_region->y = top;
+      return TRUE;
+    }
+  }
+
+  if (atlas->page_count == GGF_ATLAS_MAX_PAGES)
+    return FALSE;
+
+  // start the new page transparent
+  u32 page = atlas->page_count;
+  u64 page_size = (u64)atlas->page_width * atlas->page_height * 4;
+  void *clear_pixels = ggf_memory_alloc(page_size, GGF_MEMORY_TAG_GRAPHICS);
+  b32 created;
+  if (atlas->use_texture_array)
+    created = ggf_texture_array_set_layer(&atlas->page_array, page,
+                                          clear_pixels,
+                                          GGF_TEXTURE_FORMAT_RGBA8);
+  else
+    created = ggf_texture_create(
+        clear_pixels, GGF_TEXTURE_FORMAT_RGBA8, atlas->page_width,
+        atlas->page_height, atlas->filter, GGF_TEXTURE_WRAP_CLAMP_TO_EDGE,
+        &atlas->pages[page]);
+  ggf_memory_free(clear_pixels);
+  if (!created)
+    return FALSE;
+  atlas->shelves[page] = ggf_darray_create(8, sizeof(ggf_internal_atlas_shelf_t));
+  atlas->page_count++;
+
+  return ggf_internal_atlas_alloc(atlas, width, height, out_region);
+}
+
+// gives span back to its shelf, merged with its free neighbours, and drops
+// empty shelves at the bottom of the page so their height is reused
+internal_func void ggf_internal_atlas_free(ggf_atlas_t *atlas, u32 page,
+                                           u32 shelf_index,
+                                           ggf_internal_atlas_span_t span) {
+  ggf_internal_atlas_shelf_t *shelves = atlas->shelves[page];
+  ggf_internal_atlas_shelf_t *shelf = &shelves[shelf_index];
+
+  u64 span_count = ggf_darray_get_length(shelf->free_spans);
+  u64 index = 0;
+  while (index < span_count && shelf->free_spans[index].x < span.x)
+    index++;
+  if (index < span_count &&
+      span.x + span.width == shelf->free_spans[index].x) {
+    span.width += shelf->free_spans[index].width;
+    ggf_darray_pop_at(shelf->free_spans, index, NULL);
+  }
+  if (index > 0) {
+    ggf_internal_atlas_span_t *previous = &shelf->free_spans[index - 1];
+    if (previous->x + previous->width == span.x) {
+      previous->width += span.width;
+    } else {
+      shelf->free_spans = ggf_darray_insert_at(shelf->free_spans, index, &span);
+    }
+  } else {
+    shelf->free_spans = ggf_darray_insert_at(shelf->free_spans, index, &span);
+  }
+
+  u64 shelf_count = ggf_darray_get_length(shelves);
+  while (shelf_count > 0) {
+    ggf_internal_atlas_shelf_t *last = &shelves[shelf_count - 1];
+    if (ggf_darray_get_length(last->free_spans) != 1 ||
+        last->free_spans[0].width != atlas->page_width)
+      break;
+    ggf_darray_destroy(last->free_spans);
+    ggf_darray_pop(shelves, NULL);
+    shelf_count--;
+  }
+}
+
+ggf_handle_t ggf_atlas_add(ggf_atlas_t *atlas, void *pixels, u32 width,
+                           u32 height) {
+  GGF_ASSERT(ggf_internal_gfx_owns_context());
+  GGF_ASSERT(pixels && width && height);
+
+  u32 padded_width = width + GGF_ATLAS_PADDING * 2;
+  u32 padded_height = height + GGF_ATLAS_PADDING * 2;
+  ggf_atlas_region_t region;
+  if (!ggf_internal_atlas_alloc(atlas, padded_width, padded_height, &region)) {
+    GGF_WARN("WARNING - ggf_atlas_add: no space left for %ux%u image", width,
+             height);
+    return GGF_INVALID_ID;
+  }
+
+  ggf_handle_t handle = ggf_handle_pool_add(&atlas->regions, &region);
+  if (handle == GGF_INVALID_ID) {
+    GGF_WARN("WARNING - ggf_atlas_add: too many regions, increase "
+             "[GGF_ATLAS_MAX_REGIONS]");
+    ggf_internal_atlas_span_t span = {region.x, padded_width};
+    ggf_internal_atlas_free(atlas, region.page, region.shelf, span);
+    return GGF_INVALID_ID;
+  }
+
+  // copy with the padding filled by the nearest edge pixel
+  ggf_linear_allocator_t *frame_allocator = ggf_get_frame_allocator();
+  u64 marker = frame_allocator->marker;
+  u32 *padded = ggf_linear_allocator_alloc_aligned(
+      frame_allocator, sizeof(u32) * padded_width * padded_height, 4);
+  u32 *source = pixels;
+  for (u32 y = 0; y < padded_height; y++) {
+    u32 source_y =
+        y < GGF_ATLAS_PADDING ? 0 : GGF_MIN(y - GGF_ATLAS_PADDING, height - 1);
+    for (u32 x = 0; x < padded_width; x++) {
+      u32 source_x = x < GGF_ATLAS_PADDING
+                         ? 0
+                         : GGF_MIN(x - GGF_ATLAS_PADDING, width - 1);
+      padded[y * padded_width + x] = source[source_y * width + source_x];
+    }
+  }
+  if (atlas->use_texture_array) {
+    ggf_internal_gfx_bind_texture(0, GL_TEXTURE_2D_ARRAY,
+                                  atlas->page_array.id);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, region.x, region.y, region.page,
+                    padded_width, padded_height, 1, GL_RGBA,
+                    GL_UNSIGNED_BYTE, padded);
+  } else {
+    ggf_internal_gfx_bind_texture(0, GL_TEXTURE_2D,
+                                  atlas->pages[region.page].id);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, region.x, region.y, padded_width,
+                    padded_height, GL_RGBA, GL_UNSIGNED_BYTE, padded);
+  }
+  ggf_linear_allocator_free_to_marker(frame_allocator, marker);
+
+  ggf_atlas_region_t *stored = ggf_atlas_get_region(atlas, handle);
+  stored->x += GGF_ATLAS_PADDING;
+  stored->y += GGF_ATLAS_PADDING;
+  stored->width = width;
+  stored->height = height;
+  stored->uv_rect[0] = (f32)stored->x / atlas->page_width;
+  stored->uv_rect[1] = (f32)stored->y / atlas->page_height;
+  stored->uv_rect[2] = (f32)(stored->x + width) / atlas->page_width;
+  stored->uv_rect[3] = (f32)(stored->y + height) / atlas->page_height;
+  return handle;
+}
+
+ggf_handle_t ggf_atlas_add_image(ggf_atlas_t *atlas, const char *filename) {
+  char path[512];
+  if (!ggf_asset_system_find_full_asset_path(GGF_ASSET_TYPE_TEXTURE, filename,
+                                             sizeof(path), path)) {
+    GGF_ERROR("ERROR - ggf_atlas_add_image: could not find image '%s'",
+              filename);
+    return GGF_INVALID_ID;
+  }
+
+  i32 width, height, comp_count;
+  stbi_uc *pixels = stbi_load(path, &width, &height, &comp_count, 4);
+  if (!pixels) {
+    GGF_ERROR("ERROR - ggf_atlas_add_image: could not load image '%s'", path);
+    return GGF_INVALID_ID;
+  }
+  ggf_handle_t handle = ggf_atlas_add(atlas, pixels, width, height);
+  stbi_image_free(pixels);
+  return handle;
+}
+
+b32 ggf_atlas_remove(ggf_atlas_t *atlas, ggf_handle_t region_handle) {
+  ggf_atlas_region_t *region = ggf_atlas_get_region(atlas, region_handle);
+  if (!region)
+    return FALSE;
+
+  // give the padded span back
+  ggf_internal_atlas_span_t span = {region->x - GGF_ATLAS_PADDING,
+                                    region->width + GGF_ATLAS_PADDING * 2};
+  ggf_internal_atlas_free(atlas, region->page, region->shelf, span);
+
+  return ggf_handle_pool_remove(&atlas->regions, region_handle);
+}
+
+void ggf_gfx_draw_atlas_region(vec2 pos, vec2 size, f32 depth, vec4 color,
+                               ggf_atlas_t *atlas, ggf_handle_t region_handle) {
+  ggf_atlas_region_t *region = ggf_atlas_get_region(atlas, region_handle);
+  if (!region)
+    return;
+  if (atlas->use_texture_array)
+    ggf_gfx_draw_sprite_layer(pos, size, 0.0f, depth, color, region->uv_rect,
+                              &atlas->page_array, region->page);
+  else
+    ggf_gfx_draw_sprite(pos, size, 0.0f, depth, color, region->uv_rect,
+                        &atlas->pages[region->page]);
+}
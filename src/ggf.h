@@ -27,6 +27,8 @@ typedef u8 b8;
 #define GGF_INVALID_ID 0xFFFFFFFFU
 #define GGF_INVALID_ID64 0xFFFFFFFFFFFFFFFFU
 
+#define GGF_CACHE_LINE_SIZE 64
+
 #define global_variable static
 #define local_persist static
 #define internal_func static
@@ -76,7 +78,11 @@ typedef u8 b8;
 
 // GGF - Great game framework
 
-// initialize ggf and layers - returns TRUE if successful
+// initialize ggf and layers - returns TRUE if successful. recognized
+// arguments:
+//   --headless   windows are offscreen (EGL, needs a GGF_EGL build such as
+//                build_headless.sh), for machines without a display or GPU
+//   --frames N   windows close after N swapped frames
 b32 ggf_init(i32 argc, char **argv);
 // shutdown ggf
 void ggf_shutdown();
@@ -95,6 +101,60 @@ u32 ggf_randi(u32 seed);    /* integer version */
 // hash
 u64 ggf_hash_string(const char *str);
 
+// string interning
+/*
+    every unique string is stored once and named by a ggf_string_id_t, so
+   equal strings compare as equal ids. interned strings live until
+   ggf_shutdown. all functions are thread-safe.
+*/
+typedef u32 ggf_string_id_t;
+
+// returns the id of str, adding it to the table the first time it is seen
+ggf_string_id_t ggf_string_intern(const char *str);
+// returns the id of str, or GGF_INVALID_ID if it was never interned
+ggf_string_id_t ggf_string_find(const char *str);
+// returns the interned string. the pointer stays valid until ggf_shutdown.
+const char *ggf_string_get(ggf_string_id_t id);
+u32 ggf_string_get_length(ggf_string_id_t id);
+
+// profiler
+/*
+    GGF_PROFILE_SCOPE("name") times the rest of the enclosing block as a
+   zone. zones are recorded into a ring buffer per thread, no locks are taken,
+   and once a ring is full its oldest zones are overwritten. names must
+   outlive the profiler, string literals are expected.
+    everything compiles out unless GGF_ENABLE_PROFILER is defined.
+*/
+#define GGF_PROFILER_ZONES_PER_THREAD 65536
+
+#ifdef GGF_ENABLE_PROFILER
+typedef struct {
+  const char *name;
+  u64 start;
+} ggf_profile_zone_t;
+
+ggf_profile_zone_t ggf_profile_zone_begin(const char *name);
+void ggf_profile_zone_end(ggf_profile_zone_t *zone);
+// shown for the calling thread in traces
+void ggf_profile_set_thread_name(const char *name);
+
+#define GGF_PROFILE_CONCAT_INNER(a, b) a##b
+#define GGF_PROFILE_CONCAT(a, b) GGF_PROFILE_CONCAT_INNER(a, b)
+#define GGF_PROFILE_SCOPE(name)                                                \
+  ggf_profile_zone_t GGF_PROFILE_CONCAT(ggf_profile_zone_, __LINE__)          \
+      __attribute__((cleanup(ggf_profile_zone_end))) =                         \
+          ggf_profile_zone_begin(name)
+#define GGF_PROFILE_THREAD_NAME(name) ggf_profile_set_thread_name(name)
+#else
+#define GGF_PROFILE_SCOPE(name)
+#define GGF_PROFILE_THREAD_NAME(name)
+#endif
+
+// writes every recorded zone as Chrome trace event JSON, viewable in
+// chrome://tracing or ui.perfetto.dev. zones still open are not included.
+// returns FALSE if the file can't be written or the profiler is compiled out.
+b32 ggf_profile_dump(const char *filename);
+
 // PLATFORM LAYER
 
 void *ggf_platform_mem_alloc(u64 size);
@@ -105,6 +165,16 @@ void ggf_platform_mem_zero(void *memory, u64 size);
 void ggf_platform_mem_copy(void *dest, void *source, u64 size);
 void ggf_platform_mem_set(void *memory, i32 value, u64 size);
 
+// blocks while *address == expected, until woken. may return spuriously.
+void ggf_platform_futex_wait(u32 *address, u32 expected);
+// wakes one (or all) threads waiting on address
+void ggf_platform_futex_wake(u32 *address, b32 wake_all);
+
+// monotonic time in seconds, only meaningful as a difference
+f64 ggf_platform_get_time();
+// monotonic time in nanoseconds, not slewed by NTP where the platform allows
+u64 ggf_platform_get_time_ns();
+
 typedef enum {
   GGF_PLATFORM_CONSOLE_COLOR_GRAY = 0,
   GGF_PLATFORM_CONSOLE_COLOR_RED,
@@ -139,8 +209,11 @@ void ggf_window_destroy(ggf_window_t *window);
 void ggf_window_switch_context(ggf_window_t *window);
 // returns TRUE if the provided window is open
 b32 ggf_window_is_open(ggf_window_t *window);
+// ask the window to close, ggf_window_is_open returns FALSE afterwards
+void ggf_window_close(ggf_window_t *window);
 // swap window buffers
 void ggf_window_swap_buffers(ggf_window_t *window);
+// headless windows keep their size, the setters below do nothing for them
 // set the window title
 void ggf_window_set_title(ggf_window_t *window, const char *title);
 // set the window size
@@ -363,6 +436,7 @@ typedef enum {
   GGF_MEMORY_TAG_HASH_MAP,
   GGF_MEMORY_TAG_IMAGE,
   GGF_MEMORY_TAG_DARRAY,
+  GGF_MEMORY_TAG_HANDLE_POOL,
 
   GGF_MEMORY_TAG_MAX,
 } ggf_memory_tag_t;
@@ -392,12 +466,30 @@ b32 ggf_linear_allocator_create(u64 size, void *memory,
                                 ggf_linear_allocator_t *out_allocator);
 void ggf_linear_allocator_destroy(ggf_linear_allocator_t *allocator);
 void *ggf_linear_allocator_alloc(ggf_linear_allocator_t *allocator, u64 size);
+// alignment must be a power of two
+void *ggf_linear_allocator_alloc_aligned(ggf_linear_allocator_t *allocator,
+                                         u64 size, u64 alignment);
 void ggf_linear_allocator_reset(ggf_linear_allocator_t *allocator);
+// releases everything allocated after marker was read from allocator->marker
+void ggf_linear_allocator_free_to_marker(ggf_linear_allocator_t *allocator,
+                                         u64 marker);
 void *
 ggf_linear_allocator_get_memory_at_marker(ggf_linear_allocator_t *allocator,
                                           u64 marker);
 
-// dynamic allocator
+// frame allocator
+/*
+    scratch linear allocator that ggf_poll_events resets, so its allocations
+   live until the next frame. nothing allocated from it has to be freed.
+*/
+#define GGF_FRAME_ALLOCATOR_SIZE GGF_MEGABYTES(64)
+
+ggf_linear_allocator_t *ggf_get_frame_allocator();
+
+// dynamic allocator. blocks are aligned to GGF_DYNAMIC_ALLOCATOR_ALIGNMENT,
+// enough for cglm's vec4 and mat4 and for SSE/NEON loads and stores.
+#define GGF_DYNAMIC_ALLOCATOR_ALIGNMENT 16
+
 typedef struct {
   void *internal_memory;
 } ggf_dynamic_allocator_t;
@@ -423,10 +515,89 @@ u64 ggf_darray_get_length(void *array);
 u64 ggf_darray_get_stride(void *array);
 void *ggf_darray_resize(void *array);
 void *ggf_darray_push(void *array, void *value_ptr);
+// appends count values, stored contiguously at values
+void *ggf_darray_push_many(void *array, void *values, u64 count);
 void ggf_darray_pop(void *array, void *dest);
 void *ggf_darray_pop_at(void *array, u64 index, void *dest);
 void *ggf_darray_insert_at(void *array, u64 index, void *value_ptr);
 
+// struct of arrays
+/*
+    GGF_SOA_DECLARE(name, FIELDS) declares name_t with one column pointer per
+   field together with name_create, name_destroy, name_clear, name_append and
+   name_remove_swap. FIELDS is an X-macro list of (type, field) pairs:
+
+        #define BALL_FIELDS(X) X(vec2, positions) X(vec2, directions)
+        GGF_SOA_DECLARE(ball_soa, BALL_FIELDS)
+
+    every column lives in the same allocation and starts on a
+   GGF_SOA_ALIGNMENT boundary. columns are accessed directly, e.g.
+   soa.positions[i].
+*/
+
+#define GGF_SOA_ALIGNMENT 64
+
+#define GGF_INTERNAL_SOA_ALIGN(value)                                          \
+  (((u64)(value) + GGF_SOA_ALIGNMENT - 1) & ~((u64)GGF_SOA_ALIGNMENT - 1))
+#define GGF_INTERNAL_SOA_MEMBER(type, field) type *field;
+#define GGF_INTERNAL_SOA_SIZE(type, field)                                     \
+  size += GGF_INTERNAL_SOA_ALIGN(sizeof(type) * capacity);
+#define GGF_INTERNAL_SOA_ASSIGN(type, field)                                   \
+  out_soa->field = (type *)block;                                              \
+  block += GGF_INTERNAL_SOA_ALIGN(sizeof(type) * capacity);
+#define GGF_INTERNAL_SOA_MOVE(type, field)                                     \
+  ggf_memory_copy(&soa->field[index], &soa->field[last], sizeof(type));
+
+#define GGF_SOA_DECLARE(name, FIELDS)                                          \
+  typedef struct {                                                             \
+    u32 count;                                                                 \
+    u32 capacity;                                                              \
+    void *memory;                                                              \
+    FIELDS(GGF_INTERNAL_SOA_MEMBER)                                            \
+  } name##_t;                                                                  \
+                                                                               \
+  static inline b32 name##_create(u32 capacity, ggf_memory_tag_t memory_tag,   \
+                                  name##_t *out_soa) {                         \
+    u64 size = GGF_SOA_ALIGNMENT; /* slack to align the first column */        \
+    FIELDS(GGF_INTERNAL_SOA_SIZE)                                              \
+    out_soa->memory = ggf_memory_alloc(size, memory_tag);                      \
+    if (!out_soa->memory)                                                      \
+      return FALSE;                                                            \
+    u8 *block = (u8 *)GGF_INTERNAL_SOA_ALIGN(out_soa->memory);                 \
+    FIELDS(GGF_INTERNAL_SOA_ASSIGN)                                            \
+    out_soa->count = 0;                                                        \
+    out_soa->capacity = capacity;                                              \
+    return TRUE;                                                               \
+  }                                                                            \
+                                                                               \
+  static inline void name##_destroy(name##_t *soa) {                           \
+    ggf_memory_free(soa->memory);                                              \
+    soa->memory = NULL;                                                        \
+    soa->count = 0;                                                            \
+    soa->capacity = 0;                                                         \
+  }                                                                            \
+                                                                               \
+  static inline void name##_clear(name##_t *soa) { soa->count = 0; }           \
+                                                                               \
+  /* appends up to count uninitialized rows. returns the number of rows        \
+     appended, the first of which is at out_first */                          \
+  static inline u32 name##_append(name##_t *soa, u32 count, u32 *out_first) {  \
+    count = GGF_MIN(count, soa->capacity - soa->count);                        \
+    if (out_first)                                                             \
+      *out_first = soa->count;                                                 \
+    soa->count += count;                                                       \
+    return count;                                                              \
+  }                                                                            \
+                                                                               \
+  /* removes a row by moving the last row into its place */                    \
+  static inline void name##_remove_swap(name##_t *soa, u32 index) {            \
+    GGF_ASSERT(index < soa->count);                                            \
+    u32 last = --soa->count;                                                   \
+    if (index != last) {                                                       \
+      FIELDS(GGF_INTERNAL_SOA_MOVE)                                            \
+    }                                                                          \
+  }
+
 // freelist
 typedef struct {
   void *internal_memory;
@@ -442,6 +613,162 @@ b32 ggf_freelist_free_block(ggf_freelist_t *freelist, u64 size, u64 offset);
 void ggf_freelist_clear(ggf_freelist_t *freelist);
 u64 ggf_freelist_get_free_space(ggf_freelist_t *freelist);
 
+// lock-free ring buffer queues
+/*
+    bounded queues of fixed size items, capacity is rounded up to a power of
+   two. spsc: one producer thread and one consumer thread. mpsc: any number of
+   producer threads and one consumer thread.
+
+    push and pop move as many items as currently fit and return the number of
+   items moved. wait blocks the consumer until the queue is not empty.
+*/
+typedef struct {
+  void *internal_memory;
+} ggf_spsc_queue_t;
+
+// creates a spsc queue. returns TRUE if the operation was successful.
+b32 ggf_spsc_queue_create(u64 capacity, u64 stride, u64 *memory_requirement,
+                          void *memory, ggf_spsc_queue_t *out_queue);
+void ggf_spsc_queue_destroy(ggf_spsc_queue_t *queue);
+u64 ggf_spsc_queue_push(ggf_spsc_queue_t *queue, u64 count, void *items);
+u64 ggf_spsc_queue_pop(ggf_spsc_queue_t *queue, u64 max_count,
+                       void *out_items);
+void ggf_spsc_queue_wait(ggf_spsc_queue_t *queue);
+u64 ggf_spsc_queue_get_length(ggf_spsc_queue_t *queue);
+
+typedef struct {
+  void *internal_memory;
+} ggf_mpsc_queue_t;
+
+// creates a mpsc queue. returns TRUE if the operation was successful.
+b32 ggf_mpsc_queue_create(u64 capacity, u64 stride, u64 *memory_requirement,
+                          void *memory, ggf_mpsc_queue_t *out_queue);
+void ggf_mpsc_queue_destroy(ggf_mpsc_queue_t *queue);
+u64 ggf_mpsc_queue_push(ggf_mpsc_queue_t *queue, u64 count, void *items);
+u64 ggf_mpsc_queue_pop(ggf_mpsc_queue_t *queue, u64 max_count,
+                       void *out_items);
+void ggf_mpsc_queue_wait(ggf_mpsc_queue_t *queue);
+u64 ggf_mpsc_queue_get_length(ggf_mpsc_queue_t *queue);
+
+// handle pool
+/*
+    stores objects densely and hands out 32 bit handles made of a slot index
+   and a generation. removing an object bumps the generation of its slot, so
+   handles to it stop validating instead of reaching whatever reuses the slot.
+   generations start at 1, so 0 (a zero initialized handle) never validates.
+*/
+
+typedef u32 ggf_handle_t;
+
+#define GGF_HANDLE_INDEX_BITS 20
+#define GGF_HANDLE_INDEX_MASK ((1u << GGF_HANDLE_INDEX_BITS) - 1)
+#define GGF_HANDLE_GENERATION_MASK (0xFFFFFFFFu >> GGF_HANDLE_INDEX_BITS)
+
+typedef struct {
+  u32 generation;
+  u32 dense_index; // next free slot while the slot is unused
+} ggf_handle_pool_slot_t;
+
+typedef struct {
+  u32 capacity;
+  u32 count;
+  u64 stride;
+  u32 free_head;
+  ggf_handle_pool_slot_t *slots;
+  u32 *dense_slots; // slot index of each dense object
+  u8 *objects;
+  void *memory;
+} ggf_handle_pool_t;
+
+// creates a handle pool. returns TRUE if the operation was successful.
+b32 ggf_handle_pool_create(u32 capacity, u64 stride,
+                           ggf_handle_pool_t *out_pool);
+void ggf_handle_pool_destroy(ggf_handle_pool_t *pool);
+void ggf_handle_pool_clear(ggf_handle_pool_t *pool);
+// copies value into the pool. returns GGF_INVALID_ID if the pool is full.
+ggf_handle_t ggf_handle_pool_add(ggf_handle_pool_t *pool, void *value);
+// removes the object, moving the last object into its place. returns FALSE if
+// the handle is stale.
+b32 ggf_handle_pool_remove(ggf_handle_pool_t *pool, ggf_handle_t handle);
+
+static inline b32 ggf_handle_pool_is_valid(ggf_handle_pool_t *pool,
+                                           ggf_handle_t handle) {
+  u32 index = handle & GGF_HANDLE_INDEX_MASK;
+  if (index >= pool->capacity)
+    return FALSE;
+  // a free slot keeps its generation, so it also has to hold an object
+  ggf_handle_pool_slot_t *slot = &pool->slots[index];
+  return slot->generation == handle >> GGF_HANDLE_INDEX_BITS &&
+         slot->dense_index < pool->count &&
+         pool->dense_slots[slot->dense_index] == index;
+}
+// returns the object of the handle, or NULL if the handle is stale.
+static inline void *ggf_handle_pool_get(ggf_handle_pool_t *pool,
+                                        ggf_handle_t handle) {
+  if (!ggf_handle_pool_is_valid(pool, handle))
+    return NULL;
+  u32 dense_index = pool->slots[handle & GGF_HANDLE_INDEX_MASK].dense_index;
+  return pool->objects + dense_index * pool->stride;
+}
+// objects are packed at the start of the pool, count in total.
+static inline void *ggf_handle_pool_get_objects(ggf_handle_pool_t *pool) {
+  return pool->objects;
+}
+
+// bitset
+/*
+    fixed size set of bits stored in u64 words. the bulk operations work on
+   whole words (two at a time with SSE2 or NEON) and the bits past bit_count
+   are always kept clear, so counts and scans never see them. all bitsets
+   passed to a bulk operation must have the same bit_count.
+*/
+
+#define GGF_BITSET_WORD_COUNT(bit_count) (((bit_count) + 63) / 64)
+
+typedef struct {
+  u32 bit_count;
+  u32 word_count;
+  u64 *words;
+} ggf_bitset_t;
+
+// if memory is NULL only memory_requirement is written. all bits start clear.
+void ggf_bitset_create(u32 bit_count, u64 *memory_requirement, void *memory,
+                       ggf_bitset_t *out_bitset);
+
+void ggf_bitset_set_all(ggf_bitset_t *bitset);
+void ggf_bitset_clear_all(ggf_bitset_t *bitset);
+void ggf_bitset_copy(ggf_bitset_t *dst, ggf_bitset_t *src);
+// dst may alias a or b
+void ggf_bitset_and(ggf_bitset_t *dst, ggf_bitset_t *a, ggf_bitset_t *b);
+void ggf_bitset_or(ggf_bitset_t *dst, ggf_bitset_t *a, ggf_bitset_t *b);
+void ggf_bitset_xor(ggf_bitset_t *dst, ggf_bitset_t *a, ggf_bitset_t *b);
+// dst = a & ~b
+void ggf_bitset_andnot(ggf_bitset_t *dst, ggf_bitset_t *a, ggf_bitset_t *b);
+
+u32 ggf_bitset_popcount(ggf_bitset_t *bitset);
+b32 ggf_bitset_any(ggf_bitset_t *bitset);
+// TRUE if any bit in [first, first + count) is set
+b32 ggf_bitset_any_in_range(ggf_bitset_t *bitset, u32 first, u32 count);
+// returns the index of the first set bit >= from, or GGF_INVALID_ID. iterate
+// with: for (i = find_next_set(b, 0); i != GGF_INVALID_ID;
+//            i = find_next_set(b, i + 1))
+u32 ggf_bitset_find_next_set(ggf_bitset_t *bitset, u32 from);
+
+static inline void ggf_bitset_set(ggf_bitset_t *bitset, u32 bit) {
+  bitset->words[bit >> 6] |= 1ull << (bit & 63);
+}
+static inline void ggf_bitset_clear(ggf_bitset_t *bitset, u32 bit) {
+  bitset->words[bit >> 6] &= ~(1ull << (bit & 63));
+}
+static inline void ggf_bitset_assign(ggf_bitset_t *bitset, u32 bit, b32 value) {
+  u64 mask = 1ull << (bit & 63);
+  u64 *word = &bitset->words[bit >> 6];
+  *word = value ? (*word | mask) : (*word & ~mask);
+}
+static inline b32 ggf_bitset_test(ggf_bitset_t *bitset, u32 bit) {
+  return (bitset->words[bit >> 6] >> (bit & 63)) & 1;
+}
+
 // hash map
 typedef b32 (*ggf_hash_map_key_comp_func_t)(void *, void *);
 typedef u64 (*ggf_hash_map_hash_func_t)(void *);
@@ -460,9 +787,9 @@ typedef struct {
 
 typedef u8 *ggf_hash_map_iter_t;
 
-static inline ggf_hash_map_iter_t ggf_hash_map_begin(ggf_hash_map_t *map) {
-  return map->buckets;
-}
+// iterate with for (it = ggf_hash_map_begin(map); it; it = ggf_hash_map_next(
+// map, it)). both return NULL past the last entry.
+ggf_hash_map_iter_t ggf_hash_map_begin(ggf_hash_map_t *map);
 static inline ggf_hash_map_iter_t ggf_hash_map_end(ggf_hash_map_t *map) {
   return map->buckets +
          map->buckets_reserved_count * (map->key_size + map->value_size);
@@ -520,6 +847,52 @@ void ggf_hash_map_erase(ggf_hash_map_t *map, ggf_hash_map_iter_t it);
         &map, ggf_hash_map_find(&map, &k));                                    \
   }
 
+// transient hash map
+/*
+    open addressing map from u64 keys to fixed size values for data that is
+   rebuilt often, like per frame dedup. every slot remembers the generation it
+   was written in, so clearing only bumps the map's generation and leaves the
+   slots alone. storage comes from a linear allocator (the frame allocator
+   when NULL) and is released with it; the map never grows.
+*/
+typedef struct {
+  u32 capacity;   // max entries
+  u32 slot_count; // power of two, at least twice the capacity
+  u32 count;
+  u32 generation;
+  u32 value_size;
+  u32 *stamps; // generation each slot was written in
+  u64 *keys;
+  u8 *values;
+} ggf_transient_map_t;
+
+void ggf_transient_map_create(u32 capacity, u32 value_size,
+                              ggf_linear_allocator_t *allocator,
+                              ggf_transient_map_t *out_map);
+void ggf_transient_map_clear(ggf_transient_map_t *map);
+// returns the value of key, or NULL if it is not in the map
+void *ggf_transient_map_find(ggf_transient_map_t *map, u64 key);
+// returns the value of key, adding a zeroed one if needed. out_inserted (may
+// be NULL) is set when the key was added. returns NULL if the map is full.
+void *ggf_transient_map_insert(ggf_transient_map_t *map, u64 key,
+                               b32 *out_inserted);
+
+// SORTING
+
+// radix sort
+/*
+    stable LSD radix sort on 8 bit digits, ascending. indices (may be NULL) is
+   permuted along with the keys, so filling it with 0..count-1 beforehand
+   yields the sorted order of a separate array. one histogram pass counts
+   every digit up front and digits that are equal for all keys are skipped.
+    scratch holds a copy of keys and indices while sorting and is rewound
+   before returning. NULL uses the frame allocator.
+*/
+void ggf_radix_sort_u32(u32 count, u32 *keys, u32 *indices,
+                        ggf_linear_allocator_t *scratch);
+void ggf_radix_sort_u64(u32 count, u64 *keys, u32 *indices,
+                        ggf_linear_allocator_t *scratch);
+
 // Asset Layer
 
 /*
@@ -529,7 +902,8 @@ void ggf_hash_map_erase(ggf_hash_map_t *map, ggf_hash_map_iter_t it);
    associated filepaths.
 */
 
-typedef u32 ggf_asset_handle_t;
+// handles are invalidated when their stage stops being used
+typedef ggf_handle_t ggf_asset_handle_t;
 typedef u32 ggf_asset_stage_index_t;
 
 typedef enum {
@@ -560,6 +934,7 @@ b32 ggf_asset_system_find_full_asset_path(ggf_asset_type_t type,
                                           const char *filename,
                                           u64 out_buffer_len, char *out_buffer);
 ggf_asset_handle_t ggf_asset_get_handle(const char *name);
+// returns NULL if the asset is not loaded or the handle is stale
 void *ggf_asset_get_data(ggf_asset_handle_t handle);
 
 // GRAPHICS layer
@@ -660,6 +1035,21 @@ typedef struct {
   ggf_texture_format_t format;
 } ggf_texture_t;
 
+// same sized textures stored as the layers of one GL_TEXTURE_2D_ARRAY
+typedef struct {
+  u32 id;
+  u32 width, height, layer_count;
+  ggf_texture_format_t format;
+} ggf_texture_array_t;
+
+// offscreen framebuffer whose color attachment is sampled as a texture
+typedef struct {
+  u32 framebuffer;
+  u32 width, height;
+  ggf_texture_t color;
+  u32 depth_renderbuffer; // 0 without depth
+} ggf_render_target_t;
+
 typedef struct {
   u32 id;
   u32 index;
@@ -680,7 +1070,13 @@ typedef struct {
   ggf_hash_map_t glyphs;
 } ggf_font_t;
 
-// TODO: render targets
+typedef enum {
+  GGF_GFX_BLEND_MODE_OPAQUE,
+  GGF_GFX_BLEND_MODE_ALPHA,
+  GGF_GFX_BLEND_MODE_ADDITIVE,
+  GGF_GFX_BLEND_MODE_MAX
+} ggf_gfx_blend_mode_t;
+
 // TODO: custom shaders
 // TODO: Improve FONTS API - make glyphs dynamic array instead of hash map
 
@@ -695,39 +1091,271 @@ void ggf_gfx_set_clear_color(vec3 color);
 
 // begin new frame. clears the screen.
 void ggf_gfx_begin_frame();
-// flush frame
+// flush frame. recorded draw calls are sorted by layer, blend mode, shader,
+// texture and depth (back to front), then merged into as few draws as
+// possible. draw calls with equal state keep their submission order. see
+// ggf_gfx_set_blend_mode for what this means for translucent draws.
 void ggf_gfx_flush();
 
+// set the layer of the following draw calls. higher layers are drawn on top
+// of lower ones whatever their depth, default is 0
+void ggf_gfx_set_layer(u8 layer);
+// set the blend mode of the following draw calls, default is alpha
+/*
+    draw calls are only back to front within one shader and texture: the sort
+   key puts them above depth, so that alpha blended draws still batch. the
+   depth test hides what is behind opaque pixels, but translucent draws that
+   overlap and differ in shader or texture blend in shader and texture order,
+   not by depth. give such draws different layers to order them.
+*/
+void ggf_gfx_set_blend_mode(ggf_gfx_blend_mode_t mode);
+// set how many draw calls may be recorded before a flush is forced, default is
+// 65536. batch storage grows as needed up to this limit.
+void ggf_gfx_set_max_commands(u32 max_commands);
+// skip draw calls that lie completely outside the view of the camera they are
+// drawn with, default is on. the test runs at flush on their bounding boxes,
+// static batches are always drawn.
+void ggf_gfx_set_culling_enabled(b32 enabled);
+
+// draw recording on other threads
+/*
+    between ggf_gfx_recorder_begin and ggf_gfx_recorder_end the
+   ggf_gfx_draw_* calls of the calling thread, and its ggf_gfx_set_layer and
+   ggf_gfx_set_blend_mode, go to a recorder instead of the main thread's draw
+   calls. they make no GL calls. the main thread then submits recorders, their
+   draw calls are merged as if they were recorded at that point, in the order
+   of submission. the output doesn't depend on which thread finished first.
+    a recorder has its own layer and blend mode, which start at 0 and alpha.
+   it is used by one thread at a time.
+*/
+typedef struct ggf_gfx_recorder_t ggf_gfx_recorder_t;
+
+ggf_gfx_recorder_t *ggf_gfx_recorder_create();
+void ggf_gfx_recorder_destroy(ggf_gfx_recorder_t *recorder);
+void ggf_gfx_recorder_begin(ggf_gfx_recorder_t *recorder);
+void ggf_gfx_recorder_end();
+// main thread only. empties the recorder, it can be reused right away. like
+// draw calls it flushes once max_commands are unflushed, so a recorder holding
+// more is split over several flushes.
+void ggf_gfx_submit_recorder(ggf_gfx_recorder_t *recorder);
+
+// render thread
+/*
+    moves GL work off the main thread. ggf_gfx keeps the same API, but
+   ggf_gfx_begin_frame, ggf_gfx_flush, ggf_gfx_set_camera, render targets and
+   GPU timer scopes are recorded into the current frame, and
+   ggf_window_swap_buffers hands the frame to a render thread that executes it
+   and presents while the main thread records the next one. swap_buffers only
+   waits when every frame is still in flight, so a vsync wait stalls the main
+   thread frame_count - 1 frames later than it would have.
+    the render thread owns the window's context: while it runs, the main
+   thread makes no GL calls of its own. create, fill and destroy textures,
+   texture arrays, fonts, atlases, render targets, shaders and uniform
+   buffers, and turn GPU timers on or off, with the render thread stopped;
+   those functions assert it. assets still load while it runs, the loader
+   only decodes into memory. stats and GPU pass times arrive frame_count - 1
+   frames late.
+*/
+typedef struct {
+  u32 frame_count; // 2 double buffered, 3 triple buffered
+  u64 frames;      // presented since the render thread started
+  // smoothed over recent frames
+  f32 latency_ms; // from the main thread starting a frame to its present
+  f32 frame_ms;   // between presents, 1000 / frame_ms frames per second
+  f32 record_ms;  // main thread recording a frame
+  f32 wait_ms;    // main thread waiting for a free frame
+  f32 render_ms;  // render thread executing and presenting a frame
+} ggf_gfx_render_thread_report_t;
+
+// start rendering on a thread of its own, with frame_count (2 or 3) frames in
+// flight. call it between frames, from the thread whose context is current.
+// returns TRUE if successful.
+b32 ggf_gfx_start_render_thread(ggf_window_t *window, u32 frame_count);
+// executes the frames in flight and gives the context back to the calling
+// thread. a frame recorded but not submitted is drawn, not presented.
+void ggf_gfx_stop_render_thread();
+b32 ggf_gfx_is_render_thread_running();
+// all zero while the render thread is stopped
+void ggf_gfx_get_render_thread_report(ggf_gfx_render_thread_report_t *out);
+
+// static batches
+/*
+    sprites recorded once and kept on the GPU, for geometry that rarely
+   changes. between ggf_gfx_static_batch_begin and ggf_gfx_static_batch_end
+   the sprites the calling thread draws (ggf_gfx_draw_sprite and the
+   functions built on it) are retained by the batch instead of drawn, the
+   n-th one becomes sprite n of the batch. ggf_gfx_draw_static_batch then
+   draws all of them with a single draw call and no work per sprite, in the
+   layer and blend mode set at that point, in the order they were recorded
+   and before the other sprites of the layer.
+    hiding or updating sprites uploads only the changed range, when the
+   batch is next drawn. a batch drawn more than once before a flush shows its
+   latest state in each draw. batches may be used while a render thread runs.
+*/
+typedef struct ggf_gfx_static_batch_t ggf_gfx_static_batch_t;
+
+ggf_gfx_static_batch_t *ggf_gfx_static_batch_create();
+// main thread only. flushes, the recorded draw calls may draw the batch.
+void ggf_gfx_static_batch_destroy(ggf_gfx_static_batch_t *batch);
+// the sprites recorded until ggf_gfx_static_batch_end replace the batch's
+void ggf_gfx_static_batch_begin(ggf_gfx_static_batch_t *batch);
+// returns FALSE and leaves the batch empty if anything but sprites was
+// recorded, or if the sprites use more than 15 textures
+b32 ggf_gfx_static_batch_end(ggf_gfx_static_batch_t *batch);
+u32 ggf_gfx_static_batch_get_count(ggf_gfx_static_batch_t *batch);
+// show or hide count sprites starting at first, all visible after end
+void ggf_gfx_static_batch_set_visible(ggf_gfx_static_batch_t *batch, u32 first,
+                                      u32 count, b32 visible);
+// replace a sprite, it keeps its texture and visibility
+void ggf_gfx_static_batch_update(ggf_gfx_static_batch_t *batch, u32 index,
+                                 vec2 pos, vec2 size, f32 rotation, f32 depth,
+                                 vec4 color, vec4 uv_rect);
+// main thread only
+void ggf_gfx_draw_static_batch(ggf_gfx_static_batch_t *batch);
+
 // use a custom shader
 void ggf_gfx_set_shader(ggf_shader_t *shader);
 
 // set camera
 void ggf_gfx_set_camera(ggf_camera_t *camera);
 
+// GPU time of a pass, read back a few frames late so that it never stalls
+typedef struct {
+  const char *name;
+  f32 ms;          // in the latest frame read back
+  f32 smoothed_ms; // moving average over recent frames
+} ggf_gfx_gpu_pass_t;
+
+// turn GPU timing on or off, default is off. every pipeline ("basic",
+// "static sprite", "sprite", "sprite array", "shape", "text") is a pass, and
+// frames are delimited by ggf_gfx_begin_frame.
+void ggf_gfx_set_gpu_timers_enabled(b32 enabled);
+// time the GPU work between begin and end as the pass name. both flush, so
+// the draw calls recorded in between are what gets timed. scopes may nest.
+void ggf_gfx_gpu_timer_begin(const char *name);
+void ggf_gfx_gpu_timer_end();
+// copy up to max_count passes, returns how many were copied
+u32 ggf_gfx_get_gpu_passes(ggf_gfx_gpu_pass_t *out_passes, u32 max_count);
+
+// why recorded draw calls were flushed
+typedef enum {
+  GGF_GFX_FLUSH_REASON_EXPLICIT = 0,     // ggf_gfx_flush
+  GGF_GFX_FLUSH_REASON_END_OF_FRAME,     // draw calls left when a frame ended
+  GGF_GFX_FLUSH_REASON_COMMAND_CAPACITY, // see ggf_gfx_set_max_commands
+  GGF_GFX_FLUSH_REASON_RENDER_TARGET,    // a render target began or ended
+  GGF_GFX_FLUSH_REASON_GPU_TIMER,        // a GPU timer scope began or ended
+  GGF_GFX_FLUSH_REASON_STATIC_BATCH,     // a static batch was destroyed
+  GGF_GFX_FLUSH_REASON_MAX
+} ggf_gfx_flush_reason_t;
+
+// why a flush started another batch (draw call) instead of extending one
+typedef enum {
+  GGF_GFX_BATCH_BREAK_LAYER = 0,
+  GGF_GFX_BATCH_BREAK_BLEND_MODE,
+  GGF_GFX_BATCH_BREAK_PIPELINE,
+  GGF_GFX_BATCH_BREAK_TEXTURE_UNITS, // more textures than GPU texture units
+  GGF_GFX_BATCH_BREAK_TEXTURE_ARRAY, // sprites of another texture array
+  GGF_GFX_BATCH_BREAK_STATIC_BATCH,  // every static batch is a draw of its own
+  GGF_GFX_BATCH_BREAK_MAX
+} ggf_gfx_batch_break_t;
+
+typedef struct {
+  u32 commands; // draw calls recorded through the ggf_gfx_draw_* functions
+  u32 culled;   // of those, outside the camera's view and never drawn
+  u32 draw_calls;
+  u32 vertices;
+  u32 indices;
+  u32 instances;
+  u64 bytes_uploaded;
+  u32 texture_binds;
+  u32 program_switches;
+  u32 gl_calls_saved; // redundant state changes skipped by the state cache
+  u32 flushes;
+  u32 flush_reasons[GGF_GFX_FLUSH_REASON_MAX];
+  u32 batch_breaks[GGF_GFX_BATCH_BREAK_MAX];
+} ggf_gfx_stats_t;
+
+// stats of the last complete frame, counted from one ggf_gfx_begin_frame to
+// the next
+void ggf_gfx_get_stats(ggf_gfx_stats_t *out_stats);
+
+// ggf_gfx skips GL calls that would not change the state it last set. call
+// this after changing bindings, blending or depth testing with GL directly.
+void ggf_gfx_reset_state_cache();
+
+// flush the draw calls recorded so far and send the following ones to target
+// until ggf_gfx_end_render_target, clearing it first if clear is TRUE. the
+// camera is not changed, set one that fits the target after this call.
+// targets do not nest.
+void ggf_gfx_begin_render_target(ggf_render_target_t *target, b32 clear);
+// flush the draw calls recorded for the render target and go back to the
+// window
+void ggf_gfx_end_render_target();
+
 // draw a triangle
 void ggf_gfx_draw_triangle(vec2 p1, vec2 p2, vec2 p3, f32 depth, vec4 color,
                            ggf_texture_t *texture);
 // draw a quad
 void ggf_gfx_draw_quad(vec2 tl, vec2 tr, vec2 br, vec2 bl, f32 depth,
                        vec4 color, ggf_texture_t *texture);
+// draw a sprite with its top left corner at pos, rotated by rotation radians
+// around its center. uv_rect is (min u, min v, max u, max v). sprites are
+// drawn instanced, one small record each, and should be preferred over
+// ggf_gfx_draw_quad when the quad is a rectangle.
+void ggf_gfx_draw_sprite(vec2 pos, vec2 size, f32 rotation, f32 depth,
+                         vec4 color, vec4 uv_rect, ggf_texture_t *texture);
+// draw a sprite from one layer of a texture array. all sprites of an array
+// share a batch and are sampled with a single texture fetch, which is cheaper
+// per pixel than the texture unit switch of the other pipelines.
+void ggf_gfx_draw_sprite_layer(vec2 pos, vec2 size, f32 rotation, f32 depth,
+                               vec4 color, vec4 uv_rect,
+                               ggf_texture_array_t *array, u32 layer);
+// draw an axis aligned quad, as a sprite
 void ggf_draw_quad_extent(vec2 pos, vec2 size, f32 depth, vec4 color,
                           ggf_texture_t *texture);
 void ggf_gfx_draw_quad_corners(vec2 tl, vec2 br, f32 depth, vec4 color,
                                ggf_texture_t *texture) {
-  ggf_gfx_draw_quad(tl, (vec2){br[0], tl[1]}, br, (vec2){tl[0], br[1]}, depth,
-                    color, texture);
+  ggf_draw_quad_extent(tl, (vec2){br[0] - tl[0], br[1] - tl[1]}, depth, color,
+                       texture);
 }
-
-// draw a line
+// draw count axis aligned quads, element i from positions[i], sizes[i],
+// depths[i] and colors[i]. depths may be NULL for 0. the same as count
+// ggf_draw_quad_extent calls, but recorded in one go: the texture is looked up
+// once and colors and sort keys are generated four at a time.
+void ggf_gfx_draw_quads(u32 count, vec2 *positions, vec2 *sizes, f32 *depths,
+                        vec4 *colors, ggf_texture_t *texture);
+// draw count sprites like ggf_gfx_draw_quads, rotated by rotations[i] radians
+// around their centers. rotations may be NULL for 0.
+void ggf_gfx_draw_sprites(u32 count, vec2 *positions, vec2 *sizes,
+                          f32 *rotations, f32 *depths, vec4 *colors,
+                          vec4 uv_rect, ggf_texture_t *texture);
+
+// draw a line with round caps, width from the center line to either side
 void ggf_gfx_draw_line(vec2 p1, vec2 p2, f32 depth, f32 width, vec4 color,
                        ggf_texture_t *texture);
-// draw a point
+// draw a point as a circle of radius size
 void ggf_gfx_draw_point(vec2 point, f32 depth, f32 size, vec4 color,
                         ggf_texture_t *texture);
 // draw a circle
 void ggf_gfx_draw_circle(vec2 center, f32 depth, f32 radius, vec4 color,
                          ggf_texture_t *texture);
-// draw text. no depth (always on top)
+// draw a circle outline of the given thickness, inside radius
+void ggf_gfx_draw_ring(vec2 center, f32 depth, f32 radius, f32 thickness,
+                       vec4 color, ggf_texture_t *texture);
+// draw a rectangle with rounded corners, top left corner at pos, rotated by
+// rotation radians around its center
+void ggf_gfx_draw_rounded_rect(vec2 pos, vec2 size, f32 corner_radius,
+                               f32 rotation, f32 depth, vec4 color,
+                               ggf_texture_t *texture);
+// draw the outline of a (rounded) rectangle, thickness inside its edge
+void ggf_gfx_draw_rect_outline(vec2 pos, vec2 size, f32 corner_radius,
+                               f32 thickness, f32 depth, vec4 color,
+                               ggf_texture_t *texture);
+// draw a capsule around the segment p1 p2. a thickness of 0 fills it,
+// otherwise only an outline of that thickness is drawn.
+void ggf_gfx_draw_capsule(vec2 p1, vec2 p2, f32 depth, f32 radius,
+                          f32 thickness, vec4 color, ggf_texture_t *texture);
+// draw text. no depth (on top of everything else in its layer)
 void ggf_gfx_draw_text(char *text, vec2 pos, u32 size, vec4 color,
                        ggf_font_t *font);
 
@@ -749,6 +1377,27 @@ void ggf_texture_destroy(ggf_texture_t *texture);
 // set texture data. returns TRUE if the operation was successful.
 b32 ggf_texture_set_data(ggf_texture_t *texture, void *data,
                          ggf_texture_format_t format);
+// create a texture array. data holds every layer one after another, or is
+// NULL. returns TRUE if creation was successful.
+b32 ggf_texture_array_create(void *data, ggf_texture_format_t format,
+                             u32 width, u32 height, u32 layer_count,
+                             ggf_texture_filter_t filter,
+                             ggf_texture_wrap_t wrap,
+                             ggf_texture_array_t *out_array);
+// destroy a texture array
+void ggf_texture_array_destroy(ggf_texture_array_t *array);
+// set the data of one layer. returns TRUE if the operation was successful.
+b32 ggf_texture_array_set_layer(ggf_texture_array_t *array, u32 layer,
+                                void *data, ggf_texture_format_t format);
+
+// create a render target with a color texture of the given format and,
+// optionally, a depth buffer. returns TRUE if creation was successful.
+b32 ggf_render_target_create(u32 width, u32 height,
+                             ggf_texture_format_t format,
+                             ggf_texture_filter_t filter, b32 with_depth,
+                             ggf_render_target_t *out_target);
+// destroy a render target and its texture
+void ggf_render_target_destroy(ggf_render_target_t *target);
 
 b32 ggf_uniform_buffer_create(u64 size, void *data,
                               ggf_uniform_buffer_t *out_buffer);
@@ -760,3 +1409,59 @@ b32 ggf_font_load(const char *sdf_filename, const char *csv_filename,
                   ggf_font_t *out_font);
 void ggf_font_destroy(ggf_font_t *font);
 f32 ggf_font_get_text_width(ggf_font_t *font, char *text, u32 size);
+
+// texture atlas
+/*
+    packs small RGBA8 images into shared textures (pages) so that sprites
+   using them batch together. a page is split into shelves that are filled
+   left to right. removing a region frees its span in the shelf for later adds
+   of the same height or less, and empty shelves at the bottom of a page are
+   given back. pages are created as needed, or, for an atlas created with
+   use_texture_array, are the layers of one texture array that is allocated
+   for GGF_ATLAS_MAX_PAGES pages up front. its regions then draw through the
+   sprite array pipeline and share a batch across pages.
+*/
+#define GGF_ATLAS_MAX_PAGES 8
+#define GGF_ATLAS_MAX_REGIONS 4096
+// pixels around each region, filled with its edge to avoid bleeding
+#define GGF_ATLAS_PADDING 1
+
+typedef struct {
+  u32 page, shelf;
+  u32 x, y, width, height; // pixels, padding excluded
+  vec4 uv_rect;            // min u, min v, max u, max v
+} ggf_atlas_region_t;
+
+typedef struct {
+  u32 page_width, page_height;
+  ggf_texture_filter_t filter;
+  u32 page_count;
+  b32 use_texture_array;
+  ggf_texture_t pages[GGF_ATLAS_MAX_PAGES]; // unused with a texture array
+  ggf_texture_array_t page_array;
+  void *shelves[GGF_ATLAS_MAX_PAGES]; // darray per page
+  ggf_handle_pool_t regions;
+} ggf_atlas_t;
+
+// create an atlas with pages of the given size. returns TRUE if successful.
+b32 ggf_atlas_create(u32 page_width, u32 page_height,
+                     ggf_texture_filter_t filter, b32 use_texture_array,
+                     ggf_atlas_t *out_atlas);
+void ggf_atlas_destroy(ggf_atlas_t *atlas);
+// copy width * height RGBA8 pixels into the atlas. returns GGF_INVALID_ID if
+// they do not fit.
+ggf_handle_t ggf_atlas_add(ggf_atlas_t *atlas, void *pixels, u32 width,
+                           u32 height);
+// load an image from the textures asset folder into the atlas. returns
+// GGF_INVALID_ID on failure.
+ggf_handle_t ggf_atlas_add_image(ggf_atlas_t *atlas, const char *filename);
+// evict a region. returns FALSE if the handle is stale.
+b32 ggf_atlas_remove(ggf_atlas_t *atlas, ggf_handle_t region);
+// returns the region of a handle, or NULL if the handle is stale
+static inline ggf_atlas_region_t *ggf_atlas_get_region(ggf_atlas_t *atlas,
+                                                       ggf_handle_t region) {
+  return (ggf_atlas_region_t *)ggf_handle_pool_get(&atlas->regions, region);
+}
+// draw an atlas region as a sprite. does nothing if the handle is stale.
+void ggf_gfx_draw_atlas_region(vec2 pos, vec2 size, f32 depth, vec4 color,
+                               ggf_atlas_t *atlas, ggf_handle_t region);
@@ -1,11 +1,6 @@
 #include "ggf.c"
 #include "particle_system.c"
 
-enum {
-  BRICK_EMPTY = 0,
-  BRICK_NORMAL,
-};
-
 typedef struct game_state_t game_state_t;
 
 typedef game_state_t (*game_state_update_func_t)(game_state_t state);
@@ -23,17 +18,24 @@ typedef struct {
   f32 spacing;
   vec2 area;
   u32 cols, rows;
-  u8 *bricks;
+  ggf_bitset_t bricks; // set bits are live bricks
+  // every brick, dead ones hidden, so that drawing them costs nothing per
+  // brick
+  ggf_gfx_static_batch_t *batch;
 } bricks_t;
 
 #define MAX_BALLS 2048
 
+#define BALL_FIELDS(X)                                                         \
+  X(vec2, positions)                                                           \
+  X(vec2, directions)
+
+GGF_SOA_DECLARE(ball_soa, BALL_FIELDS)
+
 typedef struct {
   vec2 size;
   f32 speed;
-  u32 count;
-  vec2 positions[MAX_BALLS];
-  vec2 directions[MAX_BALLS];
+  ball_soa_t soa;
 } balls_t;
 
 typedef struct {
@@ -101,6 +103,15 @@ typedef struct {
 
 global_variable global_state_t global_state;
 
+internal_func void get_brick_color(bricks_t *bricks, u32 col, vec4 out_color) {
+  f32 p = col / (f32)bricks->cols;
+  f32 r = 0.0f;
+  f32 g = 0.0f;
+  f32 b = sinf(p * GGF_PI) * 0.5f + 0.5f;
+  vec4 result = {r, g, b, 1.0f};
+  glm_vec4_copy(result, out_color);
+}
+
 internal_func bricks_t create_bricks(u32 cols, u32 rows, vec2 area, f32 spacing,
                                      vec2 pos) {
   bricks_t result = {};
@@ -114,57 +125,60 @@ internal_func bricks_t create_bricks(u32 cols, u32 rows, vec2 area, f32 spacing,
 
   result.cols = cols;
   result.rows = rows;
-  result.bricks =
-      ggf_memory_alloc(sizeof(u8) * cols * rows, GGF_MEMORY_TAG_GAME);
-  for (u32 i = 0; i < cols * rows; i++) {
-    result.bricks[i] = BRICK_NORMAL;
+  u64 memory_requirement;
+  ggf_bitset_create(cols * rows, &memory_requirement, NULL, &result.bricks);
+  ggf_bitset_create(cols * rows, &memory_requirement,
+                    ggf_memory_alloc(memory_requirement, GGF_MEMORY_TAG_GAME),
+                    &result.bricks);
+  ggf_bitset_set_all(&result.bricks);
+
+  // sprite idx of the batch is brick idx
+  u32 count = cols * rows;
+  ggf_linear_allocator_t *frame_allocator = ggf_get_frame_allocator();
+  u64 marker = frame_allocator->marker;
+  vec2 *positions = ggf_linear_allocator_alloc_aligned(
+      frame_allocator, sizeof(vec2) * count, 16);
+  vec2 *sizes = ggf_linear_allocator_alloc_aligned(frame_allocator,
+                                                   sizeof(vec2) * count, 16);
+  vec4 *colors = ggf_linear_allocator_alloc_aligned(frame_allocator,
+                                                    sizeof(vec4) * count, 16);
+  for (u32 idx = 0; idx < count; idx++) {
+    u32 row = idx / cols;
+    u32 col = idx % cols;
+    positions[idx][0] = col * (result.size[0] + spacing) + pos[0];
+    positions[idx][1] = row * (result.size[1] + spacing) + pos[1];
+    glm_vec2_copy(result.size, sizes[idx]);
+    get_brick_color(&result, col, colors[idx]);
   }
+  result.batch = ggf_gfx_static_batch_create();
+  ggf_gfx_static_batch_begin(result.batch);
+  ggf_gfx_draw_quads(count, positions, sizes, NULL, colors, NULL);
+  ggf_gfx_static_batch_end(result.batch);
+  ggf_linear_allocator_free_to_marker(frame_allocator, marker);
 
   return result;
 }
 
 internal_func void destroy_bricks(bricks_t *bricks) {
-  ggf_memory_free(bricks->bricks);
-}
-
-internal_func void get_brick_color(bricks_t *bricks, u32 col, vec4 out_color) {
-  f32 p = col / (f32)bricks->cols;
-  f32 r = 0.0f;
-  f32 g = 0.0f;
-  f32 b = sinf(p * GGF_PI) * 0.5f + 0.5f;
-  vec4 result = {r, g, b, 1.0f};
-  glm_vec4_copy(result, out_color);
+  ggf_gfx_static_batch_destroy(bricks->batch);
+  ggf_memory_free(bricks->bricks.words);
 }
 
 internal_func void draw_bricks(bricks_t *bricks) {
-  for (u32 row = 0; row < bricks->rows; row++) {
-    for (u32 col = 0; col < bricks->cols; col++) {
-      u8 brick_value = bricks->bricks[row * bricks->cols + col];
-
-      if (brick_value != BRICK_EMPTY) {
-        vec2 pos = {col * (bricks->size[0] + bricks->spacing) + bricks->pos[0],
-                    row * (bricks->size[1] + bricks->spacing) + bricks->pos[1]};
-        vec4 color;
-        get_brick_color(bricks, col, color);
-        ggf_draw_quad_extent(pos, bricks->size, 0.0f, color, NULL);
-      }
-    }
-  }
+  ggf_gfx_draw_static_batch(bricks->batch);
 }
 
 internal_func void add_ball(balls_t *balls, vec2 pos, vec2 dir) {
-  if (balls->count >= MAX_BALLS) {
+  u32 idx;
+  if (!ball_soa_append(&balls->soa, 1, &idx)) {
     return;
   }
-  glm_vec2_copy(pos, balls->positions[balls->count]);
-  glm_vec2_copy(dir, balls->directions[balls->count]);
-  balls->count++;
+  glm_vec2_copy(pos, balls->soa.positions[idx]);
+  glm_vec2_copy(dir, balls->soa.directions[idx]);
 }
 
 internal_func void remove_ball(balls_t *balls, u32 idx) {
-  balls->count--;
-  glm_vec2_copy(balls->positions[balls->count], balls->positions[idx]);
-  glm_vec2_copy(balls->directions[balls->count], balls->directions[idx]);
+  ball_soa_remove_swap(&balls->soa, idx);
 }
 
 internal_func b32 aabb_test(vec2 p1, vec2 s1, vec2 p2, vec2 s2) {
@@ -201,9 +215,10 @@ internal_func void destroy_brick(playing_state_t *state, u32 idx, u32 col,
   get_brick_color(&state->bricks, col, particle_color);
   glm_vec4_copy(particle_color, p_system->begin_color);
   glm_vec4_copy(particle_color, p_system->end_color);
-  p_system->count = 0;
+  particle_soa_clear(&p_system->particles);
 
-  bricks->bricks[idx] = BRICK_EMPTY;
+  ggf_bitset_clear(&bricks->bricks, idx);
+  ggf_gfx_static_batch_set_visible(bricks->batch, idx, 1, FALSE);
   for (f32 x = 0.0f; x < bricks->size[0]; x += 3.0f) {
     vec2 location = {
         brick_pos[0] + x,
@@ -284,10 +299,16 @@ internal_func game_state_t create_playing_state() {
   glm_vec2_copy((vec2){1280.0f / 2.0f - p->size[0] / 2.0f, 650.0f}, p->pos);
   p->speed = 10.0f;
 
-  state->bricks =
-      create_bricks(100, 66, (vec2){1100.0f, 400.0f}, 1.0f, (vec2){0.0f, 0.0f});
+  state->bricks = create_bricks(100, 66, (vec2){1100.0f, 400.0f}, 1.0f,
+                                (vec2){(1280.0f - 1100.0f) / 2.0f, 50.0f});
 
   f32 ball_size = 7.5f;
+  if (!ball_soa_create(MAX_BALLS, GGF_MEMORY_TAG_GAME, &state->balls.soa)) {
+    GGF_ERROR("ERROR - create_playing_state: could not allocate the balls.");
+    destroy_bricks(&state->bricks);
+    ggf_memory_free(state);
+    return (game_state_t){0};
+  }
   glm_vec2_copy((vec2){ball_size, ball_size}, state->balls.size);
   state->balls.speed = 5.0f;
   add_ball(&state->balls,
@@ -298,9 +319,16 @@ internal_func game_state_t create_playing_state() {
 
   for (u32 i = 0; i < MAX_SINGLE_USE_PARTICLES; i++) {
     // FIXME: this failes when count is a power of two
-    create_particle_system(100, (vec4){0.0f, 0.0f, 0.0f, 0.0f},
-                           (vec4){0.0f, 0.0f, 0.0f, 0.0f}, 1.5f,
-                           &state->single_use_particles[i]);
+    if (!create_particle_system(100, (vec4){0.0f, 0.0f, 0.0f, 0.0f},
+                                (vec4){0.0f, 0.0f, 0.0f, 0.0f}, 1.5f,
+                                &state->single_use_particles[i])) {
+      while (i--)
+        destroy_particle_system(&state->single_use_particles[i]);
+      ball_soa_destroy(&state->balls.soa);
+      destroy_bricks(&state->bricks);
+      ggf_memory_free(state);
+      return (game_state_t){0};
+    }
   }
 
   powerup_infos[POWERUP_THREE_BALLS].chance = 0.2f;
@@ -316,6 +344,7 @@ internal_func game_state_t create_playing_state() {
 internal_func void destroy_playing_state(game_state_t game_state) {
   playing_state_t *state = game_state.data;
   destroy_bricks(&state->bricks);
+  ball_soa_destroy(&state->balls.soa);
   for (u32 i = 0; i < MAX_SINGLE_USE_PARTICLES; i++) {
     destroy_particle_system(&state->single_use_particles[i]);
   }
@@ -323,6 +352,7 @@ internal_func void destroy_playing_state(game_state_t game_state) {
 }
 
 internal_func game_state_t update_playing_state(game_state_t game_state) {
+  GGF_PROFILE_SCOPE("update_playing_state");
   playing_state_t *state = game_state.data;
   player_t *p = &state->player;
   balls_t *balls = &state->balls;
@@ -338,17 +368,15 @@ internal_func game_state_t update_playing_state(game_state_t game_state) {
     p->pos[1] += 5.0f;
   }
 
-  for (i32 i = balls->count - 1; i >= 0; i--) {
+  for (i32 i = balls->soa.count - 1; i >= 0; i--) {
     vec2 pos, dir, size;
-    glm_vec2_copy(balls->positions[i], pos);
-    glm_vec2_copy(balls->directions[i], dir);
+    glm_vec2_copy(balls->soa.positions[i], pos);
+    glm_vec2_copy(balls->soa.directions[i], dir);
     glm_vec2_copy(balls->size, size);
 
     vec2 vel;
     glm_vec2_scale(dir, balls->speed, vel);
 
-    b32 paddle_collision = aabb_test(pos, balls->size, p->pos, p->size);
-
     pos[0] += vel[0];
     b32 x_collision = FALSE;
     if (dir[0] < 0.0f) {
@@ -371,7 +399,7 @@ internal_func game_state_t update_playing_state(game_state_t game_state) {
     for (u32 i = 0; i < GGF_ARRAY_COUNT(x_col_points); i++) {
       if (check_point_in_bricks(&state->bricks, x_col_points[i], &col, &row)) {
         u32 idx = row * state->bricks.cols + col;
-        if (state->bricks.bricks[idx] != BRICK_EMPTY) {
+        if (ggf_bitset_test(&state->bricks.bricks, idx)) {
           x_collision = TRUE;
           destroy_brick(state, idx, col, row);
         }
@@ -414,7 +442,7 @@ internal_func game_state_t update_playing_state(game_state_t game_state) {
     for (u32 i = 0; i < GGF_ARRAY_COUNT(y_col_points); i++) {
       if (check_point_in_bricks(&state->bricks, y_col_points[i], &col, &row)) {
         u32 idx = row * state->bricks.cols + col;
-        if (state->bricks.bricks[idx] != BRICK_EMPTY) {
+        if (ggf_bitset_test(&state->bricks.bricks, idx)) {
           y_collision = TRUE;
           destroy_brick(state, idx, col, row);
         }
@@ -425,8 +453,8 @@ internal_func game_state_t update_playing_state(game_state_t game_state) {
       pos[1] -= vel[1];
     }
 
-    glm_vec2_copy(pos, balls->positions[i]);
-    glm_vec2_copy(dir, balls->directions[i]);
+    glm_vec2_copy(pos, balls->soa.positions[i]);
+    glm_vec2_copy(dir, balls->soa.directions[i]);
   }
 
   for (i32 i = state->powerup_count - 1; i >= 0; --i) {
@@ -442,10 +470,10 @@ internal_func game_state_t update_playing_state(game_state_t game_state) {
         add_ball(balls, spawn_pos, (vec2){0.85f, -0.525f});
         add_ball(balls, spawn_pos, (vec2){-0.85f, -0.525f});
       } else if (powerup->type == POWERUP_DOUBLE_BALLS) {
-        for (i32 i = balls->count - 1; i >= 0; --i) {
+        for (i32 i = balls->soa.count - 1; i >= 0; --i) {
           vec2 dir;
-          glm_vec2_scale(balls->directions[i], -1.0f, dir);
-          add_ball(balls, balls->positions[i], dir);
+          glm_vec2_scale(balls->soa.directions[i], -1.0f, dir);
+          add_ball(balls, balls->soa.positions[i], dir);
         }
       }
       state->powerups[i] = state->powerups[--state->powerup_count];
@@ -458,7 +486,7 @@ internal_func game_state_t update_playing_state(game_state_t game_state) {
   for (i32 i = state->single_use_particles_count - 1; i >= 0; --i) {
     particle_system_t *system = state->single_use_particles + i;
     update_particle_system(system);
-    if (system->count == 0) {
+    if (system->particles.count == 0) {
       particle_system_t temp = state->single_use_particles[i];
       state->single_use_particles[i] =
           state->single_use_particles[state->single_use_particles_count - 1];
@@ -471,14 +499,12 @@ internal_func game_state_t update_playing_state(game_state_t game_state) {
 
   ggf_draw_quad_extent(p->pos, p->size, 0.0f, (vec4){0.2f, 0.2f, 1.0f, 1.0f},
                        NULL);
-  glm_vec2_copy((vec2){(1280.0f - state->bricks.area[0]) / 2.0f, 50.0f},
-                state->bricks.pos);
   draw_bricks(&state->bricks);
 
   vec4 ball_color = {0.2f, 1.0f, 0.2f, 1.0f};
-  for (u32 i = 0; i < balls->count; i++) {
-    ggf_draw_quad_extent(balls->positions[i], balls->size, -1.0f, ball_color,
-                         NULL);
+  for (u32 i = 0; i < balls->soa.count; i++) {
+    ggf_draw_quad_extent(balls->soa.positions[i], balls->size, -1.0f,
+                         ball_color, NULL);
   }
 
   for (u32 i = 0; i < state->single_use_particles_count; i++) {
@@ -501,14 +527,12 @@ internal_func game_state_t update_playing_state(game_state_t game_state) {
                         powerup_color, &powerup_infos[POWERUP_THREE_BALLS].texture);
   }
 
-  if (balls->count == 0 && !state->lose_transition.active) {
-    for (u32 row = 0; row < state->bricks.rows; row++) {
-      for (u32 col = 0; col < state->bricks.cols; col++) {
-        u32 idx = row * state->bricks.rows + col;
-        if (state->bricks.bricks[idx] != BRICK_EMPTY) {
-          destroy_brick(state, idx, col, row);
-        }
-      }
+  if (balls->soa.count == 0 && !state->lose_transition.active) {
+    ggf_bitset_t *bricks = &state->bricks.bricks;
+    for (u32 idx = ggf_bitset_find_next_set(bricks, 0); idx != GGF_INVALID_ID;
+         idx = ggf_bitset_find_next_set(bricks, idx + 1)) {
+      destroy_brick(state, idx, idx % state->bricks.cols,
+                    idx / state->bricks.cols);
     }
     state->lose_transition.active = TRUE;
     state->lose_transition.time_active = 0.0f;
@@ -517,16 +541,12 @@ internal_func game_state_t update_playing_state(game_state_t game_state) {
   }
 
   update_transition(&state->lose_transition, &game_state);
+  // the transition may have destroyed this state
+  if (game_state.data != state)
+    return game_state;
 
   if (!state->lose_transition.active) {
-    b32 are_bricks_left = FALSE;
-    for (u32 i = 0; i < state->bricks.cols * state->bricks.rows; i++) {
-      if (state->bricks.bricks[i] != BRICK_EMPTY) {
-        are_bricks_left = TRUE;
-        break;
-      }
-    }
-    if (!are_bricks_left) {
+    if (!ggf_bitset_any(&state->bricks.bricks)) {
       game_state.destroy_func(game_state);
       game_state = create_victory_state();
     }
@@ -552,6 +572,7 @@ internal_func game_state_t create_game_over_state() {
 }
 
 internal_func game_state_t update_game_over_state(game_state_t game_state) {
+  GGF_PROFILE_SCOPE("update_game_over_state");
   game_over_state_t *state = game_state.data;
 
   state->time += 1.0f / 60.0f;
@@ -602,9 +623,12 @@ internal_func game_state_t create_victory_state() {
 
   ggf_gfx_set_clear_color((vec3){0.0f, 0.05f, 0.0f});
 
-  create_particle_system(2048, (vec4){1.0f, 0.95f, 0.0f, 1.0f},
-                         (vec4){0.1f, 1.0f, 0.1f, 1.0f}, 1.0f,
-                         &state->p_system);
+  if (!create_particle_system(2048, (vec4){1.0f, 0.95f, 0.0f, 1.0f},
+                              (vec4){0.1f, 1.0f, 0.1f, 1.0f}, 1.0f,
+                              &state->p_system)) {
+    ggf_memory_free(state);
+    return (game_state_t){0};
+  }
 
   game_state_t result;
   result.update_func = &update_victory_state;
@@ -620,6 +644,7 @@ internal_func void destroy_victory_state(game_state_t game_state) {
 }
 
 internal_func game_state_t update_victory_state(game_state_t game_state) {
+  GGF_PROFILE_SCOPE("update_victory_state");
   victory_state_t *state = game_state.data;
 
   state->time += 1.0f / 60.0f;
@@ -673,8 +698,19 @@ i32 main(i32 argc, char **argv) {
             camera.view_projection);
   ggf_gfx_set_camera(&camera);
 
-  while (ggf_window_is_open(window)) {
+  // a state without data failed to create, see create_playing_state
+  while (ggf_window_is_open(window) && state.data) {
+    GGF_PROFILE_SCOPE("frame");
     ggf_poll_events();
+    if (ggf_input_key_pressed(GGF_KEY_F9))
+      ggf_profile_dump("trace.json");
+    // stopping logs the render thread's latency report
+    if (ggf_input_key_pressed(GGF_KEY_F8)) {
+      if (ggf_gfx_is_render_thread_running())
+        ggf_gfx_stop_render_thread();
+      else
+        ggf_gfx_start_render_thread(window, 2);
+    }
 
     ggf_gfx_begin_frame();
     state = state.update_func(state);
@@ -683,7 +719,10 @@ i32 main(i32 argc, char **argv) {
     ggf_window_swap_buffers(window);
   }
 
-  state.destroy_func(state);
+  // F8 may have left it running, the font is destroyed on this thread
+  ggf_gfx_stop_render_thread();
+  if (state.data)
+    state.destroy_func(state);
 
   ggf_font_destroy(&global_state.font);
 
@@ -1,14 +1,16 @@
 #pragma once
 
-typedef struct {
-  u32 max_count;
-  u32 count;
+#define PARTICLE_FIELDS(X)                                                     \
+  X(vec2, positions)                                                           \
+  X(vec2, velocities)                                                          \
+  X(f32, time)
+
+GGF_SOA_DECLARE(particle_soa, PARTICLE_FIELDS)
 
+typedef struct {
   vec4 begin_color;
   vec4 end_color;
   f32 lifetime;
 
-  vec2 *positions;
-  vec2 *velocities;
-  f32 *time;
+  particle_soa_t particles;
 } particle_system_t;